@@ -43,11 +43,21 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <ctype.h>
+#include <float.h>
 
 #ifdef ENABLE_LOCALES
 #include <locale.h>
 #endif
 
+/* vector kernels for scanning strings and whitespace, CJSON_NO_SIMD leaves only the plain C ones */
+#if !defined(CJSON_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define CJSON_SIMD_X86
+#include <immintrin.h>
+#elif !defined(CJSON_NO_SIMD) && defined(__GNUC__) && defined(__aarch64__)
+#define CJSON_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 #if defined(_MSC_VER)
 #pragma warning (pop)
 #endif
@@ -68,11 +78,20 @@
 #endif
 #define false ((cJSON_bool)0)
 
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+#define CJSON_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#define CJSON_THREAD_LOCAL __declspec(thread)
+#else
+#define CJSON_THREAD_LOCAL __thread
+#endif
+
 typedef struct {
     const unsigned char *json;
     size_t position;
 } error;
-static error global_error = { NULL, 0 };
+/* the error of the calls without a context, per thread so threads parsing at the same time keep their own */
+static CJSON_THREAD_LOCAL error global_error = { NULL, 0 };
 
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void)
 {
@@ -208,1522 +227,5528 @@ CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
     }
 }
 
-/* Internal constructor. */
-static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
+CJSON_PUBLIC(void) cJSON_InitContext(cJSON_Context *context, const cJSON_Hooks *hooks)
 {
-    cJSON* node = (cJSON*)hooks->allocate(sizeof(cJSON));
-    if (node)
+    if (context == NULL)
     {
-        memset(node, '\0', sizeof(cJSON));
+        return;
     }
 
-    return node;
-}
-
-/* Delete a cJSON structure. */
-CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
-{
-    cJSON *next = NULL;
-    while (item != NULL)
+    context->malloc_fn = internal_malloc;
+    context->free_fn = internal_free;
+    if (hooks != NULL)
     {
-        next = item->next;
-        if (!(item->type & cJSON_IsReference) && (item->child != NULL))
-        {
-            cJSON_Delete(item->child);
-        }
-        if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL))
+        if (hooks->malloc_fn != NULL)
         {
-            global_hooks.deallocate(item->valuestring);
+            context->malloc_fn = hooks->malloc_fn;
         }
-        if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
+        if (hooks->free_fn != NULL)
         {
-            global_hooks.deallocate(item->string);
+            context->free_fn = hooks->free_fn;
         }
-        global_hooks.deallocate(item);
-        item = next;
     }
+    context->nesting_limit = CJSON_NESTING_LIMIT;
+    context->intern = NULL;
+    context->error = NULL;
 }
 
-/* get the decimal point character of the current locale */
-static unsigned char get_decimal_point(void)
-{
-#ifdef ENABLE_LOCALES
-    struct lconv *lconv = localeconv();
-    return (unsigned char) lconv->decimal_point[0];
-#else
-    return '.';
-#endif
-}
-
-typedef struct
+/* Printing allocates exactly once, so contexts don't need a realloc. */
+static internal_hooks context_hooks(const cJSON_Context * const context)
 {
-    const unsigned char *content;
-    size_t length;
-    size_t offset;
-    size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
-} parse_buffer;
 
-/* check if the given size is left to read in a given parse buffer (starting with 1) */
-#define can_read(buffer, size) ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
-/* check if the buffer can be accessed at the given index (starting with 0) */
-#define can_access_at_index(buffer, index) ((buffer != NULL) && (((buffer)->offset + index) < (buffer)->length))
-#define cannot_access_at_index(buffer, index) (!can_access_at_index(buffer, index))
-/* get a pointer to the buffer at the position */
-#define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
+    hooks.allocate = context->malloc_fn;
+    hooks.deallocate = context->free_fn;
+    hooks.reallocate = NULL;
 
-/* Parse the input text to generate a number, and populate the result into item. */
-static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
-{
-    double number = 0;
-    unsigned char *after_end = NULL;
-    unsigned char number_c_string[64];
-    unsigned char decimal_point = get_decimal_point();
-    size_t i = 0;
+    return hooks;
+}
 
-    if ((input_buffer == NULL) || (input_buffer->content == NULL))
-    {
-        return false;
-    }
+/* nodes deleted on another thread go back to their slab through atomics, compilers without them build without the pool */
+#if !defined(CJSON_NO_NODE_POOL) && !(defined(__GNUC__) && defined(__ATOMIC_ACQ_REL))
+#define CJSON_NO_NODE_POOL
+#endif
 
-    /* copy the number into a temporary buffer and replace '.' with the decimal point
-     * of the current locale (for strtod)
-     * This also takes care of '\0' not necessarily being available for marking the end of the input */
-    for (i = 0; (i < (sizeof(number_c_string) - 1)) && can_access_at_index(input_buffer, i); i++)
-    {
-        switch (buffer_at_offset(input_buffer)[i])
-        {
-            case '0':
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-            case '+':
-            case '-':
-            case 'e':
-            case 'E':
-                number_c_string[i] = buffer_at_offset(input_buffer)[i];
-                break;
+#ifndef CJSON_NO_NODE_POOL
+#define pool_load(pointer) __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#define pool_store(pointer, value) __atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+#define pool_add(pointer, value) __atomic_fetch_add((pointer), (value), __ATOMIC_ACQ_REL)
+#define pool_sub(pointer, value) __atomic_fetch_sub((pointer), (value), __ATOMIC_ACQ_REL)
+#define pool_or(pointer, value) __atomic_fetch_or((pointer), (value), __ATOMIC_ACQ_REL)
+#define pool_exchange(pointer, value) __atomic_exchange_n((pointer), (value), __ATOMIC_ACQ_REL)
+#define pool_cas(pointer, expected, value) __atomic_compare_exchange_n((pointer), (expected), (value), true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
 
-            case '.':
-                number_c_string[i] = decimal_point;
-                break;
+/* Pooled nodes are taken from slabs of this many, a slab goes back to the allocator once all of its nodes are deleted. */
+#define CJSON_POOL_SLAB_NODES 64
+/* set in a slab's state once its pool was released, whoever deletes its last node frees it */
+#define CJSON_POOL_ORPHANED ((size_t)1 << ((sizeof(size_t) * CHAR_BIT) - 1))
 
-            default:
-                goto loop_end;
-        }
-    }
-loop_end:
-    number_c_string[i] = '\0';
+struct pool_slab;
 
-    number = strtod((const char*)number_c_string, (char**)&after_end);
-    if (number_c_string == after_end)
+typedef struct pool_node
+{
+    struct pool_slab *slab; /* where the node goes back to */
+    union
     {
-        return false; /* parse_error */
-    }
-
-    item->valuedouble = number;
+        struct pool_node *next_free;
+        cJSON item;
+    } node;
+} pool_node;
 
-    /* use saturation in case of overflow */
-    if (number >= INT_MAX)
-    {
-        item->valueint = INT_MAX;
-    }
-    else if (number <= (double)INT_MIN)
-    {
-        item->valueint = INT_MIN;
-    }
-    else
+/*
+ * Only the thread that owns a slab touches its lists and free_nodes. Other threads, and every thread once the
+ * pool was released, push the nodes they delete onto remote_free and count them off state, both atomically.
+ */
+typedef struct pool_slab
+{
+    struct pool_slab *next;
+    struct pool_slab *prev;
+    unsigned long owner; /* id of the thread whose lists the slab is on, 0 once that pool was released */
+    pool_node *free_nodes;
+    pool_node *remote_free; /* deleted by other threads, taken back by the owner once free_nodes runs out */
+    size_t fresh; /* nodes from here on were never handed out */
+    size_t state; /* nodes in use, and CJSON_POOL_ORPHANED */
+    void (CJSON_CDECL *deallocate)(void *pointer); /* of the hooks the slab came from */
+    pool_node nodes[CJSON_POOL_SLAB_NODES];
+} pool_slab;
+
+typedef struct node_pool
+{
+    cJSON_bool enabled;
+    unsigned long id; /* 0 until the thread made its first slab */
+    pool_slab *open; /* slabs with nodes left to hand out */
+    pool_slab *full;
+    cJSON_PoolStats stats;
+} node_pool;
+
+static CJSON_THREAD_LOCAL node_pool thread_pool;
+/* the last id given to a thread's pool */
+static unsigned long pool_ids = 0;
+
+static void slab_link(pool_slab ** const list, pool_slab * const slab)
+{
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list != NULL)
     {
-        item->valueint = (int)number;
+        (*list)->prev = slab;
     }
-
-    item->type = cJSON_Number;
-
-    input_buffer->offset += (size_t)(after_end - number_c_string);
-    return true;
+    *list = slab;
 }
 
-/* don't ask me, but the original cJSON_SetNumberValue returns an integer or double */
-CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
+static void slab_unlink(pool_slab ** const list, pool_slab * const slab)
 {
-    if (number >= INT_MAX)
+    if (slab->prev != NULL)
     {
-        object->valueint = INT_MAX;
+        slab->prev->next = slab->next;
     }
-    else if (number <= (double)INT_MIN)
+    else
     {
-        object->valueint = INT_MIN;
+        *list = slab->next;
     }
-    else
+    if (slab->next != NULL)
     {
-        object->valueint = (int)number;
+        slab->next->prev = slab->prev;
     }
-
-    return object->valuedouble = number;
+    slab->next = NULL;
+    slab->prev = NULL;
 }
 
-typedef struct
-{
-    unsigned char *buffer;
-    size_t length;
-    size_t offset;
-    size_t depth; /* current nesting depth (for formatted printing) */
-    cJSON_bool noalloc;
-    cJSON_bool format; /* is this print a formatted print */
-    internal_hooks hooks;
-} printbuffer;
-
-/* realloc printbuffer if necessary to have at least "needed" bytes more */
-static unsigned char* ensure(printbuffer * const p, size_t needed)
+/* A full slab of the calling thread that other threads gave nodes back to, moved to the open list. */
+static pool_slab *pool_reclaim(const internal_hooks * const hooks)
 {
-    unsigned char *newbuffer = NULL;
-    size_t newsize = 0;
+    pool_slab *slab = thread_pool.full;
 
-    if ((p == NULL) || (p->buffer == NULL))
+    while ((slab != NULL) && ((slab->deallocate != hooks->deallocate) || (pool_load(&slab->remote_free) == NULL)))
     {
-        return NULL;
+        slab = slab->next;
     }
 
-    if ((p->length > 0) && (p->offset >= p->length))
+    if (slab != NULL)
     {
-        /* make sure that offset is valid */
-        return NULL;
+        slab_unlink(&thread_pool.full, slab);
+        slab_link(&thread_pool.open, slab);
     }
 
-    if (needed > INT_MAX)
-    {
-        /* sizes bigger than INT_MAX are currently not supported */
-        return NULL;
-    }
+    return slab;
+}
 
-    needed += p->offset + 1;
-    if (needed <= p->length)
+static cJSON *pool_take(const internal_hooks * const hooks)
+{
+    pool_slab *slab = thread_pool.open;
+    pool_node *node = NULL;
+
+    /* nodes of a context only ever live in memory from its allocator */
+    while ((slab != NULL) && (slab->deallocate != hooks->deallocate))
     {
-        return p->buffer + p->offset;
+        slab = slab->next;
     }
 
-    if (p->noalloc) {
-        return NULL;
+    if (slab == NULL)
+    {
+        slab = pool_reclaim(hooks);
     }
 
-    /* calculate new buffer size */
-    if (needed > (INT_MAX / 2))
+    if (slab == NULL)
     {
-        /* overflow of int, use INT_MAX if possible */
-        if (needed <= INT_MAX)
+        slab = (pool_slab*)hooks->allocate(sizeof(pool_slab));
+        if (slab == NULL)
         {
-            newsize = INT_MAX;
+            return NULL;
         }
-        else
+        if (thread_pool.id == 0)
         {
-            return NULL;
+            thread_pool.id = pool_add(&pool_ids, 1) + 1;
         }
+        slab->owner = thread_pool.id;
+        slab->free_nodes = NULL;
+        slab->remote_free = NULL;
+        slab->fresh = 0;
+        slab->state = 0;
+        slab->deallocate = hooks->deallocate;
+        slab_link(&thread_pool.open, slab);
+        thread_pool.stats.slabs++;
     }
-    else
+
+    if ((slab->free_nodes == NULL) && (pool_load(&slab->remote_free) != NULL))
     {
-        newsize = needed * 2;
+        slab->free_nodes = pool_exchange(&slab->remote_free, (pool_node*)NULL);
     }
 
-    if (p->hooks.reallocate != NULL)
+    if (slab->free_nodes != NULL)
     {
-        /* reallocate with realloc if available */
-        newbuffer = (unsigned char*)p->hooks.reallocate(p->buffer, newsize);
-        if (newbuffer == NULL)
-        {
-            p->hooks.deallocate(p->buffer);
-            p->length = 0;
-            p->buffer = NULL;
-
-            return NULL;
-        }
+        node = slab->free_nodes;
+        slab->free_nodes = node->node.next_free;
+        thread_pool.stats.reused++;
     }
     else
     {
-        /* otherwise reallocate manually */
-        newbuffer = (unsigned char*)p->hooks.allocate(newsize);
-        if (!newbuffer)
-        {
-            p->hooks.deallocate(p->buffer);
-            p->length = 0;
-            p->buffer = NULL;
-
-            return NULL;
-        }
-        if (newbuffer)
-        {
-            memcpy(newbuffer, p->buffer, p->offset + 1);
-        }
-        p->hooks.deallocate(p->buffer);
+        node = &slab->nodes[slab->fresh++];
+        node->slab = slab;
     }
-    p->length = newsize;
-    p->buffer = newbuffer;
-
-    return newbuffer + p->offset;
-}
+    pool_add(&slab->state, 1);
+    thread_pool.stats.taken++;
 
-/* calculate the new length of the string in a printbuffer and update the offset */
-static void update_offset(printbuffer * const buffer)
-{
-    const unsigned char *buffer_pointer = NULL;
-    if ((buffer == NULL) || (buffer->buffer == NULL))
+    if ((slab->free_nodes == NULL) && (slab->fresh == CJSON_POOL_SLAB_NODES))
     {
-        return;
+        slab_unlink(&thread_pool.open, slab);
+        slab_link(&thread_pool.full, slab);
     }
-    buffer_pointer = buffer->buffer + buffer->offset;
 
-    buffer->offset += strlen((const char*)buffer_pointer);
+    return &node->node.item;
 }
 
-/* Render the number nicely from the given item into a string. */
-static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+static void pool_give(cJSON * const item)
 {
-    unsigned char *output_pointer = NULL;
-    double d = item->valuedouble;
-    int length = 0;
-    size_t i = 0;
-    unsigned char number_buffer[26]; /* temporary buffer to print the number into */
-    unsigned char decimal_point = get_decimal_point();
-    double test;
+    pool_node *node = (pool_node*)(void*)((unsigned char*)item - offsetof(pool_node, node));
+    pool_slab *slab = node->slab;
+    pool_node *head = NULL;
+    cJSON_bool was_full = false;
 
-    if (output_buffer == NULL)
-    {
-        return false;
-    }
+    thread_pool.stats.given++;
 
-    /* This checks for NaN and Infinity */
-    if ((d * 0) != 0)
-    {
-        length = sprintf((char*)number_buffer, "null");
-    }
-    else
+    if ((thread_pool.id == 0) || (pool_load(&slab->owner) != thread_pool.id))
     {
-        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
-        length = sprintf((char*)number_buffer, "%1.15g", d);
+        /* another thread's slab, or one whose pool was released */
+        head = pool_load(&slab->remote_free);
+        do
+        {
+            node->node.next_free = head;
+        } while (!pool_cas(&slab->remote_free, &head, node));
 
-        /* Check whether the original double can be recovered */
-        if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || ((double)test != d))
+        if (pool_sub(&slab->state, 1) == (CJSON_POOL_ORPHANED | 1))
         {
-            /* If not, print with 17 decimal places of precision */
-            length = sprintf((char*)number_buffer, "%1.17g", d);
+            slab->deallocate(slab);
+            thread_pool.stats.released++;
         }
+        return;
     }
 
-    /* sprintf failed or buffer overrun occurred */
-    if ((length < 0) || (length > (int)(sizeof(number_buffer) - 1)))
+    was_full = (slab->free_nodes == NULL) && (slab->fresh == CJSON_POOL_SLAB_NODES);
+    node->node.next_free = slab->free_nodes;
+    slab->free_nodes = node;
+
+    if (was_full)
     {
-        return false;
+        slab_unlink(&thread_pool.full, slab);
+        slab_link(&thread_pool.open, slab);
     }
 
-    /* reserve appropriate space in the output */
-    output_pointer = ensure(output_buffer, (size_t)length + sizeof(""));
-    if (output_pointer == NULL)
+    /* an empty slab is kept only while it is the one slab left to take nodes from */
+    if ((pool_sub(&slab->state, 1) == 1) && ((slab->prev != NULL) || (slab->next != NULL)))
     {
-        return false;
+        slab_unlink(&thread_pool.open, slab);
+        slab->deallocate(slab);
+        thread_pool.stats.released++;
     }
+}
+
+/* Free the slabs of a list that have no nodes in use, the others are freed with their last node. */
+static void pool_release_list(pool_slab ** const list)
+{
+    pool_slab *slab = *list;
+    pool_slab *next = NULL;
 
-    /* copy the printed number to the output and replace locale
-     * dependent decimal point with '.' */
-    for (i = 0; i < ((size_t)length); i++)
+    for (; slab != NULL; slab = next)
     {
-        if (number_buffer[i] == decimal_point)
+        next = slab->next;
+        slab->next = NULL;
+        slab->prev = NULL;
+        pool_store(&slab->owner, 0UL);
+        /* from here on the slab belongs to whoever deletes its last node */
+        if (pool_or(&slab->state, CJSON_POOL_ORPHANED) == 0)
         {
-            output_pointer[i] = '.';
-            continue;
+            slab->deallocate(slab);
+            thread_pool.stats.released++;
         }
-
-        output_pointer[i] = number_buffer[i];
     }
-    output_pointer[i] = '\0';
+    *list = NULL;
+}
+#endif /* CJSON_NO_NODE_POOL */
 
-    output_buffer->offset += (size_t)length;
+CJSON_PUBLIC(void) cJSON_EnablePool(cJSON_bool enable)
+{
+#ifndef CJSON_NO_NODE_POOL
+    thread_pool.enabled = enable;
+#else
+    (void)enable;
+#endif
+}
 
-    return true;
+CJSON_PUBLIC(void) cJSON_PoolRelease(void)
+{
+#ifndef CJSON_NO_NODE_POOL
+    pool_release_list(&thread_pool.open);
+    pool_release_list(&thread_pool.full);
+#endif
 }
 
-/* parse 4 digit hexadecimal number */
-static unsigned parse_hex4(const unsigned char * const input)
+CJSON_PUBLIC(void) cJSON_GetPoolStats(cJSON_PoolStats *stats)
 {
-    unsigned int h = 0;
-    size_t i = 0;
+    if (stats == NULL)
+    {
+        return;
+    }
 
-    for (i = 0; i < 4; i++)
+#ifndef CJSON_NO_NODE_POOL
+    *stats = thread_pool.stats;
+#else
+    memset(stats, '\0', sizeof(cJSON_PoolStats));
+#endif
+}
+
+/* Internal constructor. */
+static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
+{
+    cJSON* node = NULL;
+
+#ifndef CJSON_NO_NODE_POOL
+    if (thread_pool.enabled)
     {
-        /* parse digit */
-        if ((input[i] >= '0') && (input[i] <= '9'))
+        node = pool_take(hooks);
+        if (node)
         {
-            h += (unsigned int) input[i] - '0';
+            memset(node, '\0', sizeof(cJSON));
+            node->type = cJSON_Pooled;
         }
-        else if ((input[i] >= 'A') && (input[i] <= 'F'))
+        return node;
+    }
+#endif
+
+    node = (cJSON*)hooks->allocate(sizeof(cJSON));
+    if (node)
+    {
+        memset(node, '\0', sizeof(cJSON));
+    }
+
+    return node;
+}
+
+/* The root node of a cJSON_ParseInSitu tree, with the buffer it owns. Flagged cJSON_OwnsBuffer. */
+typedef struct
+{
+    cJSON item;
+    void *buffer;
+} insitu_root;
+
+static void cJSON_Free_Item(cJSON * const item, const internal_hooks * const hooks)
+{
+    if (item->type & cJSON_OwnsBuffer)
+    {
+        hooks->deallocate(((insitu_root*)item)->buffer);
+    }
+#ifndef CJSON_NO_NODE_POOL
+    if (item->type & cJSON_Pooled)
+    {
+        pool_give(item);
+        return;
+    }
+#endif
+    hooks->deallocate(item);
+}
+
+/*
+ * The explicit stack that parsing, printing, duplicating and comparing keep their open arrays and objects on
+ * instead of recursing, so how deep a document goes costs heap rather than C stack. The first frames live in
+ * the walk_stack itself, which its user keeps on its C stack, deeper documents move them to memory from hooks.
+ */
+#define CJSON_WALK_INLINE_SIZE 1024
+
+typedef struct
+{
+    unsigned char *frames;
+    size_t frame_size;
+    size_t count;
+    size_t capacity;
+    const internal_hooks *hooks;
+    void *inline_frames[CJSON_WALK_INLINE_SIZE / sizeof(void*)];
+} walk_stack;
+
+static void walk_init(walk_stack * const stack, const size_t frame_size, const internal_hooks * const hooks)
+{
+    stack->frames = (unsigned char*)stack->inline_frames;
+    stack->frame_size = frame_size;
+    stack->count = 0;
+    stack->capacity = sizeof(stack->inline_frames) / frame_size;
+    stack->hooks = hooks;
+}
+
+static void walk_free(walk_stack * const stack)
+{
+    if (stack->frames != (unsigned char*)stack->inline_frames)
+    {
+        stack->hooks->deallocate(stack->frames);
+    }
+    stack->frames = (unsigned char*)stack->inline_frames;
+}
+
+/* A new frame on top of the stack, NULL if the stack can't grow. */
+static void *walk_push(walk_stack * const stack)
+{
+    unsigned char *frames = NULL;
+
+    if (stack->count == stack->capacity)
+    {
+        if (stack->capacity > ((INT_MAX / 2) / stack->frame_size))
         {
-            h += (unsigned int) 10 + input[i] - 'A';
+            return NULL;
         }
-        else if ((input[i] >= 'a') && (input[i] <= 'f'))
+        frames = (unsigned char*)stack->hooks->allocate(stack->capacity * 2 * stack->frame_size);
+        if (frames == NULL)
         {
-            h += (unsigned int) 10 + input[i] - 'a';
+            return NULL;
         }
-        else /* invalid */
+        memcpy(frames, stack->frames, stack->count * stack->frame_size);
+        walk_free(stack);
+        stack->frames = frames;
+        stack->capacity *= 2;
+    }
+
+    return stack->frames + (stack->count++ * stack->frame_size);
+}
+
+#define walk_top(stack) ((void*)((stack)->frames + (((stack)->count - 1) * (stack)->frame_size)))
+#define walk_pop(stack) ((stack)->count--)
+
+#if defined(__clang__) || (defined(__GNUC__)  && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
+    #pragma GCC diagnostic push
+#endif
+#ifdef __GNUC__
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#endif
+/* helper function to cast away const */
+static void* cast_away_const(const void* string)
+{
+    return (void*)string;
+}
+#if defined(__clang__) || (defined(__GNUC__)  && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
+    #pragma GCC diagnostic pop
+#endif
+
+#define CJSON_ARENA_BLOCK_SIZE 65536
+/* every allocation from an arena is aligned to this */
+#define CJSON_ARENA_ALIGN 16
+#define arena_align(size) (((size) + (CJSON_ARENA_ALIGN - 1)) & ~((size_t)CJSON_ARENA_ALIGN - 1))
+
+typedef struct arena_block
+{
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+} arena_block;
+
+/* a buffer the arena frees on reset, see cJSON_ParseInSitu */
+typedef struct arena_adopted
+{
+    struct arena_adopted *next;
+    void *pointer;
+} arena_adopted;
+
+struct cJSON_Arena
+{
+    arena_block *blocks; /* the block being carved from comes first */
+    size_t block_size;
+    arena_adopted *adopted; /* records live in the blocks */
+    internal_hooks hooks;
+};
+
+#define arena_block_data(block) ((unsigned char*)(block) + arena_align(sizeof(arena_block)))
+
+static arena_block *arena_new_block(cJSON_Arena * const arena, size_t size)
+{
+    arena_block *block = (arena_block*)arena->hooks.allocate(arena_align(sizeof(arena_block)) + size);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
+
+static void *arena_allocate(cJSON_Arena * const arena, size_t size)
+{
+    arena_block *block = arena->blocks;
+
+    size = arena_align(size);
+
+    if ((block == NULL) || ((block->size - block->used) < size))
+    {
+        if (size > (arena->block_size / 4))
         {
-            return 0;
+            /* oversized requests get a block of their own, behind the current one */
+            block = arena_new_block(arena, size);
+            if (block == NULL)
+            {
+                return NULL;
+            }
+            if (arena->blocks != NULL)
+            {
+                block->next = arena->blocks->next;
+                arena->blocks->next = block;
+            }
+            else
+            {
+                block->next = NULL;
+                arena->blocks = block;
+            }
+            block->used = size;
+
+            return arena_block_data(block);
         }
 
-        if (i < 3)
+        block = arena_new_block(arena, arena->block_size);
+        if (block == NULL)
         {
-            /* shift left to make place for the next nibble */
-            h = h << 4;
+            return NULL;
         }
+        block->next = arena->blocks;
+        arena->blocks = block;
     }
 
-    return h;
+    block->used += size;
+
+    return arena_block_data(block) + block->used - size;
 }
 
-/* converts a UTF-16 literal to UTF-8
- * A literal can be one or two sequences of the form \uXXXX */
-static unsigned char utf16_literal_to_utf8(const unsigned char * const input_pointer, const unsigned char * const input_end, unsigned char **output_pointer)
+/* Make pointer part of the arena, it is freed on the next reset. */
+static cJSON_bool arena_adopt(cJSON_Arena * const arena, void * const pointer)
 {
-    long unsigned int codepoint = 0;
-    unsigned int first_code = 0;
-    const unsigned char *first_sequence = input_pointer;
-    unsigned char utf8_length = 0;
-    unsigned char utf8_position = 0;
-    unsigned char sequence_length = 0;
-    unsigned char first_byte_mark = 0;
+    arena_adopted *adopted = (arena_adopted*)arena_allocate(arena, sizeof(arena_adopted));
+    if (adopted == NULL)
+    {
+        return false;
+    }
 
-    if ((input_end - first_sequence) < 6)
+    adopted->pointer = pointer;
+    adopted->next = arena->adopted;
+    arena->adopted = adopted;
+
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_Arena *) cJSON_CreateArena(size_t block_size)
+{
+    cJSON_Arena *arena = (cJSON_Arena*)global_hooks.allocate(sizeof(cJSON_Arena));
+    if (arena == NULL)
     {
-        /* input ends unexpectedly */
-        goto fail;
+        return NULL;
     }
 
-    /* get the first utf16 sequence */
-    first_code = parse_hex4(first_sequence + 2);
+    arena->blocks = NULL;
+    arena->adopted = NULL;
+    arena->block_size = arena_align((block_size > 0) ? block_size : CJSON_ARENA_BLOCK_SIZE);
+    arena->hooks = global_hooks;
 
-    /* check that the code is valid */
-    if (((first_code >= 0xDC00) && (first_code <= 0xDFFF)))
+    return arena;
+}
+
+CJSON_PUBLIC(void) cJSON_ResetArena(cJSON_Arena *arena)
+{
+    arena_block *block = NULL;
+    arena_block *keep = NULL;
+
+    if (arena == NULL)
     {
-        goto fail;
+        return;
     }
 
-    /* UTF16 surrogate pair */
-    if ((first_code >= 0xD800) && (first_code <= 0xDBFF))
+    /* the records go away with the blocks, walk them first */
+    while (arena->adopted != NULL)
     {
-        const unsigned char *second_sequence = first_sequence + 6;
-        unsigned int second_code = 0;
-        sequence_length = 12; /* \uXXXX\uXXXX */
+        arena->hooks.deallocate(arena->adopted->pointer);
+        arena->adopted = arena->adopted->next;
+    }
 
-        if ((input_end - second_sequence) < 6)
+    while (arena->blocks != NULL)
+    {
+        block = arena->blocks;
+        arena->blocks = block->next;
+        if ((keep == NULL) && (block->size == arena->block_size))
         {
-            /* input ends unexpectedly */
-            goto fail;
+            keep = block;
         }
-
-        if ((second_sequence[0] != '\\') || (second_sequence[1] != 'u'))
+        else
         {
-            /* missing second half of the surrogate pair */
-            goto fail;
+            arena->hooks.deallocate(block);
         }
+    }
 
-        /* get the second utf16 sequence */
-        second_code = parse_hex4(second_sequence + 2);
-        /* check that the code is valid */
-        if ((second_code < 0xDC00) || (second_code > 0xDFFF))
-        {
-            /* invalid second half of the surrogate pair */
-            goto fail;
-        }
+    if (keep != NULL)
+    {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    arena->blocks = keep;
+}
 
+CJSON_PUBLIC(void) cJSON_DeleteArena(cJSON_Arena *arena)
+{
+    internal_hooks hooks;
 
-        /* calculate the unicode codepoint from the surrogate pair */
-        codepoint = 0x10000 + (((first_code & 0x3FF) << 10) | (second_code & 0x3FF));
-    }
-    else
+    if (arena == NULL)
     {
-        sequence_length = 6; /* \uXXXX */
-        codepoint = first_code;
+        return;
     }
 
-    /* encode as UTF-8
-     * takes at maximum 4 bytes to encode:
-     * 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx */
-    if (codepoint < 0x80)
+    cJSON_ResetArena(arena);
+    hooks = arena->hooks;
+    if (arena->blocks != NULL)
     {
-        /* normal ascii, encoding 0xxxxxxx */
-        utf8_length = 1;
+        hooks.deallocate(arena->blocks);
     }
-    else if (codepoint < 0x800)
+    hooks.deallocate(arena);
+}
+
+#define CJSON_INTERN_BLOCK_SIZE 4096
+#define CJSON_INTERN_MIN_SLOTS 64
+#define CJSON_INTERN_DEFAULT_LENGTH 32
+
+typedef struct intern_block
+{
+    struct intern_block *next;
+    size_t used;
+    size_t size;
+} intern_block;
+
+typedef struct intern_slot
+{
+    const char *string; /* NULL for an empty slot */
+    size_t length;
+    unsigned long hash;
+} intern_slot;
+
+struct cJSON_Intern
+{
+    intern_block *blocks; /* the block being filled comes first */
+    intern_slot *slots;
+    size_t size; /* always a power of two */
+    size_t count;
+    size_t max_length;
+    cJSON_InternStats stats;
+};
+
+#define intern_block_data(block) ((char*)(block) + sizeof(intern_block))
+
+CJSON_PUBLIC(cJSON_Intern *) cJSON_CreateIntern(size_t max_length)
+{
+    cJSON_Intern *intern = (cJSON_Intern*)global_hooks.allocate(sizeof(cJSON_Intern));
+    if (intern == NULL)
     {
-        /* two bytes, encoding 110xxxxx 10xxxxxx */
-        utf8_length = 2;
-        first_byte_mark = 0xC0; /* 11000000 */
+        return NULL;
     }
-    else if (codepoint < 0x10000)
+
+    memset(intern, '\0', sizeof(cJSON_Intern));
+    intern->max_length = (max_length > 0) ? max_length : CJSON_INTERN_DEFAULT_LENGTH;
+    if (intern->max_length > CJSON_INTERN_MAX_LENGTH)
     {
-        /* three bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx */
-        utf8_length = 3;
-        first_byte_mark = 0xE0; /* 11100000 */
+        intern->max_length = CJSON_INTERN_MAX_LENGTH;
     }
-    else if (codepoint <= 0x10FFFF)
+
+    intern->slots = (intern_slot*)global_hooks.allocate(CJSON_INTERN_MIN_SLOTS * sizeof(intern_slot));
+    if (intern->slots == NULL)
     {
-        /* four bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx 10xxxxxx */
-        utf8_length = 4;
-        first_byte_mark = 0xF0; /* 11110000 */
+        global_hooks.deallocate(intern);
+        return NULL;
     }
-    else
+    memset(intern->slots, '\0', CJSON_INTERN_MIN_SLOTS * sizeof(intern_slot));
+    intern->size = CJSON_INTERN_MIN_SLOTS;
+    intern->stats.allocations = 2;
+
+    return intern;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteIntern(cJSON_Intern *intern)
+{
+    intern_block *block = NULL;
+
+    if (intern == NULL)
     {
-        /* invalid unicode codepoint */
-        goto fail;
+        return;
     }
 
-    /* encode as utf8 */
-    for (utf8_position = (unsigned char)(utf8_length - 1); utf8_position > 0; utf8_position--)
+    while (intern->blocks != NULL)
     {
-        /* 10xxxxxx */
-        (*output_pointer)[utf8_position] = (unsigned char)((codepoint | 0x80) & 0xBF);
-        codepoint >>= 6;
+        block = intern->blocks;
+        intern->blocks = block->next;
+        global_hooks.deallocate(block);
     }
-    /* encode first byte */
-    if (utf8_length > 1)
+    global_hooks.deallocate(intern->slots);
+    global_hooks.deallocate(intern);
+}
+
+CJSON_PUBLIC(void) cJSON_GetInternStats(const cJSON_Intern *intern, cJSON_InternStats *stats)
+{
+    if (stats == NULL)
     {
-        (*output_pointer)[0] = (unsigned char)((codepoint | first_byte_mark) & 0xFF);
+        return;
     }
-    else
+
+    if (intern == NULL)
     {
-        (*output_pointer)[0] = (unsigned char)(codepoint & 0x7F);
+        memset(stats, '\0', sizeof(cJSON_InternStats));
+        return;
     }
 
-    *output_pointer += utf8_length;
-
-    return sequence_length;
-
-fail:
-    return 0;
+    *stats = intern->stats;
 }
 
-/* Parse the input text into an unescaped cinput, and populate item. */
-static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+/* Room for size bytes that stay until the table is deleted, strings are packed without alignment. */
+static char *intern_store(cJSON_Intern * const intern, const size_t size)
 {
-    const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
-    const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
-    unsigned char *output_pointer = NULL;
-    unsigned char *output = NULL;
+    intern_block *block = intern->blocks;
 
-    /* not a string */
-    if (buffer_at_offset(input_buffer)[0] != '\"')
+    if ((block == NULL) || ((block->size - block->used) < size))
     {
-        goto fail;
-    }
+        const size_t block_size = (size > (CJSON_INTERN_BLOCK_SIZE / 4)) ? size : CJSON_INTERN_BLOCK_SIZE;
 
-    {
-        /* calculate approximate size of the output (overestimate) */
-        size_t allocation_length = 0;
-        size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+        block = (intern_block*)global_hooks.allocate(sizeof(intern_block) + block_size);
+        if (block == NULL)
         {
-            /* is escape sequence */
-            if (input_end[0] == '\\')
-            {
-                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
-                {
-                    /* prevent buffer overflow when last input character is a backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
-            }
-            input_end++;
+            return NULL;
         }
-        if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
+        intern->stats.allocations++;
+        block->size = block_size;
+        block->used = 0;
+
+        if ((block_size != CJSON_INTERN_BLOCK_SIZE) && (intern->blocks != NULL))
         {
-            goto fail; /* string ended unexpectedly */
+            /* an oversized string gets a block of its own, behind the one being filled */
+            block->next = intern->blocks->next;
+            intern->blocks->next = block;
         }
-
-        /* This is at most how much we need for the output */
-        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
-        if (output == NULL)
+        else
         {
-            goto fail; /* allocation failure */
+            block->next = intern->blocks;
+            intern->blocks = block;
         }
     }
 
-    output_pointer = output;
-    /* loop through the string literal */
-    while (input_pointer < input_end)
-    {
-        if (*input_pointer != '\\')
-        {
-            *output_pointer++ = *input_pointer++;
-        }
-        /* escape sequence */
-        else
-        {
-            unsigned char sequence_length = 2;
-            if ((input_end - input_pointer) < 1)
-            {
-                goto fail;
-            }
+    block->used += size;
+    intern->stats.bytes += size;
 
-            switch (input_pointer[1])
-            {
-                case 'b':
-                    *output_pointer++ = '\b';
-                    break;
-                case 'f':
-                    *output_pointer++ = '\f';
-                    break;
-                case 'n':
-                    *output_pointer++ = '\n';
-                    break;
-                case 'r':
-                    *output_pointer++ = '\r';
-                    break;
-                case 't':
-                    *output_pointer++ = '\t';
-                    break;
-                case '\"':
-                case '\\':
-                case '/':
-                    *output_pointer++ = input_pointer[1];
-                    break;
+    return intern_block_data(block) + block->used - size;
+}
 
-                /* UTF-16 literal */
-                case 'u':
-                    sequence_length = utf16_literal_to_utf8(input_pointer, input_end, &output_pointer);
-                    if (sequence_length == 0)
-                    {
-                        /* failed to convert UTF16-literal to UTF-8 */
-                        goto fail;
-                    }
-                    break;
+static intern_slot *intern_probe(intern_slot * const slots, const size_t size, const unsigned long hash, const char * const string, const size_t length)
+{
+    size_t i = hash & (size - 1);
 
-                default:
-                    goto fail;
-            }
-            input_pointer += sequence_length;
+    while (slots[i].string != NULL)
+    {
+        if ((slots[i].hash == hash) && (slots[i].length == length) && (memcmp(slots[i].string, string, length) == 0))
+        {
+            break;
         }
+        i = (i + 1) & (size - 1);
     }
 
-    /* zero terminate the output */
-    *output_pointer = '\0';
-
-    item->type = cJSON_String;
-    item->valuestring = (char*)output;
+    return &slots[i];
+}
 
-    input_buffer->offset = (size_t) (input_end - input_buffer->content);
-    input_buffer->offset++;
+static cJSON_bool intern_grow(cJSON_Intern * const intern)
+{
+    intern_slot *slots = NULL;
+    size_t i = 0;
 
-    return true;
+    if (intern->size > (((size_t)-1 / sizeof(intern_slot)) / 2))
+    {
+        return false;
+    }
 
-fail:
-    if (output != NULL)
+    slots = (intern_slot*)global_hooks.allocate(intern->size * 2 * sizeof(intern_slot));
+    if (slots == NULL)
     {
-        input_buffer->hooks.deallocate(output);
+        return false;
     }
+    intern->stats.allocations++;
+    memset(slots, '\0', intern->size * 2 * sizeof(intern_slot));
 
-    if (input_pointer != NULL)
+    for (i = 0; i < intern->size; i++)
     {
-        input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
+        if (intern->slots[i].string != NULL)
+        {
+            *intern_probe(slots, intern->size * 2, intern->slots[i].hash, intern->slots[i].string, intern->slots[i].length) = intern->slots[i];
+        }
     }
 
-    return false;
+    global_hooks.deallocate(intern->slots);
+    intern->slots = slots;
+    intern->size *= 2;
+
+    return true;
 }
 
-/* Render the cstring provided to an escaped version that can be printed. */
-static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
+/* The shared copy of the length bytes at string, made on first sight. */
+static const char *intern_string(cJSON_Intern * const intern, const unsigned char * const string, const size_t length)
 {
-    const unsigned char *input_pointer = NULL;
-    unsigned char *output = NULL;
-    unsigned char *output_pointer = NULL;
-    size_t output_length = 0;
-    /* numbers of additional characters needed for escaping */
-    size_t escape_characters = 0;
+    intern_slot *slot = NULL;
+    unsigned long hash = 2166136261UL; /* FNV-1a */
+    char *copy = NULL;
+    size_t i = 0;
 
-    if (output_buffer == NULL)
+    for (i = 0; i < length; i++)
     {
-        return false;
+        hash = ((hash ^ string[i]) * 16777619UL) & 0xFFFFFFFFUL;
     }
 
-    /* empty string */
-    if (input == NULL)
+    slot = intern_probe(intern->slots, intern->size, hash, (const char*)string, length);
+    if (slot->string != NULL)
     {
-        output = ensure(output_buffer, sizeof("\"\""));
-        if (output == NULL)
-        {
-            return false;
-        }
-        strcpy((char*)output, "\"\"");
-
-        return true;
+        intern->stats.shared++;
+        return slot->string;
     }
 
-    /* set "flag" to 1 if something needs to be escaped */
-    for (input_pointer = input; *input_pointer; input_pointer++)
+    if (((intern->count + 1) * 10) > (intern->size * 7))
     {
-        switch (*input_pointer)
+        if (!intern_grow(intern))
         {
-            case '\"':
-            case '\\':
-            case '\b':
-            case '\f':
-            case '\n':
-            case '\r':
-            case '\t':
-                /* one character escape sequence */
-                escape_characters++;
-                break;
-            default:
-                if (*input_pointer < 32)
-                {
-                    /* UTF-16 escape sequence uXXXX */
-                    escape_characters += 5;
-                }
-                break;
+            return NULL;
         }
+        slot = intern_probe(intern->slots, intern->size, hash, (const char*)string, length);
     }
-    output_length = (size_t)(input_pointer - input) + escape_characters;
 
-    output = ensure(output_buffer, output_length + sizeof("\"\""));
-    if (output == NULL)
+    copy = intern_store(intern, length + sizeof(""));
+    if (copy == NULL)
     {
-        return false;
+        return NULL;
     }
+    memcpy(copy, string, length);
+    copy[length] = '\0';
 
-    /* no characters have to be escaped */
-    if (escape_characters == 0)
+    slot->string = copy;
+    slot->length = length;
+    slot->hash = hash;
+    intern->count++;
+    intern->stats.strings++;
+
+    return copy;
+}
+
+CJSON_PUBLIC(const char *) cJSON_InternString(cJSON_Intern *intern, const char *string, size_t length)
+{
+    char *copy = NULL;
+
+    if ((intern == NULL) || (string == NULL))
     {
-        output[0] = '\"';
-        memcpy(output + 1, input, output_length);
-        output[output_length + 1] = '\"';
-        output[output_length + 2] = '\0';
+        return NULL;
+    }
 
-        return true;
+    if (length <= intern->max_length)
+    {
+        return intern_string(intern, (const unsigned char*)string, length);
     }
 
-    output[0] = '\"';
-    output_pointer = output + 1;
-    /* copy the string */
-    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+    /* too long to be looked up, kept once like a long string of a parse */
+    copy = intern_store(intern, length + sizeof(""));
+    if (copy == NULL)
     {
-        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        return NULL;
+    }
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+/* Delete a cJSON structure whose strings came from hooks. */
+static void delete_item(cJSON *item, const internal_hooks * const hooks)
+{
+    cJSON *next = NULL;
+    cJSON *child = NULL;
+    while (item != NULL)
+    {
+        if (!(item->type & cJSON_IsReference) && (item->child != NULL))
         {
-            /* normal character, copy */
-            *output_pointer = *input_pointer;
+            /* children go first: take the first one off the list and let it lead back here instead of to its sibling */
+            child = item->child;
+            item->child = child->next;
+            child->next = item;
+            item = child;
+            continue;
         }
-        else
+        next = item->next;
+        if (!(item->type & (cJSON_IsReference | cJSON_InArena | cJSON_InSitu | cJSON_Interned)) && (item->valuestring != NULL))
         {
-            /* character needs to be escaped */
-            *output_pointer++ = '\\';
-            switch (*input_pointer)
-            {
-                case '\\':
-                    *output_pointer = '\\';
-                    break;
-                case '\"':
-                    *output_pointer = '\"';
-                    break;
-                case '\b':
-                    *output_pointer = 'b';
-                    break;
-                case '\f':
-                    *output_pointer = 'f';
-                    break;
-                case '\n':
-                    *output_pointer = 'n';
-                    break;
-                case '\r':
-                    *output_pointer = 'r';
-                    break;
-                case '\t':
-                    *output_pointer = 't';
-                    break;
-                default:
-                    /* escape and print as unicode codepoint */
-                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
-                    output_pointer += 4;
-                    break;
-            }
+            hooks->deallocate(item->valuestring);
+        }
+        if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
+        {
+            hooks->deallocate(item->string);
+        }
+        if (!(item->type & cJSON_InArena))
+        {
+            cJSON_Free_Item(item, hooks);
         }
+        item = next;
     }
-    output[output_length + 1] = '\"';
-    output[output_length + 2] = '\0';
+}
 
-    return true;
+CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
+{
+    delete_item(item, &global_hooks);
 }
 
-/* Invoke print_string_ptr (which is useful) on an item. */
-static cJSON_bool print_string(const cJSON * const item, printbuffer * const p)
+CJSON_PUBLIC(void) cJSON_DeleteWithContext(cJSON_Context *context, cJSON *item)
 {
-    return print_string_ptr((unsigned char*)item->valuestring, p);
+    internal_hooks hooks;
+
+    if (context == NULL)
+    {
+        return;
+    }
+
+    hooks = context_hooks(context);
+    delete_item(item, &hooks);
 }
 
-/* Predeclare these prototypes. */
-static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer);
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer);
-static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer);
-static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer);
+/* get the decimal point character of the current locale */
+static unsigned char get_decimal_point(void)
+{
+#ifdef ENABLE_LOCALES
+    struct lconv *lconv = localeconv();
+    return (unsigned char) lconv->decimal_point[0];
+#else
+    return '.';
+#endif
+}
 
-/* Utility to jump whitespace and cr/lf */
-static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
+typedef struct
 {
-    if ((buffer == NULL) || (buffer->content == NULL))
+    const unsigned char *content;
+    size_t length;
+    size_t offset;
+    size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
+    internal_hooks hooks;
+    cJSON_Arena *arena; /* allocate nodes and strings from here if not NULL */
+    cJSON_bool insitu; /* decode strings into content itself */
+    size_t nesting_limit;
+    cJSON_Intern *intern; /* take strings from here instead of allocating them */
+    cJSON_bool pooled; /* new nodes come from the node pool */
+} parse_buffer;
+
+static void parse_buffer_init(parse_buffer * const buffer, const char * const value, const size_t length, const internal_hooks * const hooks, cJSON_Arena * const arena)
+{
+    memset(buffer, '\0', sizeof(parse_buffer));
+    buffer->content = (const unsigned char*)value;
+    buffer->length = length;
+    buffer->hooks = *hooks;
+    buffer->arena = arena;
+    buffer->nesting_limit = CJSON_NESTING_LIMIT;
+#ifndef CJSON_NO_NODE_POOL
+    buffer->pooled = (arena == NULL) && thread_pool.enabled;
+#endif
+}
+
+/* allocate from the arena of the parse buffer, or its hooks */
+static void *parse_allocate(const parse_buffer * const buffer, size_t size)
+{
+    if (buffer->arena != NULL)
     {
-        return NULL;
+        return arena_allocate(buffer->arena, size);
+    }
+
+    return buffer->hooks.allocate(size);
+}
+
+static cJSON *parse_new_item(const parse_buffer * const buffer)
+{
+    cJSON *node = NULL;
+
+    if (buffer->arena == NULL)
+    {
+        return cJSON_New_Item(&buffer->hooks);
+    }
+
+    node = (cJSON*)arena_allocate(buffer->arena, sizeof(cJSON));
+    if (node)
+    {
+        memset(node, '\0', sizeof(cJSON));
+    }
+
+    return node;
+}
+
+/* Mark a parsed item as pooled or living in the arena or the input, parse_value overwrites the type so this comes after it. */
+static void parse_claim(const parse_buffer * const buffer, cJSON * const item)
+{
+    if (buffer->pooled)
+    {
+        item->type |= cJSON_Pooled;
     }
+    if ((buffer->arena != NULL) || buffer->insitu || (buffer->intern != NULL))
+    {
+        if (buffer->arena != NULL)
+        {
+            item->type |= cJSON_InArena;
+        }
+        else
+        {
+            item->type |= buffer->insitu ? cJSON_InSitu : cJSON_Interned;
+        }
+        if (item->string != NULL)
+        {
+            /* keep cJSON_Delete and the key replacing functions away from it */
+            item->type |= cJSON_StringIsConst;
+        }
+    }
+}
+
+/* Drop a partially parsed list with the hooks its strings came from, arena memory is left to the arena. */
+static void parse_discard(const parse_buffer * const buffer, cJSON * const head)
+{
+    cJSON *item = NULL;
+
+    if ((head == NULL) || (buffer->arena != NULL))
+    {
+        return;
+    }
+
+    /* the item that failed wasn't claimed, but its node may be pooled and any string it got may point into the input or the table */
+    for (item = head; item != NULL; item = item->next)
+    {
+        if (buffer->pooled)
+        {
+            item->type |= cJSON_Pooled;
+        }
+        if (buffer->insitu || (buffer->intern != NULL))
+        {
+            item->type |= (buffer->insitu ? cJSON_InSitu : cJSON_Interned) | cJSON_StringIsConst;
+        }
+    }
+
+    delete_item(head, &buffer->hooks);
+}
+
+/* check if the given size is left to read in a given parse buffer (starting with 1) */
+#define can_read(buffer, size) ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
+/* check if the buffer can be accessed at the given index (starting with 0) */
+#define can_access_at_index(buffer, index) ((buffer != NULL) && (((buffer)->offset + index) < (buffer)->length))
+#define cannot_access_at_index(buffer, index) (!can_access_at_index(buffer, index))
+/* get a pointer to the buffer at the position */
+#define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
+
+/* Powers of ten that a double holds exactly. */
+static const double exact_powers_of_ten[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define is_digit(c) (((c) >= '0') && ((c) <= '9'))
+/* 2^53, integers up to this are exact in a double */
+#define max_exact_integer 9007199254740992ULL
+
+/*
+ * Convert number, the length characters strtod would be handed, without strtod. Only plain
+ * -d[.d][e[+-]d] text that takes up all of number is handled, and only where the result is
+ * exact or the product of two exact doubles, so it is rounded exactly like strtod would.
+ * Returns false if strtod has to do it.
+ */
+static cJSON_bool parse_number_fast(const unsigned char * const number, const size_t length, double * const result)
+{
+    unsigned long long mantissa = 0;
+    size_t significant_digits = 0;
+    size_t fraction_digits = 0;
+    size_t position = 0;
+    cJSON_bool negative = false;
+    cJSON_bool plain_integer = true;
+    long exponent = 0;
+    cJSON_bool negative_exponent = false;
+    double value = 0;
+
+    if (number[0] == '-')
+    {
+        negative = true;
+        position++;
+    }
+
+    if ((position >= length) || !is_digit(number[position]))
+    {
+        return false;
+    }
+
+    for (; (position < length) && is_digit(number[position]); position++)
+    {
+        if ((mantissa != 0) || (number[position] != '0'))
+        {
+            if (++significant_digits > 19)
+            {
+                return false;
+            }
+            mantissa = (mantissa * 10) + (unsigned long long)(number[position] - '0');
+        }
+    }
+
+    if ((position < length) && (number[position] == '.'))
+    {
+        plain_integer = false;
+        position++;
+        if ((position >= length) || !is_digit(number[position]))
+        {
+            return false;
+        }
+        for (; (position < length) && is_digit(number[position]); position++)
+        {
+            fraction_digits++;
+            if ((mantissa != 0) || (number[position] != '0'))
+            {
+                if (++significant_digits > 19)
+                {
+                    return false;
+                }
+                mantissa = (mantissa * 10) + (unsigned long long)(number[position] - '0');
+            }
+        }
+    }
+
+    if ((position < length) && ((number[position] == 'e') || (number[position] == 'E')))
+    {
+        plain_integer = false;
+        position++;
+        if ((position < length) && ((number[position] == '+') || (number[position] == '-')))
+        {
+            negative_exponent = (number[position] == '-');
+            position++;
+        }
+        if ((position >= length) || !is_digit(number[position]))
+        {
+            return false;
+        }
+        for (; (position < length) && is_digit(number[position]); position++)
+        {
+            exponent = (exponent * 10) + (number[position] - '0');
+            if (exponent > 10000)
+            {
+                return false;
+            }
+        }
+    }
+
+    if (position != length)
+    {
+        /* strtod would stop early or read something else */
+        return false;
+    }
+
+    if (negative_exponent)
+    {
+        exponent = -exponent;
+    }
+    exponent -= (long)fraction_digits;
+
+    if (plain_integer || (mantissa == 0))
+    {
+        /* a single rounding of an integer, same as strtod */
+        value = (double)mantissa;
+    }
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+    else if (mantissa <= max_exact_integer)
+    {
+        if ((exponent < -22) || (exponent > (22 + 15)))
+        {
+            return false;
+        }
+
+        if (exponent > 22)
+        {
+            /* move the excess into the mantissa while it stays exact */
+            unsigned long long scale = (unsigned long long)exact_powers_of_ten[exponent - 22];
+            if (mantissa > (max_exact_integer / scale))
+            {
+                return false;
+            }
+            mantissa *= scale;
+            exponent = 22;
+        }
+
+        /* both operands are exact, so the one operation rounds correctly */
+        if (exponent < 0)
+        {
+            value = (double)mantissa / exact_powers_of_ten[-exponent];
+        }
+        else
+        {
+            value = (double)mantissa * exact_powers_of_ten[exponent];
+        }
+    }
+#endif
+    else
+    {
+        return false;
+    }
+
+    *result = negative ? -value : value;
+
+    return true;
+}
+
+/* Parse the input text to generate a number, and populate the result into item. */
+static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
+{
+    double number = 0;
+    unsigned char *after_end = NULL;
+    unsigned char number_c_string[64];
+    unsigned char decimal_point = '.';
+    size_t length = 0;
+    size_t i = 0;
+
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    {
+        return false;
+    }
+
+    /* find the characters that would be handed to strtod
+     * This also takes care of '\0' not necessarily being available for marking the end of the input */
+    for (length = 0; (length < (sizeof(number_c_string) - 1)) && can_access_at_index(input_buffer, length); length++)
+    {
+        switch (buffer_at_offset(input_buffer)[length])
+        {
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            case '+':
+            case '-':
+            case 'e':
+            case 'E':
+            case '.':
+                continue;
+
+            default:
+                break;
+        }
+        break;
+    }
+
+    if ((length > 0) && parse_number_fast(buffer_at_offset(input_buffer), length, &number))
+    {
+        after_end = number_c_string + length;
+    }
+    else
+    {
+        /* copy the number into a temporary buffer and replace '.' with the decimal point
+         * of the current locale (for strtod) */
+        decimal_point = get_decimal_point();
+        for (i = 0; i < length; i++)
+        {
+            number_c_string[i] = buffer_at_offset(input_buffer)[i];
+            if (number_c_string[i] == '.')
+            {
+                number_c_string[i] = decimal_point;
+            }
+        }
+        number_c_string[i] = '\0';
+
+        number = strtod((const char*)number_c_string, (char**)&after_end);
+        if (number_c_string == after_end)
+        {
+            return false; /* parse_error */
+        }
+    }
+
+    item->valuedouble = number;
+
+    /* use saturation in case of overflow */
+    if (number >= INT_MAX)
+    {
+        item->valueint = INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        item->valueint = INT_MIN;
+    }
+    else
+    {
+        item->valueint = (int)number;
+    }
+
+    item->type = cJSON_Number;
+
+    input_buffer->offset += (size_t)(after_end - number_c_string);
+    return true;
+}
+
+/* don't ask me, but the original cJSON_SetNumberValue returns an integer or double */
+CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
+{
+    if (number >= INT_MAX)
+    {
+        object->valueint = INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        object->valueint = INT_MIN;
+    }
+    else
+    {
+        object->valueint = (int)number;
+    }
+
+    return object->valuedouble = number;
+}
+
+typedef struct
+{
+    unsigned char *buffer;
+    size_t length;
+    size_t offset;
+    size_t depth; /* current nesting depth (for formatted printing) */
+    cJSON_bool noalloc;
+    cJSON_bool format; /* is this print a formatted print */
+    internal_hooks hooks;
+    cJSON_bool unescaped; /* measured to have no string that needs escaping */
+} printbuffer;
+
+/* realloc printbuffer if necessary to have at least "needed" bytes more */
+static unsigned char* ensure(printbuffer * const p, size_t needed)
+{
+    unsigned char *newbuffer = NULL;
+    size_t newsize = 0;
+
+    if ((p == NULL) || (p->buffer == NULL))
+    {
+        return NULL;
+    }
+
+    if ((p->length > 0) && (p->offset > p->length))
+    {
+        /* make sure that offset is valid, a buffer may be exactly full */
+        return NULL;
+    }
+
+    if (needed > INT_MAX)
+    {
+        /* sizes bigger than INT_MAX are currently not supported */
+        return NULL;
+    }
+
+    /* callers count the terminator themselves where they write one, so an exactly measured buffer is enough */
+    needed += p->offset;
+    if (needed <= p->length)
+    {
+        return p->buffer + p->offset;
+    }
+
+    if (p->noalloc) {
+        return NULL;
+    }
+
+    /* calculate new buffer size */
+    if (needed > (INT_MAX / 2))
+    {
+        /* overflow of int, use INT_MAX if possible */
+        if (needed <= INT_MAX)
+        {
+            newsize = INT_MAX;
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        newsize = needed * 2;
+    }
+
+    if (p->hooks.reallocate != NULL)
+    {
+        /* reallocate with realloc if available */
+        newbuffer = (unsigned char*)p->hooks.reallocate(p->buffer, newsize);
+        if (newbuffer == NULL)
+        {
+            p->hooks.deallocate(p->buffer);
+            p->length = 0;
+            p->buffer = NULL;
+
+            return NULL;
+        }
+    }
+    else
+    {
+        /* otherwise reallocate manually */
+        newbuffer = (unsigned char*)p->hooks.allocate(newsize);
+        if (!newbuffer)
+        {
+            p->hooks.deallocate(p->buffer);
+            p->length = 0;
+            p->buffer = NULL;
+
+            return NULL;
+        }
+        if (newbuffer)
+        {
+            memcpy(newbuffer, p->buffer, p->offset + 1);
+        }
+        p->hooks.deallocate(p->buffer);
+    }
+    p->length = newsize;
+    p->buffer = newbuffer;
+
+    return newbuffer + p->offset;
+}
+
+/* calculate the new length of the string in a printbuffer and update the offset */
+static void update_offset(printbuffer * const buffer)
+{
+    const unsigned char *buffer_pointer = NULL;
+    if ((buffer == NULL) || (buffer->buffer == NULL))
+    {
+        return;
+    }
+    buffer_pointer = buffer->buffer + buffer->offset;
+
+    buffer->offset += strlen((const char*)buffer_pointer);
+}
+
+/*
+ * Shortest round-trip formatting of doubles with Grisu3 (Florian Loitsch, "Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers"). Grisu3 either finds the shortest digits that read
+ * back as the same double or says it can't, the few doubles it can't do go through sprintf.
+ */
+typedef struct
+{
+    unsigned long long f;
+    int e;
+} diy_fp;
+
+typedef struct
+{
+    unsigned long long f;
+    int e;
+    int decimal_exponent;
+} cached_power;
+
+/* normalized approximations of 10^-348, 10^-340, ... 10^340 */
+static const cached_power cached_powers[] =
+{
+    { 0xfa8fd5a0081c0288ULL, -1220, -348 },
+    { 0xbaaee17fa23ebf76ULL, -1193, -340 },
+    { 0x8b16fb203055ac76ULL, -1166, -332 },
+    { 0xcf42894a5dce35eaULL, -1140, -324 },
+    { 0x9a6bb0aa55653b2dULL, -1113, -316 },
+    { 0xe61acf033d1a45dfULL, -1087, -308 },
+    { 0xab70fe17c79ac6caULL, -1060, -300 },
+    { 0xff77b1fcbebcdc4fULL, -1034, -292 },
+    { 0xbe5691ef416bd60cULL, -1007, -284 },
+    { 0x8dd01fad907ffc3cULL, -980, -276 },
+    { 0xd3515c2831559a83ULL, -954, -268 },
+    { 0x9d71ac8fada6c9b5ULL, -927, -260 },
+    { 0xea9c227723ee8bcbULL, -901, -252 },
+    { 0xaecc49914078536dULL, -874, -244 },
+    { 0x823c12795db6ce57ULL, -847, -236 },
+    { 0xc21094364dfb5637ULL, -821, -228 },
+    { 0x9096ea6f3848984fULL, -794, -220 },
+    { 0xd77485cb25823ac7ULL, -768, -212 },
+    { 0xa086cfcd97bf97f4ULL, -741, -204 },
+    { 0xef340a98172aace5ULL, -715, -196 },
+    { 0xb23867fb2a35b28eULL, -688, -188 },
+    { 0x84c8d4dfd2c63f3bULL, -661, -180 },
+    { 0xc5dd44271ad3cdbaULL, -635, -172 },
+    { 0x936b9fcebb25c996ULL, -608, -164 },
+    { 0xdbac6c247d62a584ULL, -582, -156 },
+    { 0xa3ab66580d5fdaf6ULL, -555, -148 },
+    { 0xf3e2f893dec3f126ULL, -529, -140 },
+    { 0xb5b5ada8aaff80b8ULL, -502, -132 },
+    { 0x87625f056c7c4a8bULL, -475, -124 },
+    { 0xc9bcff6034c13053ULL, -449, -116 },
+    { 0x964e858c91ba2655ULL, -422, -108 },
+    { 0xdff9772470297ebdULL, -396, -100 },
+    { 0xa6dfbd9fb8e5b88fULL, -369, -92 },
+    { 0xf8a95fcf88747d94ULL, -343, -84 },
+    { 0xb94470938fa89bcfULL, -316, -76 },
+    { 0x8a08f0f8bf0f156bULL, -289, -68 },
+    { 0xcdb02555653131b6ULL, -263, -60 },
+    { 0x993fe2c6d07b7facULL, -236, -52 },
+    { 0xe45c10c42a2b3b06ULL, -210, -44 },
+    { 0xaa242499697392d3ULL, -183, -36 },
+    { 0xfd87b5f28300ca0eULL, -157, -28 },
+    { 0xbce5086492111aebULL, -130, -20 },
+    { 0x8cbccc096f5088ccULL, -103, -12 },
+    { 0xd1b71758e219652cULL, -77, -4 },
+    { 0x9c40000000000000ULL, -50, 4 },
+    { 0xe8d4a51000000000ULL, -24, 12 },
+    { 0xad78ebc5ac620000ULL, 3, 20 },
+    { 0x813f3978f8940984ULL, 30, 28 },
+    { 0xc097ce7bc90715b3ULL, 56, 36 },
+    { 0x8f7e32ce7bea5c70ULL, 83, 44 },
+    { 0xd5d238a4abe98068ULL, 109, 52 },
+    { 0x9f4f2726179a2245ULL, 136, 60 },
+    { 0xed63a231d4c4fb27ULL, 162, 68 },
+    { 0xb0de65388cc8ada8ULL, 189, 76 },
+    { 0x83c7088e1aab65dbULL, 216, 84 },
+    { 0xc45d1df942711d9aULL, 242, 92 },
+    { 0x924d692ca61be758ULL, 269, 100 },
+    { 0xda01ee641a708deaULL, 295, 108 },
+    { 0xa26da3999aef774aULL, 322, 116 },
+    { 0xf209787bb47d6b85ULL, 348, 124 },
+    { 0xb454e4a179dd1877ULL, 375, 132 },
+    { 0x865b86925b9bc5c2ULL, 402, 140 },
+    { 0xc83553c5c8965d3dULL, 428, 148 },
+    { 0x952ab45cfa97a0b3ULL, 455, 156 },
+    { 0xde469fbd99a05fe3ULL, 481, 164 },
+    { 0xa59bc234db398c25ULL, 508, 172 },
+    { 0xf6c69a72a3989f5cULL, 534, 180 },
+    { 0xb7dcbf5354e9beceULL, 561, 188 },
+    { 0x88fcf317f22241e2ULL, 588, 196 },
+    { 0xcc20ce9bd35c78a5ULL, 614, 204 },
+    { 0x98165af37b2153dfULL, 641, 212 },
+    { 0xe2a0b5dc971f303aULL, 667, 220 },
+    { 0xa8d9d1535ce3b396ULL, 694, 228 },
+    { 0xfb9b7cd9a4a7443cULL, 720, 236 },
+    { 0xbb764c4ca7a44410ULL, 747, 244 },
+    { 0x8bab8eefb6409c1aULL, 774, 252 },
+    { 0xd01fef10a657842cULL, 800, 260 },
+    { 0x9b10a4e5e9913129ULL, 827, 268 },
+    { 0xe7109bfba19c0c9dULL, 853, 276 },
+    { 0xac2820d9623bf429ULL, 880, 284 },
+    { 0x80444b5e7aa7cf85ULL, 907, 292 },
+    { 0xbf21e44003acdd2dULL, 933, 300 },
+    { 0x8e679c2f5e44ff8fULL, 960, 308 },
+    { 0xd433179d9c8cb841ULL, 986, 316 },
+    { 0x9e19db92b4e31ba9ULL, 1013, 324 },
+    { 0xeb96bf6ebadf77d9ULL, 1039, 332 },
+    { 0xaf87023b9bf0ee6bULL, 1066, 340 }
+};
+
+#define cached_powers_offset 348
+#define cached_powers_distance 8
+#define grisu_min_target_exponent (-60)
+#define grisu_significand_size 64
+#define double_hidden_bit 0x0010000000000000ULL
+#define double_significand_mask 0x000FFFFFFFFFFFFFULL
+
+static diy_fp diy_fp_multiply(const diy_fp x, const diy_fp y)
+{
+    const unsigned long long mask32 = 0xFFFFFFFFULL;
+    unsigned long long a = x.f >> 32;
+    unsigned long long b = x.f & mask32;
+    unsigned long long c = y.f >> 32;
+    unsigned long long d = y.f & mask32;
+    unsigned long long tmp = ((b * d) >> 32) + ((a * d) & mask32) + ((b * c) & mask32);
+    diy_fp result;
+
+    tmp += 1ULL << 31; /* round */
+    result.f = (a * c) + ((a * d) >> 32) + ((b * c) >> 32) + (tmp >> 32);
+    result.e = x.e + y.e + 64;
+
+    return result;
+}
+
+static diy_fp diy_fp_normalize(diy_fp x)
+{
+    while (!(x.f & 0x8000000000000000ULL))
+    {
+        x.f <<= 1;
+        x.e--;
+    }
+
+    return x;
+}
+
+static int grisu_round_weed(unsigned char * const buffer, const int length, const unsigned long long distance_too_high_w, const unsigned long long unsafe_interval, unsigned long long rest, const unsigned long long ten_kappa, const unsigned long long unit)
+{
+    const unsigned long long small_distance = distance_too_high_w - unit;
+    const unsigned long long big_distance = distance_too_high_w + unit;
+
+    /* move the last digit down while that gets closer to the real value */
+    while ((rest < small_distance) && ((unsafe_interval - rest) >= ten_kappa) && (((rest + ten_kappa) < small_distance) || ((small_distance - rest) >= (rest + ten_kappa - small_distance))))
+    {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+
+    /* not sure which of two candidates is closer */
+    if ((rest < big_distance) && ((unsafe_interval - rest) >= ten_kappa) && (((rest + ten_kappa) < big_distance) || ((big_distance - rest) > (rest + ten_kappa - big_distance))))
+    {
+        return false;
+    }
+
+    return ((2 * unit) <= rest) && (rest <= (unsafe_interval - (4 * unit)));
+}
+
+/* Generate the digits of w, which lies between low and high (all scaled), into buffer. */
+static int grisu_digit_gen(const diy_fp low, const diy_fp w, const diy_fp high, unsigned char * const buffer, int * const length, int * const kappa)
+{
+    static const unsigned int powers_of_ten[] = { 0, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    unsigned long long unit = 1;
+    unsigned long long too_low = low.f - unit;
+    unsigned long long too_high = high.f + unit;
+    unsigned long long unsafe_interval = too_high - too_low;
+    unsigned long long one = 1ULL << -w.e;
+    unsigned int integrals = (unsigned int)(too_high >> -w.e);
+    unsigned long long fractionals = too_high & (one - 1);
+    unsigned long long rest = 0;
+    unsigned int divisor = 0;
+    int digits = 10;
+
+    while ((digits > 0) && (integrals < powers_of_ten[digits]))
+    {
+        digits--;
+    }
+    divisor = powers_of_ten[digits];
+    *kappa = digits;
+    *length = 0;
+
+    while (*kappa > 0)
+    {
+        buffer[(*length)++] = (unsigned char)('0' + (integrals / divisor));
+        integrals %= divisor;
+        (*kappa)--;
+        rest = ((unsigned long long)integrals << -w.e) + fractionals;
+        if (rest < unsafe_interval)
+        {
+            return grisu_round_weed(buffer, *length, too_high - w.f, unsafe_interval, rest, (unsigned long long)divisor << -w.e, unit);
+        }
+        divisor /= 10;
+    }
+
+    for (;;)
+    {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        buffer[(*length)++] = (unsigned char)('0' + (fractionals >> -w.e));
+        fractionals &= one - 1;
+        (*kappa)--;
+        if (fractionals < unsafe_interval)
+        {
+            return grisu_round_weed(buffer, *length, (too_high - w.f) * unit, unsafe_interval, fractionals, one, unit);
+        }
+    }
+}
+
+/* Shortest digits of the positive, finite, non zero number d, so that d = digits * 10^exponent. */
+static cJSON_bool grisu3(const double d, unsigned char * const digits, int * const length, int * const exponent)
+{
+    unsigned long long bits = 0;
+    diy_fp v;
+    diy_fp w;
+    diy_fp plus;
+    diy_fp minus;
+    diy_fp power;
+    int biased_exponent = 0;
+    int kappa = 0;
+    int index = 0;
+    double k = 0;
+
+    memcpy(&bits, &d, sizeof(bits));
+    biased_exponent = (int)((bits >> 52) & 0x7FF);
+    if (biased_exponent == 0)
+    {
+        v.f = bits & double_significand_mask;
+        v.e = -1074;
+    }
+    else
+    {
+        v.f = (bits & double_significand_mask) + double_hidden_bit;
+        v.e = biased_exponent - 1075;
+    }
+
+    /* the boundaries halfway to the neighbouring doubles */
+    plus.f = (v.f << 1) + 1;
+    plus.e = v.e - 1;
+    plus = diy_fp_normalize(plus);
+    if ((v.f == double_hidden_bit) && (biased_exponent > 1))
+    {
+        minus.f = (v.f << 2) - 1;
+        minus.e = v.e - 2;
+    }
+    else
+    {
+        minus.f = (v.f << 1) - 1;
+        minus.e = v.e - 1;
+    }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+    w = diy_fp_normalize(v);
+
+    /* pick the power of ten that scales w into the target exponent range */
+    k = ceil((grisu_min_target_exponent - (w.e + grisu_significand_size) + grisu_significand_size - 1) * 0.30102999566398114);
+    index = ((cached_powers_offset + (int)k - 1) / cached_powers_distance) + 1;
+    power.f = cached_powers[index].f;
+    power.e = cached_powers[index].e;
+
+    if (!grisu_digit_gen(diy_fp_multiply(minus, power), diy_fp_multiply(w, power), diy_fp_multiply(plus, power), digits, length, &kappa))
+    {
+        return false;
+    }
+
+    *exponent = kappa - cached_powers[index].decimal_exponent;
+
+    return true;
+}
+
+/* The same digits from sprintf, for when grisu3 gives up. */
+static void shortest_digits_sprintf(const double d, unsigned char * const digits, int * const length, int * const exponent)
+{
+    char printed[32];
+    double test = 0;
+    int precision = 0;
+    int i = 0;
+    char *pointer = NULL;
+
+    for (precision = 1; precision < 17; precision++)
+    {
+        sprintf(printed, "%.*e", precision - 1, d);
+        if ((sscanf(printed, "%lg", &test) == 1) && (test == d))
+        {
+            break;
+        }
+    }
+    sprintf(printed, "%.*e", precision - 1, d);
+
+    *length = 0;
+    for (pointer = printed; *pointer != 'e'; pointer++)
+    {
+        if ((*pointer >= '0') && (*pointer <= '9'))
+        {
+            digits[(*length)++] = (unsigned char)*pointer;
+        }
+    }
+    i = atoi(pointer + 1);
+    *exponent = i - (*length - 1);
+}
+
+/* Render the number the way printf's %g did with precision 15, or 17 where 15 digits weren't enough. */
+static int format_digits(unsigned char * const output, const cJSON_bool negative, unsigned char * const digits, int length, int exponent)
+{
+    unsigned char *pointer = output;
+    int leading = 0; /* exponent of the first digit */
+    int precision = 0;
+    int i = 0;
+
+    /* drop trailing zeros, %g doesn't print them either */
+    while ((length > 1) && (digits[length - 1] == '0'))
+    {
+        length--;
+        exponent++;
+    }
+
+    leading = exponent + length - 1;
+    precision = (length <= 15) ? 15 : 17;
+
+    if (negative)
+    {
+        *pointer++ = '-';
+    }
+
+    if ((leading < -4) || (leading >= precision))
+    {
+        *pointer++ = digits[0];
+        if (length > 1)
+        {
+            *pointer++ = '.';
+            memcpy(pointer, digits + 1, (size_t)(length - 1));
+            pointer += length - 1;
+        }
+        pointer += sprintf((char*)pointer, "e%c%02d", (leading < 0) ? '-' : '+', (leading < 0) ? -leading : leading);
+    }
+    else if (leading < 0)
+    {
+        *pointer++ = '0';
+        *pointer++ = '.';
+        for (i = -1; i > leading; i--)
+        {
+            *pointer++ = '0';
+        }
+        memcpy(pointer, digits, (size_t)length);
+        pointer += length;
+    }
+    else
+    {
+        for (i = 0; (i < length) || (i <= leading); i++)
+        {
+            if (i == (leading + 1))
+            {
+                *pointer++ = '.';
+            }
+            *pointer++ = (i < length) ? digits[i] : (unsigned char)'0';
+        }
+    }
+
+    *pointer = '\0';
+
+    return (int)(pointer - output);
+}
+
+#define number_buffer_size 26
+
+/* Render d into number_buffer (number_buffer_size bytes), returns the length or -1. */
+static int format_number(double d, unsigned char * const number_buffer)
+{
+    int length = 0;
+    unsigned char digits[20];
+    int digit_count = 0;
+    int exponent = 0;
+    cJSON_bool negative = false;
+    unsigned long long integer = 0;
+
+    /* This checks for NaN and Infinity */
+    if ((d * 0) != 0)
+    {
+        memcpy(number_buffer, "null", sizeof("null"));
+        return static_strlen("null");
+    }
+
+    negative = (d < 0) || ((d == 0) && (1 / d < 0));
+    if (negative)
+    {
+        d = -d;
+    }
+
+    if ((d <= (double)max_exact_integer) && ((double)(unsigned long long)d == d))
+    {
+        /* integral values fit in an integer and have no fraction to round */
+        integer = (unsigned long long)d;
+        do
+        {
+            digits[sizeof(digits) - 1 - (size_t)digit_count++] = (unsigned char)('0' + (integer % 10));
+            integer /= 10;
+        } while (integer != 0);
+        memmove(digits, digits + sizeof(digits) - digit_count, (size_t)digit_count);
+        exponent = 0;
+    }
+    else if (!grisu3(d, digits, &digit_count, &exponent))
+    {
+        shortest_digits_sprintf(d, digits, &digit_count, &exponent);
+    }
+
+    length = format_digits(number_buffer, negative, digits, digit_count, exponent);
+
+    /* buffer overrun occurred */
+    if ((length < 0) || (length > (number_buffer_size - 1)))
+    {
+        return -1;
+    }
+
+    return length;
+}
+
+/* Render the number nicely from the given item into a string. */
+static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    int length = 0;
+    unsigned char number_buffer[number_buffer_size]; /* temporary buffer to print the number into */
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    length = format_number(item->valuedouble, number_buffer);
+    if (length < 0)
+    {
+        return false;
+    }
+
+    /* reserve appropriate space in the output */
+    output_pointer = ensure(output_buffer, (size_t)length + sizeof(""));
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+
+    memcpy(output_pointer, number_buffer, (size_t)length + sizeof(""));
+
+    output_buffer->offset += (size_t)length;
+
+    return true;
+}
+
+/* parse 4 digit hexadecimal number */
+static unsigned parse_hex4(const unsigned char * const input)
+{
+    unsigned int h = 0;
+    size_t i = 0;
+
+    for (i = 0; i < 4; i++)
+    {
+        /* parse digit */
+        if ((input[i] >= '0') && (input[i] <= '9'))
+        {
+            h += (unsigned int) input[i] - '0';
+        }
+        else if ((input[i] >= 'A') && (input[i] <= 'F'))
+        {
+            h += (unsigned int) 10 + input[i] - 'A';
+        }
+        else if ((input[i] >= 'a') && (input[i] <= 'f'))
+        {
+            h += (unsigned int) 10 + input[i] - 'a';
+        }
+        else /* invalid */
+        {
+            return 0;
+        }
+
+        if (i < 3)
+        {
+            /* shift left to make place for the next nibble */
+            h = h << 4;
+        }
+    }
+
+    return h;
+}
+
+/* converts a UTF-16 literal to UTF-8
+ * A literal can be one or two sequences of the form \uXXXX */
+static unsigned char utf16_literal_to_utf8(const unsigned char * const input_pointer, const unsigned char * const input_end, unsigned char **output_pointer)
+{
+    long unsigned int codepoint = 0;
+    unsigned int first_code = 0;
+    const unsigned char *first_sequence = input_pointer;
+    unsigned char utf8_length = 0;
+    unsigned char utf8_position = 0;
+    unsigned char sequence_length = 0;
+    unsigned char first_byte_mark = 0;
+
+    if ((input_end - first_sequence) < 6)
+    {
+        /* input ends unexpectedly */
+        goto fail;
+    }
+
+    /* get the first utf16 sequence */
+    first_code = parse_hex4(first_sequence + 2);
+
+    /* check that the code is valid */
+    if (((first_code >= 0xDC00) && (first_code <= 0xDFFF)))
+    {
+        goto fail;
+    }
+
+    /* UTF16 surrogate pair */
+    if ((first_code >= 0xD800) && (first_code <= 0xDBFF))
+    {
+        const unsigned char *second_sequence = first_sequence + 6;
+        unsigned int second_code = 0;
+        sequence_length = 12; /* \uXXXX\uXXXX */
+
+        if ((input_end - second_sequence) < 6)
+        {
+            /* input ends unexpectedly */
+            goto fail;
+        }
+
+        if ((second_sequence[0] != '\\') || (second_sequence[1] != 'u'))
+        {
+            /* missing second half of the surrogate pair */
+            goto fail;
+        }
+
+        /* get the second utf16 sequence */
+        second_code = parse_hex4(second_sequence + 2);
+        /* check that the code is valid */
+        if ((second_code < 0xDC00) || (second_code > 0xDFFF))
+        {
+            /* invalid second half of the surrogate pair */
+            goto fail;
+        }
+
+
+        /* calculate the unicode codepoint from the surrogate pair */
+        codepoint = 0x10000 + (((first_code & 0x3FF) << 10) | (second_code & 0x3FF));
+    }
+    else
+    {
+        sequence_length = 6; /* \uXXXX */
+        codepoint = first_code;
+    }
+
+    /* encode as UTF-8
+     * takes at maximum 4 bytes to encode:
+     * 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx */
+    if (codepoint < 0x80)
+    {
+        /* normal ascii, encoding 0xxxxxxx */
+        utf8_length = 1;
+    }
+    else if (codepoint < 0x800)
+    {
+        /* two bytes, encoding 110xxxxx 10xxxxxx */
+        utf8_length = 2;
+        first_byte_mark = 0xC0; /* 11000000 */
+    }
+    else if (codepoint < 0x10000)
+    {
+        /* three bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx */
+        utf8_length = 3;
+        first_byte_mark = 0xE0; /* 11100000 */
+    }
+    else if (codepoint <= 0x10FFFF)
+    {
+        /* four bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx 10xxxxxx */
+        utf8_length = 4;
+        first_byte_mark = 0xF0; /* 11110000 */
+    }
+    else
+    {
+        /* invalid unicode codepoint */
+        goto fail;
+    }
+
+    /* encode as utf8 */
+    for (utf8_position = (unsigned char)(utf8_length - 1); utf8_position > 0; utf8_position--)
+    {
+        /* 10xxxxxx */
+        (*output_pointer)[utf8_position] = (unsigned char)((codepoint | 0x80) & 0xBF);
+        codepoint >>= 6;
+    }
+    /* encode first byte */
+    if (utf8_length > 1)
+    {
+        (*output_pointer)[0] = (unsigned char)((codepoint | first_byte_mark) & 0xFF);
+    }
+    else
+    {
+        (*output_pointer)[0] = (unsigned char)(codepoint & 0x7F);
+    }
+
+    *output_pointer += utf8_length;
+
+    return sequence_length;
+
+fail:
+    return 0;
+}
+
+/*
+ * Scanners over length bytes at pointer. scan_string returns the offset of the first quote or backslash,
+ * scan_whitespace that of the first byte that is not whitespace (> 32). Both return length if there is none.
+ * The vector variants look at 16 or 32 bytes at once and leave the tail to the plain ones.
+ */
+typedef size_t (*scan_function)(const unsigned char * const pointer, const size_t length);
+
+static size_t scan_string_scalar(const unsigned char * const pointer, const size_t length)
+{
+    size_t i = 0;
+
+    while ((i < length) && (pointer[i] != '\"') && (pointer[i] != '\\'))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+static size_t scan_whitespace_scalar(const unsigned char * const pointer, const size_t length)
+{
+    size_t i = 0;
+
+    while ((i < length) && (pointer[i] <= 32))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+#ifdef CJSON_SIMD_X86
+static size_t scan_string_sse2(const unsigned char * const pointer, const size_t length)
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    size_t i = 0;
+
+    for (; (i + 16) <= length; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)(pointer + i));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    return i + scan_string_scalar(pointer + i, length - i);
+}
+
+static size_t scan_whitespace_sse2(const unsigned char * const pointer, const size_t length)
+{
+    const __m128i space = _mm_set1_epi8(32);
+    size_t i = 0;
+
+    for (; (i + 16) <= length; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)(pointer + i));
+        /* max(byte, 32) == 32 exactly for the whitespace bytes */
+        unsigned int mask = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(chunk, space), space)) & 0xffffU;
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    return i + scan_whitespace_scalar(pointer + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_string_avx2(const unsigned char * const pointer, const size_t length)
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    size_t i = 0;
+
+    for (; (i + 32) <= length; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(const void*)(pointer + i));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    /* the tail stays in this function, calling the SSE2 code with dirty upper registers costs more than it saves */
+    if ((i + 16) <= length)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)(pointer + i));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(quote)), _mm_cmpeq_epi8(chunk, _mm256_castsi256_si128(backslash))));
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+        i += 16;
+    }
+
+    return i + scan_string_scalar(pointer + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_whitespace_avx2(const unsigned char * const pointer, const size_t length)
+{
+    const __m256i space = _mm256_set1_epi8(32);
+    size_t i = 0;
+
+    for (; (i + 32) <= length; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(const void*)(pointer + i));
+        unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(chunk, space), space));
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+    }
+
+    if ((i + 16) <= length)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)(pointer + i));
+        unsigned int mask = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(chunk, _mm256_castsi256_si128(space)), _mm256_castsi256_si128(space))) & 0xffffU;
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz(mask);
+        }
+        i += 16;
+    }
+
+    return i + scan_whitespace_scalar(pointer + i, length - i);
+}
+
+static scan_function scan_string = scan_string_sse2;
+static scan_function scan_whitespace = scan_whitespace_sse2;
+
+/* pick the kernels once, before main runs */
+__attribute__((constructor))
+static void select_scanners(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        scan_string = scan_string_avx2;
+        scan_whitespace = scan_whitespace_avx2;
+    }
+}
+#elif defined(CJSON_SIMD_NEON)
+static size_t scan_string_neon(const unsigned char * const pointer, const size_t length)
+{
+    const uint8x16_t quote = vdupq_n_u8('\"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    size_t i = 0;
+
+    for (; (i + 16) <= length; i += 16)
+    {
+        uint8x16_t chunk = vld1q_u8(pointer + i);
+        if (vmaxvq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash))) != 0)
+        {
+            /* there is no movemask, find the byte within the chunk */
+            break;
+        }
+    }
+
+    return i + scan_string_scalar(pointer + i, length - i);
+}
+
+static size_t scan_whitespace_neon(const unsigned char * const pointer, const size_t length)
+{
+    const uint8x16_t space = vdupq_n_u8(32);
+    size_t i = 0;
+
+    for (; (i + 16) <= length; i += 16)
+    {
+        if (vminvq_u8(vcleq_u8(vld1q_u8(pointer + i), space)) == 0)
+        {
+            break;
+        }
+    }
+
+    return i + scan_whitespace_scalar(pointer + i, length - i);
+}
+
+static scan_function scan_string = scan_string_neon;
+static scan_function scan_whitespace = scan_whitespace_neon;
+#else
+static scan_function scan_string = scan_string_scalar;
+static scan_function scan_whitespace = scan_whitespace_scalar;
+#endif
+
+/* Decode the escape sequences of the string contents [*input, input_end) into *output, which may be *input itself.
+ * Both pointers are advanced, on failure *input is left at the offending sequence. */
+static cJSON_bool decode_string(const unsigned char **input, const unsigned char * const input_end, unsigned char **output)
+{
+    const unsigned char *in = *input;
+    unsigned char *out = *output;
+
+    while (in < input_end)
+    {
+        if (*in != '\\')
+        {
+            /* copy everything up to the next escape sequence at once */
+            size_t run = scan_string(in, (size_t)(input_end - in));
+            if (run == 0)
+            {
+                run = 1; /* a stray quote, copied on its own as before */
+            }
+            if (out != in)
+            {
+                memmove(out, in, run);
+            }
+            out += run;
+            in += run;
+        }
+        /* escape sequence */
+        else
+        {
+            unsigned char sequence_length = 2;
+            if ((input_end - in) < 2)
+            {
+                goto fail;
+            }
+
+            switch (in[1])
+            {
+                case 'b':
+                    *out++ = '\b';
+                    break;
+                case 'f':
+                    *out++ = '\f';
+                    break;
+                case 'n':
+                    *out++ = '\n';
+                    break;
+                case 'r':
+                    *out++ = '\r';
+                    break;
+                case 't':
+                    *out++ = '\t';
+                    break;
+                case '\"':
+                case '\\':
+                case '/':
+                    *out++ = in[1];
+                    break;
+
+                /* UTF-16 literal */
+                case 'u':
+                    sequence_length = utf16_literal_to_utf8(in, input_end, &out);
+                    if (sequence_length == 0)
+                    {
+                        /* failed to convert UTF16-literal to UTF-8 */
+                        goto fail;
+                    }
+                    break;
+
+                default:
+                    goto fail;
+            }
+            in += sequence_length;
+        }
+    }
+
+
+    *input = in;
+    *output = out;
+
+    return true;
+
+fail:
+    *input = in;
+
+    return false;
+}
+
+/* Parse the input text into an unescaped cinput, and populate item. */
+static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+{
+    const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
+    const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
+    unsigned char *output_pointer = NULL;
+    unsigned char *output = NULL;
+    unsigned char short_string[CJSON_INTERN_MAX_LENGTH + sizeof("")];
+
+    /* not a string */
+    if (buffer_at_offset(input_buffer)[0] != '\"')
+    {
+        goto fail;
+    }
+
+    {
+        /* calculate approximate size of the output (overestimate) */
+        size_t allocation_length = 0;
+        size_t skipped_bytes = 0;
+        while ((size_t)(input_end - input_buffer->content) < input_buffer->length)
+        {
+            /* skip to the next quote or backslash */
+            input_end += scan_string(input_end, input_buffer->length - (size_t)(input_end - input_buffer->content));
+            if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end == '\"'))
+            {
+                break;
+            }
+
+            /* is escape sequence */
+            if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
+            {
+                /* prevent buffer overflow when last input character is a backslash */
+                goto fail;
+            }
+            skipped_bytes++;
+            input_end += 2;
+        }
+        if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
+        {
+            goto fail; /* string ended unexpectedly */
+        }
+
+        /* This is at most how much we need for the output */
+        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
+        if (input_buffer->insitu)
+        {
+            /* decoding never makes a string longer, and the closing quote makes room for the terminator */
+            output = (unsigned char*)cast_away_const(input_pointer);
+        }
+        else if (input_buffer->intern != NULL)
+        {
+            /* short strings are decoded here to be looked up, longer ones are kept once each */
+            if (allocation_length <= input_buffer->intern->max_length)
+            {
+                output = short_string;
+            }
+            else
+            {
+                output = (unsigned char*)intern_store(input_buffer->intern, allocation_length + sizeof(""));
+            }
+        }
+        else
+        {
+            output = (unsigned char*)parse_allocate(input_buffer, allocation_length + sizeof(""));
+        }
+        if (output == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+    }
+
+    output_pointer = output;
+    if (!decode_string(&input_pointer, input_end, &output_pointer))
+    {
+        goto fail;
+    }
+
+    /* zero terminate the output */
+    *output_pointer = '\0';
+
+    if (output == short_string)
+    {
+        output = (unsigned char*)cast_away_const(intern_string(input_buffer->intern, short_string, (size_t)(output_pointer - short_string)));
+        if (output == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+    }
+
+    item->type = cJSON_String;
+    item->valuestring = (char*)output;
+
+    input_buffer->offset = (size_t) (input_end - input_buffer->content);
+    input_buffer->offset++;
+
+    return true;
+
+fail:
+    if ((output != NULL) && (input_buffer->arena == NULL) && !input_buffer->insitu && (input_buffer->intern == NULL))
+    {
+        input_buffer->hooks.deallocate(output);
+    }
+
+    if (input_pointer != NULL)
+    {
+        input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
+    }
+
+    return false;
+}
+
+/* Render the cstring provided to an escaped version that can be printed. */
+static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
+{
+    const unsigned char *input_pointer = NULL;
+    unsigned char *output = NULL;
+    unsigned char *output_pointer = NULL;
+    size_t output_length = 0;
+    /* numbers of additional characters needed for escaping */
+    size_t escape_characters = 0;
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* empty string */
+    if (input == NULL)
+    {
+        output = ensure(output_buffer, sizeof("\"\""));
+        if (output == NULL)
+        {
+            return false;
+        }
+        strcpy((char*)output, "\"\"");
+        output_buffer->offset += 2;
+
+        return true;
+    }
+
+    if (output_buffer->unescaped)
+    {
+        /* the measuring pass found nothing to escape */
+        input_pointer = input + strlen((const char*)input);
+    }
+    else
+    {
+        /* set "flag" to 1 if something needs to be escaped */
+        for (input_pointer = input; *input_pointer; input_pointer++)
+        {
+            switch (*input_pointer)
+            {
+                case '\"':
+                case '\\':
+                case '\b':
+                case '\f':
+                case '\n':
+                case '\r':
+                case '\t':
+                    /* one character escape sequence */
+                    escape_characters++;
+                    break;
+                default:
+                    if (*input_pointer < 32)
+                    {
+                        /* UTF-16 escape sequence uXXXX */
+                        escape_characters += 5;
+                    }
+                    break;
+            }
+        }
+    }
+    output_length = (size_t)(input_pointer - input) + escape_characters;
+
+    output = ensure(output_buffer, output_length + sizeof("\"\""));
+    if (output == NULL)
+    {
+        return false;
+    }
+
+    /* no characters have to be escaped */
+    if (escape_characters == 0)
+    {
+        output[0] = '\"';
+        memcpy(output + 1, input, output_length);
+        output[output_length + 1] = '\"';
+        output[output_length + 2] = '\0';
+        /* saves the caller's update_offset a pass over the string */
+        output_buffer->offset += output_length + 2;
+
+        return true;
+    }
+
+    output[0] = '\"';
+    output_pointer = output + 1;
+    /* copy the string */
+    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+    {
+        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        {
+            /* normal character, copy */
+            *output_pointer = *input_pointer;
+        }
+        else
+        {
+            /* character needs to be escaped */
+            *output_pointer++ = '\\';
+            switch (*input_pointer)
+            {
+                case '\\':
+                    *output_pointer = '\\';
+                    break;
+                case '\"':
+                    *output_pointer = '\"';
+                    break;
+                case '\b':
+                    *output_pointer = 'b';
+                    break;
+                case '\f':
+                    *output_pointer = 'f';
+                    break;
+                case '\n':
+                    *output_pointer = 'n';
+                    break;
+                case '\r':
+                    *output_pointer = 'r';
+                    break;
+                case '\t':
+                    *output_pointer = 't';
+                    break;
+                default:
+                    /* escape and print as unicode codepoint */
+                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
+                    output_pointer += 4;
+                    break;
+            }
+        }
+    }
+    output[output_length + 1] = '\"';
+    output[output_length + 2] = '\0';
+    output_buffer->offset += output_length + 2;
+
+    return true;
+}
+
+/* Invoke print_string_ptr (which is useful) on an item. */
+static cJSON_bool print_string(const cJSON * const item, printbuffer * const p)
+{
+    return print_string_ptr((unsigned char*)item->valuestring, p);
+}
+
+/* Predeclare these prototypes. */
+static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer);
+static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer);
+static cJSON_bool measure_value(const cJSON * const item, const size_t depth, const cJSON_bool format, size_t * const length, size_t * const escapes);
+
+/* Utility to jump whitespace and cr/lf */
+static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
+{
+    if ((buffer == NULL) || (buffer->content == NULL))
+    {
+        return NULL;
+    }
+
+    /* most runs are empty, don't bother the scanner with those */
+    if (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+    {
+        buffer->offset += scan_whitespace(buffer_at_offset(buffer), buffer->length - buffer->offset);
+
+        /* stop on the last whitespace byte, but never step back onto a value that ended right at the end of a span */
+        if (buffer->offset == buffer->length)
+        {
+            buffer->offset--;
+        }
+    }
+
+    return buffer;
+}
+
+/* skip the UTF-8 BOM (byte order mark) if it is at the beginning of a buffer */
+static parse_buffer *skip_utf8_bom(parse_buffer * const buffer)
+{
+    if ((buffer == NULL) || (buffer->content == NULL) || (buffer->offset != 0))
+    {
+        return NULL;
+    }
+
+    if (can_read(buffer, 3) && (strncmp((const char*)buffer_at_offset(buffer), "\xEF\xBB\xBF", 3) == 0))
+    {
+        buffer->offset += 3;
+    }
+
+    return buffer;
+}
+
+/* Parse an object - create a new root, and populate. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return cJSON_ParseWithOptsInArena(value, return_parse_end, require_null_terminated, NULL);
+}
+
+/* Parse the document the buffer was set up with, leaving buffer->offset at its end or at the error, which also goes to parse_error. */
+static cJSON *parse_document(parse_buffer * const buffer, cJSON_bool require_end, error * const parse_error)
+{
+    cJSON *item = NULL;
+
+    /* reset error position */
+    parse_error->json = NULL;
+    parse_error->position = 0;
+
+    if ((buffer->content == NULL) || (buffer->length == 0))
+    {
+        goto fail;
+    }
+
+    item = parse_new_item(buffer);
+    if (item == NULL) /* memory fail */
+    {
+        goto fail;
+    }
+
+    if (!parse_value(item, buffer_skip_whitespace(skip_utf8_bom(buffer))))
+    {
+        /* parse failure. ep is set. */
+        goto fail;
+    }
+    parse_claim(buffer, item);
+
+    /* if we require the JSON to end here, skip whitespace and check that nothing else follows */
+    if (require_end)
+    {
+        buffer_skip_whitespace(buffer);
+        if ((buffer->offset >= buffer->length) || (buffer_at_offset(buffer)[0] > 32))
+        {
+            goto fail;
+        }
+    }
+
+    return item;
+
+fail:
+    parse_discard(buffer, item);
+
+    if (buffer->content != NULL)
+    {
+        error local_error;
+        local_error.json = buffer->content;
+        local_error.position = 0;
+
+        if (buffer->offset < buffer->length)
+        {
+            local_error.position = buffer->offset;
+        }
+        else if (buffer->length > 0)
+        {
+            local_error.position = buffer->length - 1;
+        }
+
+        buffer->offset = local_error.position;
+        *parse_error = local_error;
+    }
+
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOptsInArena(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated, cJSON_Arena *arena)
+{
+    parse_buffer buffer;
+    cJSON *item = NULL;
+
+    /* the terminator is part of the buffer, the whitespace skip stops on it */
+    parse_buffer_init(&buffer, value, (value != NULL) ? (strlen(value) + sizeof("")) : 0, &global_hooks, arena);
+    item = parse_document(&buffer, require_null_terminated, &global_error);
+
+    if ((return_parse_end != NULL) && (value != NULL))
+    {
+        *return_parse_end = (const char*)buffer_at_offset(&buffer);
+    }
+
+    return item;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseBuffer(const char *value, size_t length, cJSON_ParseStatus *status)
+{
+    return cJSON_ParseBufferInArena(value, length, status, NULL);
+}
+
+/* Fill status with where parsing stopped, after the value and the whitespace that follows it or at the error. */
+static void parse_status(parse_buffer * const buffer, cJSON_ParseStatus * const status, const cJSON_bool failed)
+{
+    size_t end = buffer->offset;
+
+    if (status == NULL)
+    {
+        return;
+    }
+
+    if (failed)
+    {
+        if ((end >= buffer->length) && (buffer->length > 0))
+        {
+            end = buffer->length - 1;
+        }
+    }
+    else if (end < buffer->length)
+    {
+        /* buffer_skip_whitespace stops on the last byte rather than past it, step over that here */
+        buffer_skip_whitespace(buffer);
+        end = buffer->offset;
+        if (buffer->content[end] <= 32)
+        {
+            end++;
+        }
+    }
+
+    status->end = end;
+    status->failed = failed;
+}
+
+/* Parse a buffer that was set up with its length, status gets where it stopped. */
+static cJSON *parse_span(parse_buffer * const buffer, cJSON_ParseStatus * const status, error * const parse_error)
+{
+    cJSON *item = NULL;
+
+    item = parse_document(buffer, false, parse_error);
+    parse_status(buffer, status, item == NULL);
+
+    return item;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseBufferInArena(const char *value, size_t length, cJSON_ParseStatus *status, cJSON_Arena *arena)
+{
+    parse_buffer buffer;
+
+    parse_buffer_init(&buffer, value, length, &global_hooks, arena);
+
+    return parse_span(&buffer, status, &global_error);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithContext(cJSON_Context *context, const char *value, size_t length, cJSON_ParseStatus *status)
+{
+    parse_buffer buffer;
+    internal_hooks hooks;
+    error parse_error;
+    cJSON *item = NULL;
+
+    if (context == NULL)
+    {
+        return NULL;
+    }
+
+    hooks = context_hooks(context);
+    parse_buffer_init(&buffer, value, length, &hooks, NULL);
+    buffer.nesting_limit = context->nesting_limit;
+    buffer.intern = context->intern;
+
+    item = parse_span(&buffer, status, &parse_error);
+    context->error = (parse_error.json != NULL) ? (const char*)(parse_error.json + parse_error.position) : NULL;
+
+    return item;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *buffer, size_t length, cJSON_ParseStatus *status, cJSON_Arena *arena)
+{
+    parse_buffer span;
+    insitu_root *root = NULL;
+    cJSON *item = NULL;
+
+    parse_buffer_init(&span, buffer, length, &global_hooks, arena);
+    span.insitu = true;
+    item = parse_span(&span, status, &global_error);
+
+    if (buffer == NULL)
+    {
+        return item;
+    }
+
+    if (item == NULL)
+    {
+        global_hooks.deallocate(buffer);
+        return NULL;
+    }
+
+    if (arena != NULL)
+    {
+        if (!arena_adopt(arena, buffer))
+        {
+            global_hooks.deallocate(buffer);
+            return NULL;
+        }
+        return item;
+    }
+
+    if (!cJSON_IsString(item) && !cJSON_IsArray(item) && !cJSON_IsObject(item))
+    {
+        /* nothing points into the buffer */
+        global_hooks.deallocate(buffer);
+        return item;
+    }
+
+    /* move the root into a node that carries the buffer, nothing points at the root so it can move */
+    root = (insitu_root*)global_hooks.allocate(sizeof(insitu_root));
+    if (root == NULL)
+    {
+        cJSON_Delete(item);
+        global_hooks.deallocate(buffer);
+        return NULL;
+    }
+    root->item = *item;
+    root->item.type = (item->type & ~cJSON_Pooled) | cJSON_OwnsBuffer;
+    root->buffer = buffer;
+    cJSON_Free_Item(item, &global_hooks);
+
+    return &root->item;
+}
+
+/* Default options for cJSON_Parse */
+CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
+{
+    return cJSON_ParseWithOpts(value, 0, 0);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInArena(const char *value, cJSON_Arena *arena)
+{
+    return cJSON_ParseWithOptsInArena(value, 0, 0, arena);
+}
+
+/* states of the event parser */
+#define event_value 0 /* a value has to follow */
+#define event_first_value 1 /* after '[', a value or ']' */
+#define event_first_key 2 /* after '{', a key or '}' */
+#define event_key 3 /* after ',' in an object */
+#define event_colon 4
+#define event_after 5 /* after a value, ',' or the end of its container */
+#define event_string 6
+#define event_number 7
+#define event_literal 8
+#define event_done 9 /* after the top level value, only whitespace may follow */
+
+struct cJSON_EventParser
+{
+    cJSON_EventCallback callback;
+    void *user;
+    int status;
+    int state;
+    size_t depth;
+    /* one bit per open container, set for objects */
+    unsigned char containers[(CJSON_NESTING_LIMIT + 7) / 8];
+    cJSON_bool key; /* the string being read is a key */
+    cJSON_bool escaped; /* the last byte of the string was a backslash */
+    const char *literal; /* the rest of the true, false or null being matched */
+    int literal_type;
+    size_t token_length;
+    size_t token_size;
+    unsigned char token[1]; /* token_size + 1 bytes */
+};
+
+#define event_in_object(parser) (((parser)->containers[((parser)->depth - 1) / 8] >> (((parser)->depth - 1) % 8)) & 1)
+
+CJSON_PUBLIC(cJSON_EventParser *) cJSON_CreateEventParser(cJSON_EventCallback callback, void *user, size_t token_size)
+{
+    cJSON_EventParser *parser = NULL;
+
+    if (token_size == 0)
+    {
+        token_size = CJSON_EVENT_TOKEN_SIZE;
+    }
+
+    parser = (cJSON_EventParser*)global_hooks.allocate(sizeof(cJSON_EventParser) + token_size);
+    if (parser == NULL)
+    {
+        return NULL;
+    }
+
+    memset(parser, '\0', sizeof(cJSON_EventParser));
+    parser->callback = callback;
+    parser->user = user;
+    parser->status = cJSON_EventParserReading;
+    parser->state = event_value;
+    parser->token_size = token_size;
+
+    return parser;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteEventParser(cJSON_EventParser *parser)
+{
+    if (parser != NULL)
+    {
+        global_hooks.deallocate(parser);
+    }
+}
+
+CJSON_PUBLIC(int) cJSON_EventParserStatus(const cJSON_EventParser *parser)
+{
+    if (parser == NULL)
+    {
+        return cJSON_EventParserFailed;
+    }
+
+    return parser->status;
+}
+
+/* Hand an event to the callback, which may pause or stop the parser. */
+static void event_emit(cJSON_EventParser * const parser, const int type, const size_t depth, const double number)
+{
+    cJSON_Event event;
+    int action = cJSON_EventContinue;
+
+    if (parser->callback == NULL)
+    {
+        return;
+    }
+
+    event.type = type;
+    event.depth = depth;
+    event.string = NULL;
+    event.length = 0;
+    event.number = number;
+    if ((type == cJSON_EventKey) || (type == cJSON_EventString))
+    {
+        event.string = (const char*)parser->token;
+        event.length = parser->token_length;
+    }
+
+    action = parser->callback(&event, parser->user);
+    if (action == cJSON_EventPause)
+    {
+        parser->status = cJSON_EventParserPaused;
+    }
+    else if (action == cJSON_EventStop)
+    {
+        parser->status = cJSON_EventParserStopped;
+    }
+}
+
+/* A value was completed, call after its event. */
+static void event_value_end(cJSON_EventParser * const parser)
+{
+    if (parser->depth > 0)
+    {
+        parser->state = event_after;
+        return;
+    }
+
+    parser->state = event_done;
+    if (parser->status == cJSON_EventParserReading)
+    {
+        parser->status = cJSON_EventParserDone;
+    }
+}
+
+static cJSON_bool event_token_append(cJSON_EventParser * const parser, const unsigned char * const data, const size_t length)
+{
+    /* tokens never grow past token_size, that is what bounds the memory */
+    if (length > (parser->token_size - parser->token_length))
+    {
+        return false;
+    }
+
+    memcpy(parser->token + parser->token_length, data, length);
+    parser->token_length += length;
+
+    return true;
+}
+
+static cJSON_bool event_string_end(cJSON_EventParser * const parser)
+{
+    const unsigned char *input = parser->token;
+    unsigned char *output = parser->token;
+
+    if (!decode_string(&input, parser->token + parser->token_length, &output))
+    {
+        return false;
+    }
+    *output = '\0';
+    parser->token_length = (size_t)(output - parser->token);
+
+    if (parser->key)
+    {
+        parser->state = event_colon;
+        event_emit(parser, cJSON_EventKey, parser->depth, 0);
+        return true;
+    }
+
+    event_emit(parser, cJSON_EventString, parser->depth, 0);
+    event_value_end(parser);
+
+    return true;
+}
+
+static cJSON_bool event_number_end(cJSON_EventParser * const parser)
+{
+    double number = 0;
+    unsigned char *after_end = NULL;
+    unsigned char decimal_point = '.';
+    size_t i = 0;
+
+    parser->token[parser->token_length] = '\0';
+    if (!parse_number_fast(parser->token, parser->token_length, &number))
+    {
+        /* strtod with the decimal point of the current locale, it has to take the whole token */
+        decimal_point = get_decimal_point();
+        for (i = 0; i < parser->token_length; i++)
+        {
+            if (parser->token[i] == '.')
+            {
+                parser->token[i] = decimal_point;
+            }
+        }
+
+        number = strtod((const char*)parser->token, (char**)&after_end);
+        if (after_end != (parser->token + parser->token_length))
+        {
+            return false;
+        }
+    }
+
+    event_emit(parser, cJSON_EventNumber, parser->depth, number);
+    event_value_end(parser);
+
+    return true;
+}
+
+static cJSON_bool event_open(cJSON_EventParser * const parser, const cJSON_bool object)
+{
+    if (parser->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* too deeply nested */
+    }
+
+    if (object)
+    {
+        parser->containers[parser->depth / 8] |= (unsigned char)(1 << (parser->depth % 8));
+        parser->state = event_first_key;
+    }
+    else
+    {
+        parser->containers[parser->depth / 8] &= (unsigned char)~(1 << (parser->depth % 8));
+        parser->state = event_first_value;
+    }
+    parser->depth++;
+
+    event_emit(parser, object ? cJSON_EventObjectStart : cJSON_EventArrayStart, parser->depth - 1, 0);
+
+    return true;
+}
+
+static cJSON_bool event_close(cJSON_EventParser * const parser, const unsigned char c)
+{
+    cJSON_bool object = false;
+
+    if (parser->depth == 0)
+    {
+        return false;
+    }
+
+    object = event_in_object(parser);
+    if (c != (object ? '}' : ']'))
+    {
+        return false;
+    }
+    parser->depth--;
+
+    event_emit(parser, object ? cJSON_EventObjectEnd : cJSON_EventArrayEnd, parser->depth, 0);
+    event_value_end(parser);
+
+    return true;
+}
+
+/* Start the value that begins with c. */
+static cJSON_bool event_start_value(cJSON_EventParser * const parser, const unsigned char c)
+{
+    switch (c)
+    {
+        case '{':
+            return event_open(parser, true);
+
+        case '[':
+            return event_open(parser, false);
+
+        case '\"':
+            parser->state = event_string;
+            parser->key = false;
+            parser->token_length = 0;
+            return true;
+
+        case 't':
+            parser->literal = "rue";
+            parser->literal_type = cJSON_EventTrue;
+            break;
+
+        case 'f':
+            parser->literal = "alse";
+            parser->literal_type = cJSON_EventFalse;
+            break;
+
+        case 'n':
+            parser->literal = "ull";
+            parser->literal_type = cJSON_EventNull;
+            break;
+
+        default:
+            if ((c == '-') || ((c >= '0') && (c <= '9')))
+            {
+                parser->state = event_number;
+                parser->token[0] = c;
+                parser->token_length = 1;
+                return true;
+            }
+            return false;
+    }
+
+    parser->state = event_literal;
+
+    return true;
+}
+
+#define event_number_char(c) ((((c) >= '0') && ((c) <= '9')) || ((c) == '+') || ((c) == '-') || ((c) == 'e') || ((c) == 'E') || ((c) == '.'))
+
+/*
+ * Run the state machine over length bytes. Returns how many were consumed, which is less than length
+ * when the callback paused or stopped the parser or the input is invalid.
+ */
+CJSON_PUBLIC(size_t) cJSON_FeedEventParser(cJSON_EventParser *parser, const char *data, size_t length)
+{
+    const unsigned char *input = (const unsigned char*)data;
+    size_t position = 0;
+    size_t run = 0;
+    unsigned char c = 0;
+
+    if (parser == NULL)
+    {
+        return 0;
+    }
+
+    if (parser->status == cJSON_EventParserPaused)
+    {
+        parser->status = (parser->state == event_done) ? cJSON_EventParserDone : cJSON_EventParserReading;
+    }
+
+    if ((input == NULL) && (length > 0))
+    {
+        parser->status = cJSON_EventParserFailed;
+    }
+
+    while ((position < length) && ((parser->status == cJSON_EventParserReading) || (parser->status == cJSON_EventParserDone)))
+    {
+        c = input[position];
+
+        switch (parser->state)
+        {
+            case event_string:
+                if (parser->escaped)
+                {
+                    /* whatever follows a backslash, the quote included, is decoded at the end */
+                    parser->escaped = false;
+                    run = 1;
+                }
+                else
+                {
+                    run = scan_string(input + position, length - position);
+                    if ((run == 0) && (c == '\"'))
+                    {
+                        position++;
+                        if (!event_string_end(parser))
+                        {
+                            goto fail;
+                        }
+                        continue;
+                    }
+                    if (run == 0)
+                    {
+                        parser->escaped = true;
+                        run = 1;
+                    }
+                }
+                if (!event_token_append(parser, input + position, run))
+                {
+                    goto fail;
+                }
+                position += run;
+                continue;
+
+            case event_number:
+                run = 0;
+                while (((position + run) < length) && event_number_char(input[position + run]))
+                {
+                    run++;
+                }
+                if (!event_token_append(parser, input + position, run))
+                {
+                    goto fail;
+                }
+                position += run;
+                if ((position < length) && !event_number_end(parser))
+                {
+                    goto fail;
+                }
+                /* the byte that ended the number is looked at in the new state */
+                continue;
+
+            case event_literal:
+                if (c != (unsigned char)*parser->literal)
+                {
+                    goto fail;
+                }
+                position++;
+                parser->literal++;
+                if (*parser->literal == '\0')
+                {
+                    event_emit(parser, parser->literal_type, parser->depth, 0);
+                    event_value_end(parser);
+                }
+                continue;
+
+            default:
+                break;
+        }
+
+        if (c <= 32)
+        {
+            run = scan_whitespace(input + position, length - position);
+            position += (run > 0) ? run : 1;
+            continue;
+        }
+        position++;
+
+        switch (parser->state)
+        {
+            case event_first_value:
+                if (c == ']')
+                {
+                    if (!event_close(parser, c))
+                    {
+                        goto fail;
+                    }
+                    break;
+                }
+                /* fall through */
+            case event_value:
+                if (!event_start_value(parser, c))
+                {
+                    goto fail;
+                }
+                break;
+
+            case event_first_key:
+                if (c == '}')
+                {
+                    if (!event_close(parser, c))
+                    {
+                        goto fail;
+                    }
+                    break;
+                }
+                /* fall through */
+            case event_key:
+                if (c != '\"')
+                {
+                    goto fail;
+                }
+                parser->state = event_string;
+                parser->key = true;
+                parser->token_length = 0;
+                break;
+
+            case event_colon:
+                if (c != ':')
+                {
+                    goto fail;
+                }
+                parser->state = event_value;
+                break;
+
+            case event_after:
+                if (c == ',')
+                {
+                    parser->state = event_in_object(parser) ? event_key : event_value;
+                }
+                else if (!event_close(parser, c))
+                {
+                    goto fail;
+                }
+                break;
+
+            default:
+                goto fail;
+        }
+    }
+
+    return position;
+
+fail:
+    parser->status = cJSON_EventParserFailed;
+
+    return position;
+}
+
+/* No more input will come, ends a number at the top level. Returns the status. */
+CJSON_PUBLIC(int) cJSON_FinishEventParser(cJSON_EventParser *parser)
+{
+    if (parser == NULL)
+    {
+        return cJSON_EventParserFailed;
+    }
+
+    if ((parser->status == cJSON_EventParserPaused) && (parser->state == event_done))
+    {
+        parser->status = cJSON_EventParserDone;
+    }
+
+    if ((parser->status == cJSON_EventParserReading) && (parser->state == event_number) && (parser->depth == 0))
+    {
+        if (!event_number_end(parser))
+        {
+            parser->status = cJSON_EventParserFailed;
+        }
+        else if (parser->status == cJSON_EventParserPaused)
+        {
+            parser->status = cJSON_EventParserDone;
+        }
+    }
+
+    if (parser->status == cJSON_EventParserReading)
+    {
+        /* the input ended inside a value */
+        parser->status = cJSON_EventParserFailed;
+    }
+
+    return parser->status;
+}
+
+CJSON_PUBLIC(int) cJSON_ParseEvents(const char *value, size_t length, cJSON_EventCallback callback, void *user)
+{
+    cJSON_EventParser *parser = NULL;
+    int status = cJSON_EventParserFailed;
+
+    parser = cJSON_CreateEventParser(callback, user, 0);
+    if (parser == NULL)
+    {
+        return cJSON_EventParserFailed;
+    }
+
+    if (cJSON_FeedEventParser(parser, value, length) == length)
+    {
+        status = cJSON_FinishEventParser(parser);
+    }
+    else
+    {
+        status = parser->status;
+    }
+
+    cJSON_DeleteEventParser(parser);
+
+    return status;
+}
+
+/*
+ * Check the string contents [input, input_end) like parse_string does, count their decoded length into
+ * *length and, unless key is NULL, compare them decoded with key like cJSON_GetObjectItem would.
+ * Returns -1 for an invalid string, 1 if it is equal to key and 0 otherwise.
+ */
+static int match_string(const unsigned char *input, const unsigned char * const input_end, const unsigned char *key, size_t * const length)
+{
+    unsigned char decoded[4];
+    unsigned char *decoded_end = NULL;
+    unsigned char *pointer = NULL;
+    unsigned char sequence_length = 0;
+    cJSON_bool match = (key != NULL);
+    cJSON_bool terminated = false; /* a \u0000 ends the string for strcmp */
+    size_t run = 0;
+
+    *length = 0;
+    while (input < input_end)
+    {
+        if (!match && (*input != '\\'))
+        {
+            /* nothing left to compare, only look at the escape sequences */
+            run = scan_string(input, (size_t)(input_end - input));
+            if (run == 0)
+            {
+                run = 1;
+            }
+            *length += run;
+            input += run;
+            continue;
+        }
+
+        decoded_end = decoded;
+        if (*input != '\\')
+        {
+            *decoded_end++ = *input++;
+        }
+        else
+        {
+            if ((input_end - input) < 2)
+            {
+                return -1;
+            }
+
+            sequence_length = 2;
+            switch (input[1])
+            {
+                case 'b':
+                    *decoded_end++ = '\b';
+                    break;
+                case 'f':
+                    *decoded_end++ = '\f';
+                    break;
+                case 'n':
+                    *decoded_end++ = '\n';
+                    break;
+                case 'r':
+                    *decoded_end++ = '\r';
+                    break;
+                case 't':
+                    *decoded_end++ = '\t';
+                    break;
+                case '\"':
+                case '\\':
+                case '/':
+                    *decoded_end++ = input[1];
+                    break;
+
+                case 'u':
+                    sequence_length = utf16_literal_to_utf8(input, input_end, &decoded_end);
+                    if (sequence_length == 0)
+                    {
+                        return -1;
+                    }
+                    break;
+
+                default:
+                    return -1;
+            }
+            input += sequence_length;
+        }
+
+        *length += (size_t)(decoded_end - decoded);
+        for (pointer = decoded; match && !terminated && (pointer < decoded_end); pointer++)
+        {
+            if (*pointer == '\0')
+            {
+                terminated = true;
+            }
+            else if (tolower(*pointer) != tolower(*key))
+            {
+                match = false;
+            }
+            else
+            {
+                key++;
+            }
+        }
+    }
+
+    return (match && (terminated || (*key == '\0'))) ? 1 : 0;
+}
+
+/* Step over the string at the buffer's offset, its contents are [*start, *end). */
+static cJSON_bool skip_string(parse_buffer * const input_buffer, const unsigned char ** const start, const unsigned char ** const end)
+{
+    const unsigned char *buffer_end = input_buffer->content + input_buffer->length;
+    const unsigned char *input_end = NULL;
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '\"'))
+    {
+        return false;
+    }
+
+    input_end = buffer_at_offset(input_buffer) + 1;
+    while (input_end < buffer_end)
+    {
+        input_end += scan_string(input_end, (size_t)(buffer_end - input_end));
+        if ((input_end >= buffer_end) || (*input_end == '\"'))
+        {
+            break;
+        }
+
+        /* is escape sequence */
+        if ((input_end + 1) >= buffer_end)
+        {
+            return false;
+        }
+        input_end += 2;
+    }
+    if ((input_end >= buffer_end) || (*input_end != '\"'))
+    {
+        return false; /* string ended unexpectedly */
+    }
+
+    *start = buffer_at_offset(input_buffer) + 1;
+    *end = input_end;
+    input_buffer->offset = (size_t)(input_end - input_buffer->content) + 1;
+
+    return true;
+}
+
+/* An array or object that skip_value is in the middle of. */
+typedef struct
+{
+    unsigned char close;
+} skip_frame;
+
+/*
+ * Step over the value at the buffer's offset, checking it like parse_value does without building anything.
+ * If key is given and the value is an object, *match is set to where the value of its first member with that key
+ * starts and *match_end to where it ends.
+ */
+static cJSON_bool skip_value(parse_buffer * const input_buffer, const unsigned char * const key, const unsigned char ** const match, const unsigned char ** const match_end)
+{
+    walk_stack stack;
+    skip_frame *frame = NULL;
+    const unsigned char *start = NULL;
+    const unsigned char *end = NULL;
+    const unsigned char *member = NULL;
+    unsigned char close = '\0';
+    size_t length = 0;
+    int matched = 0;
+    int key_matched = 0;
+    cJSON number;
+
+    walk_init(&stack, sizeof(skip_frame), &input_buffer->hooks);
+
+value:
+    if (can_read(input_buffer, 4) && ((strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0) || (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0)))
+    {
+        input_buffer->offset += 4;
+        goto skipped;
+    }
+    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    {
+        input_buffer->offset += 5;
+        goto skipped;
+    }
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        goto fail;
+    }
+
+    switch (buffer_at_offset(input_buffer)[0])
+    {
+        case '\"':
+            if (!skip_string(input_buffer, &start, &end) || (match_string(start, end, NULL, &length) != 0))
+            {
+                goto fail;
+            }
+            goto skipped;
+
+        case '[':
+        case '{':
+            if (input_buffer->depth >= input_buffer->nesting_limit)
+            {
+                goto fail; /* to deeply nested */
+            }
+            input_buffer->depth++;
+            close = (buffer_at_offset(input_buffer)[0] == '{') ? '}' : ']';
+
+            input_buffer->offset++;
+            buffer_skip_whitespace(input_buffer);
+            if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == close))
+            {
+                input_buffer->depth--;
+                input_buffer->offset++;
+                goto skipped;
+            }
+
+            /* check if we skipped to the end of the buffer */
+            if (cannot_access_at_index(input_buffer, 0))
+            {
+                goto fail;
+            }
+
+            frame = (skip_frame*)walk_push(&stack);
+            if (frame == NULL)
+            {
+                goto fail;
+            }
+            frame->close = close;
+
+            /* step back to character in front of the first element */
+            input_buffer->offset--;
+            goto element;
+
+        default:
+            if ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9')))
+            {
+                if (!parse_number(&number, input_buffer))
+                {
+                    goto fail;
+                }
+                goto skipped;
+            }
+            goto fail;
+    }
+
+element:
+    /* the next element of the container on top of the stack, only members of the outermost one are matched */
+    frame = (skip_frame*)walk_top(&stack);
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+
+    if (frame->close == '}')
+    {
+        if (!skip_string(input_buffer, &start, &end))
+        {
+            goto fail;
+        }
+        key_matched = match_string(start, end, ((key != NULL) && (stack.count == 1) && (*match == NULL)) ? key : NULL, &length);
+        if (key_matched < 0)
+        {
+            goto fail;
+        }
+        buffer_skip_whitespace(input_buffer);
+
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+        {
+            goto fail; /* invalid object */
+        }
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+
+        if (stack.count == 1)
+        {
+            matched = key_matched;
+            member = buffer_at_offset(input_buffer);
+        }
+    }
+    goto value;
+
+skipped:
+    /* a value is behind us, see what comes after it in the container it is in */
+    while (stack.count > 0)
+    {
+        frame = (skip_frame*)walk_top(&stack);
+        if ((stack.count == 1) && matched)
+        {
+            *match = member;
+            *match_end = buffer_at_offset(input_buffer);
+            matched = 0;
+        }
+        buffer_skip_whitespace(input_buffer);
+        if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','))
+        {
+            goto element;
+        }
+
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != frame->close))
+        {
+            goto fail; /* expected end of the container */
+        }
+
+        input_buffer->depth--;
+        input_buffer->offset++;
+        walk_pop(&stack);
+    }
+
+    walk_free(&stack);
+
+    return true;
+
+fail:
+    walk_free(&stack);
+
+    return false;
+}
+
+CJSON_PUBLIC(int) cJSON_ExtractString(const char *value, size_t length, const char *key, char *buffer, size_t size, cJSON_ParseStatus *status)
+{
+    parse_buffer input_buffer;
+    const unsigned char *match = NULL;
+    const unsigned char *match_end = NULL;
+    const unsigned char *input = NULL;
+    unsigned char *output = NULL;
+    size_t string_length = 0;
+    int result = cJSON_ExtractInvalid;
+
+    parse_buffer_init(&input_buffer, value, length, &global_hooks, NULL);
+    if ((value == NULL) || (length == 0) || (key == NULL))
+    {
+        goto done;
+    }
+
+    buffer_skip_whitespace(skip_utf8_bom(&input_buffer));
+    if (!skip_value(&input_buffer, (const unsigned char*)key, &match, &match_end))
+    {
+        goto done;
+    }
+
+    result = cJSON_ExtractMissing;
+    if ((match == NULL) || (match[0] != '\"'))
+    {
+        goto done;
+    }
+
+    /* the string was checked on the way, this can't fail */
+    match_string(match + 1, match_end - 1, NULL, &string_length);
+    if ((buffer == NULL) || (string_length >= size))
+    {
+        result = cJSON_ExtractTooLong;
+        goto done;
+    }
+
+    input = match + 1;
+    output = (unsigned char*)buffer;
+    decode_string(&input, match_end - 1, &output);
+    *output = '\0';
+    result = cJSON_ExtractFound;
+
+done:
+    parse_status(&input_buffer, status, result == cJSON_ExtractInvalid);
+
+    return result;
+}
+
+struct cJSON_Tape
+{
+    cJSON_TapeItem *items;
+    size_t count;
+    size_t capacity;
+};
+
+static cJSON_bool tape_resize(cJSON_Tape * const tape, const size_t capacity)
+{
+    cJSON_TapeItem *items = NULL;
+
+    if (capacity > ((size_t)-1 / sizeof(cJSON_TapeItem)))
+    {
+        return false;
+    }
+
+    if (global_hooks.reallocate != NULL)
+    {
+        items = (cJSON_TapeItem*)global_hooks.reallocate(tape->items, capacity * sizeof(cJSON_TapeItem));
+        if (items == NULL)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        items = (cJSON_TapeItem*)global_hooks.allocate(capacity * sizeof(cJSON_TapeItem));
+        if (items == NULL)
+        {
+            return false;
+        }
+        if (tape->items != NULL)
+        {
+            memcpy(items, tape->items, tape->count * sizeof(cJSON_TapeItem));
+            global_hooks.deallocate(tape->items);
+        }
+    }
+
+    tape->items = items;
+    tape->capacity = capacity;
+
+    return true;
+}
+
+/* Append an entry, pointers to earlier entries don't survive this. */
+static cJSON_TapeItem *tape_push(cJSON_Tape * const tape, const unsigned int type)
+{
+    cJSON_TapeItem *item = NULL;
+
+    if ((tape->count == tape->capacity) && !tape_resize(tape, tape->capacity * 2))
+    {
+        return NULL;
+    }
+
+    item = &tape->items[tape->count++];
+    item->type = type;
+    item->span = 1;
+    item->value.size = 0;
+
+    return item;
+}
+
+/* Decode the string at the buffer's offset where it is and record it. */
+static cJSON_bool tape_string(cJSON_Tape * const tape, parse_buffer * const input_buffer, const unsigned int type)
+{
+    const unsigned char *start = NULL;
+    const unsigned char *end = NULL;
+    unsigned char *output = NULL;
+    cJSON_TapeItem *item = NULL;
+
+    if (!skip_string(input_buffer, &start, &end))
+    {
+        return false;
+    }
+
+    /* decoding never makes a string longer, and the closing quote makes room for the terminator */
+    output = (unsigned char*)cast_away_const(start);
+    item = tape_push(tape, type);
+    if (item == NULL)
+    {
+        return false;
+    }
+    item->value.string = (const char*)output;
+
+    if (!decode_string(&start, end, &output))
+    {
+        input_buffer->offset = (size_t)(start - input_buffer->content);
+        return false;
+    }
+    *output = '\0';
+
+    return true;
+}
+
+/* An array or object that tape_value is in the middle of. */
+typedef struct
+{
+    size_t index; /* of its entry on the tape */
+    size_t items;
+    cJSON_bool object;
+} tape_frame;
+
+/* Record the value at the buffer's offset, checking it like parse_value does. */
+static cJSON_bool tape_value(cJSON_Tape * const tape, parse_buffer * const input_buffer)
+{
+    walk_stack stack;
+    tape_frame *frame = NULL;
+    cJSON_TapeItem *item = NULL;
+    cJSON_bool object = false;
+    size_t index = 0;
+    cJSON number;
+
+    walk_init(&stack, sizeof(tape_frame), &input_buffer->hooks);
+
+value:
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
+    {
+        input_buffer->offset += 4;
+        if (tape_push(tape, cJSON_NULL) == NULL)
+        {
+            goto fail;
+        }
+        goto taped;
+    }
+    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    {
+        input_buffer->offset += 5;
+        if (tape_push(tape, cJSON_False) == NULL)
+        {
+            goto fail;
+        }
+        goto taped;
+    }
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
+    {
+        input_buffer->offset += 4;
+        if (tape_push(tape, cJSON_True) == NULL)
+        {
+            goto fail;
+        }
+        goto taped;
+    }
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        goto fail;
+    }
+
+    switch (buffer_at_offset(input_buffer)[0])
+    {
+        case '\"':
+            if (!tape_string(tape, input_buffer, cJSON_String))
+            {
+                goto fail;
+            }
+            goto taped;
+
+        case '[':
+        case '{':
+            if (input_buffer->depth >= input_buffer->nesting_limit)
+            {
+                goto fail; /* to deeply nested */
+            }
+            input_buffer->depth++;
+            object = (buffer_at_offset(input_buffer)[0] == '{');
+
+            index = tape->count;
+            if (tape_push(tape, object ? cJSON_Object : cJSON_Array) == NULL)
+            {
+                goto fail;
+            }
+
+            input_buffer->offset++;
+            buffer_skip_whitespace(input_buffer);
+            if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == (object ? '}' : ']')))
+            {
+                /* empty array or object */
+                input_buffer->depth--;
+                input_buffer->offset++;
+                if (tape_push(tape, cJSON_Invalid) == NULL)
+                {
+                    goto fail;
+                }
+                tape->items[index].span = 2;
+                goto taped;
+            }
+
+            /* check if we skipped to the end of the buffer */
+            if (cannot_access_at_index(input_buffer, 0))
+            {
+                goto fail;
+            }
+
+            frame = (tape_frame*)walk_push(&stack);
+            if (frame == NULL)
+            {
+                goto fail;
+            }
+            frame->index = index;
+            frame->items = 0;
+            frame->object = object;
+
+            /* step back to character in front of the first element */
+            input_buffer->offset--;
+            goto element;
+
+        default:
+            if ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9')))
+            {
+                if (!parse_number(&number, input_buffer))
+                {
+                    goto fail;
+                }
+                item = tape_push(tape, cJSON_Number);
+                if (item == NULL)
+                {
+                    goto fail;
+                }
+                item->value.number = number.valuedouble;
+                goto taped;
+            }
+            goto fail;
+    }
+
+element:
+    /* the next element of the container on top of the stack, offset is on the '[', '{' or ',' in front of it */
+    frame = (tape_frame*)walk_top(&stack);
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+
+    if (frame->object)
+    {
+        if (!tape_string(tape, input_buffer, cJSON_String | cJSON_TapeKey))
+        {
+            goto fail;
+        }
+        buffer_skip_whitespace(input_buffer);
+
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+        {
+            goto fail; /* invalid object */
+        }
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+    }
+    goto value;
+
+taped:
+    /* a value is on the tape, see what comes after it in the container it is in */
+    while (stack.count > 0)
+    {
+        frame = (tape_frame*)walk_top(&stack);
+        frame->items++;
+        buffer_skip_whitespace(input_buffer);
+        if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','))
+        {
+            goto element;
+        }
+
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != (frame->object ? '}' : ']')))
+        {
+            goto fail; /* expected end of the container */
+        }
+
+        input_buffer->depth--;
+        input_buffer->offset++;
+
+        /* containers end with an invalid entry, that is where walking their items stops */
+        if ((tape_push(tape, cJSON_Invalid) == NULL) || ((tape->count - frame->index) > UINT_MAX))
+        {
+            goto fail;
+        }
+        tape->items[frame->index].span = (unsigned int)(tape->count - frame->index);
+        tape->items[frame->index].value.size = frame->items;
+        walk_pop(&stack);
+    }
+
+    walk_free(&stack);
+
+    return true;
+
+fail:
+    walk_free(&stack);
+
+    return false;
+}
+
+CJSON_PUBLIC(cJSON_Tape *) cJSON_ParseTape(char *buffer, size_t length, cJSON_ParseStatus *status)
+{
+    parse_buffer input_buffer;
+    cJSON_Tape *tape = NULL;
+    cJSON_bool parsed = false;
+
+    parse_buffer_init(&input_buffer, buffer, length, &global_hooks, NULL);
+
+    tape = (cJSON_Tape*)global_hooks.allocate(sizeof(cJSON_Tape));
+    if (tape == NULL)
+    {
+        goto done;
+    }
+    memset(tape, '\0', sizeof(cJSON_Tape));
+
+    /* a guess at how many tokens there are, the tape grows if it was too low */
+    if (!tape_resize(tape, (length / 8) + 8))
+    {
+        goto done;
+    }
+
+    /* the invalid entries around the root let cJSON_TapeNext and cJSON_TapeGetKey look at neighbours without checks */
+    if ((buffer == NULL) || (length == 0) || (tape_push(tape, cJSON_Invalid) == NULL))
+    {
+        goto done;
+    }
+
+    buffer_skip_whitespace(skip_utf8_bom(&input_buffer));
+    parsed = tape_value(tape, &input_buffer) && (tape_push(tape, cJSON_Invalid) != NULL);
+
+    if (parsed && (global_hooks.reallocate != NULL))
+    {
+        /* give back what the guess left over, a failure only keeps the larger tape */
+        tape_resize(tape, tape->count);
+    }
+
+done:
+    parse_status(&input_buffer, status, !parsed);
+    if (!parsed)
+    {
+        cJSON_DeleteTape(tape);
+        return NULL;
+    }
+
+    return tape;
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteTape(cJSON_Tape *tape)
+{
+    if (tape == NULL)
+    {
+        return;
+    }
+
+    if (tape->items != NULL)
+    {
+        global_hooks.deallocate(tape->items);
+    }
+    global_hooks.deallocate(tape);
+}
+
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeRoot(const cJSON_Tape *tape)
+{
+    if (tape == NULL)
+    {
+        return NULL;
+    }
+
+    return &tape->items[1];
+}
+
+CJSON_PUBLIC(size_t) cJSON_TapeMemory(const cJSON_Tape *tape)
+{
+    if (tape == NULL)
+    {
+        return 0;
+    }
+
+    return sizeof(cJSON_Tape) + (tape->capacity * sizeof(cJSON_TapeItem));
+}
+
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeChild(const cJSON_TapeItem *item)
+{
+    if ((item == NULL) || !(item->type & (cJSON_Array | cJSON_Object)) || (item->value.size == 0))
+    {
+        return NULL;
+    }
+
+    /* an object's first entry is the key of its first item */
+    return (item->type & cJSON_Object) ? (item + 2) : (item + 1);
+}
+
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeNext(const cJSON_TapeItem *item)
+{
+    const cJSON_TapeItem *next = NULL;
+
+    if (item == NULL)
+    {
+        return NULL;
+    }
+
+    next = item + item->span;
+    if (next->type == cJSON_Invalid)
+    {
+        return NULL; /* the end of the container */
+    }
+
+    /* skip the key of the next item of an object */
+    return (next->type & cJSON_TapeKey) ? (next + 1) : next;
+}
+
+CJSON_PUBLIC(const char *) cJSON_TapeGetKey(const cJSON_TapeItem *item)
+{
+    if ((item == NULL) || !(item[-1].type & cJSON_TapeKey))
+    {
+        return NULL;
+    }
+
+    return item[-1].value.string;
+}
+
+CJSON_PUBLIC(int) cJSON_TapeGetArraySize(const cJSON_TapeItem *array)
+{
+    if ((array == NULL) || !(array->type & (cJSON_Array | cJSON_Object)))
+    {
+        return 0;
+    }
+
+    return (int)array->value.size;
+}
+
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeGetArrayItem(const cJSON_TapeItem *array, int index)
+{
+    const cJSON_TapeItem *item = NULL;
+
+    if (index < 0)
+    {
+        return NULL;
+    }
+
+    for (item = cJSON_TapeChild(array); (item != NULL) && (index > 0); index--)
+    {
+        item = cJSON_TapeNext(item);
+    }
+
+    return item;
+}
+
+static const cJSON_TapeItem *tape_get_object_item(const cJSON_TapeItem * const object, const char * const name, const cJSON_bool case_sensitive)
+{
+    const cJSON_TapeItem *item = NULL;
+
+    if ((object == NULL) || (name == NULL) || !(object->type & cJSON_Object))
+    {
+        return NULL;
+    }
+
+    for (item = cJSON_TapeChild(object); item != NULL; item = cJSON_TapeNext(item))
+    {
+        if (case_sensitive ? (strcmp(name, item[-1].value.string) == 0) : (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)item[-1].value.string) == 0))
+        {
+            return item;
+        }
+    }
+
+    return NULL;
+}
+
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeGetObjectItem(const cJSON_TapeItem *object, const char *string)
+{
+    return tape_get_object_item(object, string, false);
+}
+
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeGetObjectItemCaseSensitive(const cJSON_TapeItem *object, const char *string)
+{
+    return tape_get_object_item(object, string, true);
+}
+
+CJSON_PUBLIC(const char *) cJSON_TapeGetStringValue(const cJSON_TapeItem *item)
+{
+    if ((item == NULL) || !(item->type & cJSON_String))
+    {
+        return NULL;
+    }
+
+    return item->value.string;
+}
+
+CJSON_PUBLIC(double) cJSON_TapeGetNumberValue(const cJSON_TapeItem *item)
+{
+    if ((item == NULL) || !(item->type & cJSON_Number))
+    {
+        return 0;
+    }
+
+    return item->value.number;
+}
+
+/* Measure first, then print into one allocation of exactly the right size. */
+static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
+{
+    printbuffer buffer[1];
+    size_t length = 0;
+    size_t escapes = 0;
+
+    memset(buffer, 0, sizeof(buffer));
+
+    if (!measure_value(item, 0, format, &length, &escapes) || (length > (INT_MAX - escapes)))
+    {
+        return NULL;
+    }
+    length += escapes;
+
+    /* create buffer */
+    buffer->buffer = (unsigned char*) hooks->allocate(length + sizeof(""));
+    buffer->length = length + sizeof("");
+    buffer->noalloc = true;
+    buffer->unescaped = (escapes == 0);
+    buffer->format = format;
+    buffer->hooks = *hooks;
+    if (buffer->buffer == NULL)
+    {
+        return NULL;
+    }
+
+    /* print the value */
+    if (!print_value(item, buffer))
+    {
+        hooks->deallocate(buffer->buffer);
+        return NULL;
+    }
+
+    return buffer->buffer;
+}
+
+/* Render a cJSON item/entity/structure to text. */
+CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item)
+{
+    return (char*)print(item, true, &global_hooks);
+}
+
+CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
+{
+    return (char*)print(item, false, &global_hooks);
+}
+
+CJSON_PUBLIC(char *) cJSON_PrintWithContext(cJSON_Context *context, const cJSON *item, cJSON_bool format)
+{
+    internal_hooks hooks;
+
+    if (context == NULL)
+    {
+        return NULL;
+    }
+
+    hooks = context_hooks(context);
+
+    return (char*)print(item, format, &hooks);
+}
+
+CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, 0 };
+
+    if (prebuffer < 0)
+    {
+        return NULL;
+    }
+
+    p.buffer = (unsigned char*)global_hooks.allocate((size_t)prebuffer);
+    if (!p.buffer)
+    {
+        return NULL;
+    }
+
+    p.length = (size_t)prebuffer;
+    p.offset = 0;
+    p.noalloc = false;
+    p.format = fmt;
+    p.hooks = global_hooks;
+
+    if (!print_value(item, &p))
+    {
+        global_hooks.deallocate(p.buffer);
+        return NULL;
+    }
+
+    return (char*)p.buffer;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const int len, const cJSON_bool fmt)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 }, 0 };
+
+    if ((len < 0) || (buf == NULL))
+    {
+        return false;
+    }
+
+    p.buffer = (unsigned char*)buf;
+    p.length = (size_t)len;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = fmt;
+    p.hooks = global_hooks;
+
+    return print_value(item, &p);
+}
+
+/* Parser core - when encountering text, process appropriately. */
+/* An array or object that parse_value is in the middle of, with the list of what it has parsed of it so far. */
+typedef struct
+{
+    cJSON *item;
+    cJSON *head;
+    cJSON *tail;
+    cJSON_bool object;
+} parse_frame;
+
+/* Parse a value, going into arrays and objects on an explicit stack rather than by recursion. */
+static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+{
+    walk_stack stack;
+    parse_frame *frame = NULL;
+    cJSON *current = item;
+    cJSON *new_item = NULL;
+    cJSON_bool object = false;
+
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    {
+        return false; /* no input */
+    }
+
+    walk_init(&stack, sizeof(parse_frame), &input_buffer->hooks);
+
+value:
+    /* parse the different types of values */
+    /* null */
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
+    {
+        current->type = cJSON_NULL;
+        input_buffer->offset += 4;
+        goto parsed;
+    }
+    /* false */
+    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    {
+        current->type = cJSON_False;
+        input_buffer->offset += 5;
+        goto parsed;
+    }
+    /* true */
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
+    {
+        current->type = cJSON_True;
+        current->valueint = 1;
+        input_buffer->offset += 4;
+        goto parsed;
+    }
+    /* string */
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
+    {
+        if (!parse_string(current, input_buffer))
+        {
+            goto fail;
+        }
+        goto parsed;
+    }
+    /* number */
+    if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
+    {
+        if (!parse_number(current, input_buffer))
+        {
+            goto fail;
+        }
+        goto parsed;
+    }
+    /* array or object */
+    if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '[') || (buffer_at_offset(input_buffer)[0] == '{')))
+    {
+        if (input_buffer->depth >= input_buffer->nesting_limit)
+        {
+            goto fail; /* to deeply nested */
+        }
+        input_buffer->depth++;
+        object = (buffer_at_offset(input_buffer)[0] == '{');
+
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == (object ? '}' : ']')))
+        {
+            /* empty array or object */
+            input_buffer->depth--;
+            current->type = object ? cJSON_Object : cJSON_Array;
+            input_buffer->offset++;
+            goto parsed;
+        }
+
+        /* check if we skipped to the end of the buffer */
+        if (cannot_access_at_index(input_buffer, 0))
+        {
+            input_buffer->offset--;
+            goto fail;
+        }
+
+        frame = (parse_frame*)walk_push(&stack);
+        if (frame == NULL)
+        {
+            goto fail;
+        }
+        frame->item = current;
+        frame->head = NULL;
+        frame->tail = NULL;
+        frame->object = object;
+
+        /* step back to character in front of the first element */
+        input_buffer->offset--;
+        goto element;
+    }
+
+    goto fail;
+
+element:
+    /* the next element of the array or object on top of the stack, offset is on the '[', '{' or ',' in front of it */
+    frame = (parse_frame*)walk_top(&stack);
+    new_item = parse_new_item(input_buffer);
+    if (new_item == NULL)
+    {
+        goto fail; /* allocation failure */
+    }
+
+    /* attach next item to list */
+    if (frame->head == NULL)
+    {
+        /* start the linked list */
+        frame->head = new_item;
+    }
+    else
+    {
+        /* add to the end and advance */
+        frame->tail->next = new_item;
+        new_item->prev = frame->tail;
+    }
+    frame->tail = new_item;
+    current = new_item;
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (frame->object)
+    {
+        /* parse the name of the child */
+        if (!parse_string(current, input_buffer))
+        {
+            goto fail; /* failed to parse name */
+        }
+        buffer_skip_whitespace(input_buffer);
+
+        /* swap valuestring and string, because we parsed the name */
+        current->string = current->valuestring;
+        current->valuestring = NULL;
+
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+        {
+            goto fail; /* invalid object */
+        }
+
+        /* parse the value */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+    }
+    goto value;
+
+parsed:
+    /* current is complete, see what comes after it in the array or object it is in */
+    while (stack.count > 0)
+    {
+        frame = (parse_frame*)walk_top(&stack);
+        parse_claim(input_buffer, current);
+        buffer_skip_whitespace(input_buffer);
+        if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','))
+        {
+            goto element;
+        }
+
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != (frame->object ? '}' : ']')))
+        {
+            goto fail; /* expected end of array or object */
+        }
+
+        input_buffer->depth--;
+        current = frame->item;
+        current->type = frame->object ? cJSON_Object : cJSON_Array;
+        current->child = frame->head;
+        input_buffer->offset++;
+        walk_pop(&stack);
+    }
+
+    walk_free(&stack);
+
+    return true;
+
+fail:
+    /* drop the lists of the arrays and objects still open, innermost first */
+    while (stack.count > 0)
+    {
+        frame = (parse_frame*)walk_top(&stack);
+        parse_discard(input_buffer, frame->head);
+        walk_pop(&stack);
+    }
+    walk_free(&stack);
+
+    return false;
+}
+
+/* Render a value to text, the arrays and objects it is in the middle of are kept on an explicit stack. */
+static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+{
+    walk_stack stack;
+    const cJSON **frame = NULL;
+    const cJSON *current = item;
+    unsigned char *output = NULL;
+    size_t length = 0;
+    size_t i = 0;
+
+    if ((item == NULL) || (output_buffer == NULL))
+    {
+        return false;
+    }
+
+    walk_init(&stack, sizeof(const cJSON*), &output_buffer->hooks);
+
+value:
+    switch ((current->type) & 0xFF)
+    {
+        case cJSON_NULL:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                goto fail;
+            }
+            strcpy((char*)output, "null");
+            goto printed;
+
+        case cJSON_False:
+            output = ensure(output_buffer, 6);
+            if (output == NULL)
+            {
+                goto fail;
+            }
+            strcpy((char*)output, "false");
+            goto printed;
+
+        case cJSON_True:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                goto fail;
+            }
+            strcpy((char*)output, "true");
+            goto printed;
+
+        case cJSON_Number:
+            if (!print_number(current, output_buffer))
+            {
+                goto fail;
+            }
+            goto printed;
+
+        case cJSON_Raw:
+            if (current->valuestring == NULL)
+            {
+                goto fail;
+            }
+
+            length = strlen(current->valuestring) + sizeof("");
+            output = ensure(output_buffer, length);
+            if (output == NULL)
+            {
+                goto fail;
+            }
+            memcpy(output, current->valuestring, length);
+            goto printed;
+
+        case cJSON_String:
+            if (!print_string(current, output_buffer))
+            {
+                goto fail;
+            }
+            goto printed;
+
+        case cJSON_Array:
+            /* opening square bracket */
+            output = ensure(output_buffer, 1);
+            if (output == NULL)
+            {
+                goto fail;
+            }
+            *output = '[';
+            output_buffer->offset++;
+            output_buffer->depth++;
+
+            if (current->child == NULL)
+            {
+                goto close_array;
+            }
+            frame = (const cJSON**)walk_push(&stack);
+            if (frame == NULL)
+            {
+                goto fail;
+            }
+            *frame = current;
+            current = current->child;
+            goto value;
+
+        case cJSON_Object:
+            length = (size_t) (output_buffer->format ? 2 : 1); /* fmt: {\n */
+            output = ensure(output_buffer, length + 1);
+            if (output == NULL)
+            {
+                goto fail;
+            }
+            *output++ = '{';
+            output_buffer->depth++;
+            if (output_buffer->format)
+            {
+                *output++ = '\n';
+            }
+            output_buffer->offset += length;
+
+            if (current->child == NULL)
+            {
+                goto close_object;
+            }
+            frame = (const cJSON**)walk_push(&stack);
+            if (frame == NULL)
+            {
+                goto fail;
+            }
+            *frame = current;
+            current = current->child;
+            goto member;
+
+        default:
+            goto fail;
+    }
+
+member:
+    /* the key of current, a member of the object on top of the stack */
+    if (output_buffer->format)
+    {
+        output = ensure(output_buffer, output_buffer->depth);
+        if (output == NULL)
+        {
+            goto fail;
+        }
+        for (i = 0; i < output_buffer->depth; i++)
+        {
+            *output++ = '\t';
+        }
+        output_buffer->offset += output_buffer->depth;
+    }
+
+    if (!print_string_ptr((unsigned char*)current->string, output_buffer))
+    {
+        goto fail;
+    }
+    update_offset(output_buffer);
+
+    length = (size_t) (output_buffer->format ? 2 : 1);
+    output = ensure(output_buffer, length);
+    if (output == NULL)
+    {
+        goto fail;
+    }
+    *output++ = ':';
+    if (output_buffer->format)
+    {
+        *output++ = '\t';
+    }
+    output_buffer->offset += length;
+    goto value;
+
+printed:
+    /* current is written, though the offset may not be past it yet; go on with whatever follows it */
+    if (stack.count == 0)
+    {
+        walk_free(&stack);
+        return true;
+    }
+    frame = (const cJSON**)walk_top(&stack);
+    update_offset(output_buffer);
+
+    if (((*frame)->type & 0xFF) == cJSON_Array)
+    {
+        if (current->next == NULL)
+        {
+            current = *frame;
+            walk_pop(&stack);
+            goto close_array;
+        }
+
+        length = (size_t) (output_buffer->format ? 2 : 1);
+        output = ensure(output_buffer, length + 1);
+        if (output == NULL)
+        {
+            goto fail;
+        }
+        *output++ = ',';
+        if (output_buffer->format)
+        {
+            *output++ = ' ';
+        }
+        *output = '\0';
+        output_buffer->offset += length;
+
+        current = current->next;
+        goto value;
+    }
+
+    /* print comma if not last */
+    length = ((size_t)(output_buffer->format ? 1 : 0) + (size_t)(current->next ? 1 : 0));
+    output = ensure(output_buffer, length + 1);
+    if (output == NULL)
+    {
+        goto fail;
+    }
+    if (current->next)
+    {
+        *output++ = ',';
+    }
+    if (output_buffer->format)
+    {
+        *output++ = '\n';
+    }
+    *output = '\0';
+    output_buffer->offset += length;
+
+    if (current->next == NULL)
+    {
+        current = *frame;
+        walk_pop(&stack);
+        goto close_object;
+    }
+    current = current->next;
+    goto member;
+
+close_array:
+    output = ensure(output_buffer, 2);
+    if (output == NULL)
+    {
+        goto fail;
+    }
+    *output++ = ']';
+    *output = '\0';
+    output_buffer->depth--;
+    goto printed;
+
+close_object:
+    output = ensure(output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
+    if (output == NULL)
+    {
+        goto fail;
+    }
+    if (output_buffer->format)
+    {
+        for (i = 0; i < (output_buffer->depth - 1); i++)
+        {
+            *output++ = '\t';
+        }
+    }
+    *output++ = '}';
+    *output = '\0';
+    output_buffer->depth--;
+    goto printed;
+
+fail:
+    walk_free(&stack);
+
+    return false;
+}
+
+/* How many characters print_string_ptr adds to escape each byte. */
+static const unsigned char escape_lengths[256] =
+{
+    5, 5, 5, 5, 5, 5, 5, 5, 1, 1, 1, 5, 1, 1, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0
+};
+
+/* Length of a string printed by print_string_ptr with quotes but without escapes, which are added to escapes. */
+static size_t measure_string_ptr(const unsigned char * const input, size_t * const escapes)
+{
+    const unsigned char *input_pointer = NULL;
+
+    if (input == NULL)
+    {
+        return sizeof("\"\"") - 1;
+    }
+
+    for (input_pointer = input; *input_pointer; input_pointer++)
+    {
+        *escapes += escape_lengths[*input_pointer];
+    }
+
+    return (size_t)(input_pointer - input) + sizeof("\"\"") - 1;
+}
+
+/* Add the exact number of characters print_value writes for item at the given nesting depth to length, those that escape strings go to escapes. */
+static cJSON_bool measure_value(const cJSON * const item, const size_t depth, const cJSON_bool format, size_t * const length, size_t * const escapes)
+{
+    unsigned char number_buffer[number_buffer_size];
+    walk_stack stack;
+    const cJSON **frame = NULL;
+    const cJSON *current = item;
+    int number_length = 0;
+
+    if (item == NULL)
+    {
+        return false;
+    }
+
+    /* the stack holds the arrays and objects current is in, so depth + stack.count is how deep current is */
+    walk_init(&stack, sizeof(const cJSON*), &global_hooks);
+
+value:
+    switch ((current->type) & 0xFF)
+    {
+        case cJSON_NULL:
+        case cJSON_True:
+            *length += 4;
+            break;
+
+        case cJSON_False:
+            *length += 5;
+            break;
+
+        case cJSON_Number:
+            if ((current->valuedouble > -1e15) && (current->valuedouble < 1e15) && ((double)(long long)current->valuedouble == current->valuedouble) && ((current->valuedouble != 0) || ((1 / current->valuedouble) > 0)))
+            {
+                /* whole numbers print all their digits, count them rather than print twice */
+                long long integer = (long long)current->valuedouble;
+                if (integer < 0)
+                {
+                    (*length)++; /* - */
+                }
+                do
+                {
+                    (*length)++;
+                    integer /= 10;
+                } while (integer != 0);
+                break;
+            }
+            number_length = format_number(current->valuedouble, number_buffer);
+            if (number_length < 0)
+            {
+                goto fail;
+            }
+            *length += (size_t)number_length;
+            break;
+
+        case cJSON_Raw:
+            if (current->valuestring == NULL)
+            {
+                goto fail;
+            }
+            *length += strlen(current->valuestring);
+            break;
+
+        case cJSON_String:
+            *length += measure_string_ptr((unsigned char*)current->valuestring, escapes);
+            break;
+
+        case cJSON_Array:
+        case cJSON_Object:
+            if (((current->type) & 0xFF) == cJSON_Array)
+            {
+                *length += 2; /* [] */
+            }
+            else
+            {
+                *length += format ? (3 + depth + stack.count) : 2; /* {\n, the closing tabs and } */
+            }
+            if (current->child == NULL)
+            {
+                break;
+            }
+            frame = (const cJSON**)walk_push(&stack);
+            if (frame == NULL)
+            {
+                goto fail;
+            }
+            *frame = current;
+            current = current->child;
+            goto element;
+
+        default:
+            goto fail;
+    }
+
+    /* current is counted, move on to its next sibling or out of the containers it ends */
+    while (stack.count > 0)
+    {
+        frame = (const cJSON**)walk_top(&stack);
+        if (current->next != NULL)
+        {
+            *length += ((((*frame)->type & 0xFF) == cJSON_Array) && format) ? 2 : 1; /* ", " */
+            current = current->next;
+            goto element;
+        }
+        current = *frame;
+        walk_pop(&stack);
+    }
+
+    walk_free(&stack);
+
+    return true;
+
+element:
+    if ((((*frame)->type) & 0xFF) == cJSON_Object)
+    {
+        if (format)
+        {
+            *length += (depth + stack.count) + 2 + 1; /* indentation, ":\t" and "\n" */
+        }
+        else
+        {
+            *length += 1; /* ":" */
+        }
+        *length += measure_string_ptr((unsigned char*)current->string, escapes);
+    }
+    goto value;
+
+fail:
+    walk_free(&stack);
+
+    return false;
+}
 
-    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
-    {
-       buffer->offset++;
-    }
+CJSON_PUBLIC(size_t) cJSON_PrintedLength(const cJSON *item, cJSON_bool format)
+{
+    size_t length = 0;
+    size_t escapes = 0;
 
-    if (buffer->offset == buffer->length)
+    if (!measure_value(item, 0, format, &length, &escapes))
     {
-        buffer->offset--;
+        return 0;
     }
 
-    return buffer;
+    return length + escapes;
 }
 
-/* skip the UTF-8 BOM (byte order mark) if it is at the beginning of a buffer */
-static parse_buffer *skip_utf8_bom(parse_buffer * const buffer)
+#define writer_bit(bits, depth) ((bits)[(depth) / 8] & (1U << ((depth) % 8)))
+#define writer_set_bit(bits, depth) ((bits)[(depth) / 8] |= (unsigned char)(1U << ((depth) % 8)))
+#define writer_clear_bit(bits, depth) ((bits)[(depth) / 8] &= (unsigned char)~(1U << ((depth) % 8)))
+
+CJSON_PUBLIC(void) cJSON_InitWriter(cJSON_Writer *writer, char *buffer, size_t size)
 {
-    if ((buffer == NULL) || (buffer->content == NULL) || (buffer->offset != 0))
+    if (writer == NULL)
     {
-        return NULL;
+        return;
     }
 
-    if (can_access_at_index(buffer, 4) && (strncmp((const char*)buffer_at_offset(buffer), "\xEF\xBB\xBF", 3) == 0))
+    memset(writer, 0, sizeof(cJSON_Writer));
+    writer->buffer = (unsigned char*)buffer;
+    writer->size = (buffer != NULL) ? size : 0;
+    writer->fixed = (buffer != NULL);
+}
+
+CJSON_PUBLIC(void) cJSON_InitStreamWriter(cJSON_Writer *writer, size_t flush_size, cJSON_WriterFlush flush, void *user)
+{
+    if (writer == NULL)
     {
-        buffer->offset += 3;
+        return;
     }
 
-    return buffer;
+    cJSON_InitWriter(writer, NULL, 0);
+    writer->flush = flush;
+    writer->flush_size = (flush_size > 0) ? flush_size : CJSON_WRITER_FLUSH_SIZE;
+    writer->user = user;
 }
 
-/* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+CJSON_PUBLIC(void) cJSON_ResetWriter(cJSON_Writer *writer)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
-    cJSON *item = NULL;
-
-    /* reset error position */
-    global_error.json = NULL;
-    global_error.position = 0;
-
-    if (value == NULL)
+    if (writer == NULL)
     {
-        goto fail;
+        return;
     }
 
-    buffer.content = (const unsigned char*)value;
-    buffer.length = strlen((const char*)value) + sizeof("");
-    buffer.offset = 0;
-    buffer.hooks = global_hooks;
+    writer->length = 0;
+    writer->flushed = 0;
+    writer->depth = 0;
+    writer->after_key = false;
+    writer->done = false;
+    writer->lines = 0;
+    writer->failed = false;
+}
 
-    item = cJSON_New_Item(&global_hooks);
-    if (item == NULL) /* memory fail */
+CJSON_PUBLIC(void) cJSON_FreeWriter(cJSON_Writer *writer)
+{
+    if ((writer == NULL) || writer->fixed)
     {
-        goto fail;
+        return;
     }
 
-    if (!parse_value(item, buffer_skip_whitespace(skip_utf8_bom(&buffer))))
+    global_hooks.deallocate(writer->buffer);
+    writer->buffer = NULL;
+    writer->size = 0;
+    cJSON_ResetWriter(writer);
+}
+
+/* A printbuffer over the writer's buffer, allocating the buffer on first use. */
+static cJSON_bool writer_begin(cJSON_Writer * const writer, printbuffer * const p)
+{
+    memset(p, 0, sizeof(printbuffer));
+    if (writer == NULL)
     {
-        /* parse failure. ep is set. */
-        goto fail;
+        return false;
     }
 
-    /* if we require null-terminated JSON without appended garbage, skip and then check for a null terminator */
-    if (require_null_terminated)
+    if (!writer->failed && (writer->buffer == NULL))
     {
-        buffer_skip_whitespace(&buffer);
-        if ((buffer.offset >= buffer.length) || buffer_at_offset(&buffer)[0] != '\0')
+        writer->size = (writer->flush_size > 0) ? writer->flush_size : CJSON_WRITER_FLUSH_SIZE;
+        writer->buffer = (unsigned char*)global_hooks.allocate(writer->size);
+        if (writer->buffer == NULL)
         {
-            goto fail;
+            writer->size = 0;
+            writer->failed = true;
         }
     }
-    if (return_parse_end)
-    {
-        *return_parse_end = (const char*)buffer_at_offset(&buffer);
-    }
 
-    return item;
+    p->buffer = writer->buffer;
+    p->length = writer->size;
+    p->offset = writer->length;
+    p->noalloc = writer->fixed;
+    p->hooks = global_hooks;
 
-fail:
-    if (item != NULL)
+    return !writer->failed;
+}
+
+/* Take back what p wrote, handing it to a stream writer's flush once enough piled up. */
+static cJSON_bool writer_end(cJSON_Writer * const writer, const printbuffer * const p, const cJSON_bool written)
+{
+    writer->buffer = p->buffer;
+    writer->size = (p->buffer != NULL) ? p->length : 0;
+    writer->length = p->offset;
+
+    if (!written)
     {
-        cJSON_Delete(item);
+        writer->failed = true;
+        return false;
     }
 
-    if (value != NULL)
+    if ((writer->flush != NULL) && (writer->length >= writer->flush_size))
     {
-        error local_error;
-        local_error.json = (const unsigned char*)value;
-        local_error.position = 0;
-
-        if (buffer.offset < buffer.length)
-        {
-            local_error.position = buffer.offset;
-        }
-        else if (buffer.length > 0)
-        {
-            local_error.position = buffer.length - 1;
-        }
-
-        if (return_parse_end != NULL)
+        if (writer->flush((const char*)writer->buffer, writer->length, writer->user) != writer->length)
         {
-            *return_parse_end = (const char*)local_error.json + local_error.position;
+            writer->failed = true;
+            return false;
         }
-
-        global_error = local_error;
+        writer->flushed += writer->length;
+        writer->length = 0;
     }
 
-    return NULL;
+    return true;
 }
 
-/* Default options for cJSON_Parse */
-CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
+static cJSON_bool writer_token(printbuffer * const p, const char * const token, const size_t length)
 {
-    return cJSON_ParseWithOpts(value, 0, 0);
-}
+    unsigned char *output = ensure(p, length + sizeof(""));
+
+    if (output == NULL)
+    {
+        return false;
+    }
+    memcpy(output, token, length);
+    p->offset += length;
 
-#define cjson_min(a, b) ((a < b) ? a : b)
+    return true;
+}
 
-static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
+/* Check that a value may come next and write the comma in front of it. */
+static cJSON_bool writer_value(cJSON_Writer * const writer, printbuffer * const p)
 {
-    static const size_t default_buffer_size = 256;
-    printbuffer buffer[1];
-    unsigned char *printed = NULL;
+    size_t depth = 0;
 
-    memset(buffer, 0, sizeof(buffer));
+    if (!writer_begin(writer, p))
+    {
+        return false;
+    }
 
-    /* create buffer */
-    buffer->buffer = (unsigned char*) hooks->allocate(default_buffer_size);
-    buffer->length = default_buffer_size;
-    buffer->format = format;
-    buffer->hooks = *hooks;
-    if (buffer->buffer == NULL)
+    if (writer->depth == 0)
     {
-        goto fail;
+        return !writer->done;
     }
 
-    /* print the value */
-    if (!print_value(item, buffer))
+    depth = writer->depth - 1;
+    if (writer_bit(writer->objects, depth))
     {
-        goto fail;
+        /* the comma went in front of the key */
+        return writer->after_key;
     }
-    update_offset(buffer);
 
-    /* check if reallocate is available */
-    if (hooks->reallocate != NULL)
+    return !writer_bit(writer->elements, depth) || writer_token(p, ",", 1);
+}
+
+/* Book a finished value into the container it is in. */
+static void writer_close_value(cJSON_Writer * const writer)
+{
+    writer->after_key = false;
+    if (writer->depth == 0)
     {
-        printed = (unsigned char*) hooks->reallocate(buffer->buffer, buffer->offset + 1);
-        if (printed == NULL) {
-            goto fail;
-        }
-        buffer->buffer = NULL;
+        writer->done = true;
     }
-    else /* otherwise copy the JSON over to a new buffer */
+    else
     {
-        printed = (unsigned char*) hooks->allocate(buffer->offset + 1);
-        if (printed == NULL)
-        {
-            goto fail;
-        }
-        memcpy(printed, buffer->buffer, cjson_min(buffer->length, buffer->offset + 1));
-        printed[buffer->offset] = '\0'; /* just to be sure */
-
-        /* free the buffer */
-        hooks->deallocate(buffer->buffer);
+        writer_set_bit(writer->elements, writer->depth - 1);
     }
+}
 
-    return printed;
+static cJSON_bool writer_open(cJSON_Writer * const writer, const cJSON_bool object)
+{
+    printbuffer p;
+    cJSON_bool written = false;
 
-fail:
-    if (buffer->buffer != NULL)
+    if (!writer_value(writer, &p) || (writer->depth >= CJSON_WRITER_NESTING_LIMIT))
     {
-        hooks->deallocate(buffer->buffer);
+        return (writer != NULL) ? writer_end(writer, &p, false) : false;
     }
 
-    if (printed != NULL)
+    written = writer_token(&p, object ? "{" : "[", 1);
+    if (written)
     {
-        hooks->deallocate(printed);
+        writer->after_key = false;
+        if (object)
+        {
+            writer_set_bit(writer->objects, writer->depth);
+        }
+        else
+        {
+            writer_clear_bit(writer->objects, writer->depth);
+        }
+        writer_clear_bit(writer->elements, writer->depth);
+        writer->depth++;
     }
 
-    return NULL;
-}
-
-/* Render a cJSON item/entity/structure to text. */
-CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item)
-{
-    return (char*)print(item, true, &global_hooks);
-}
-
-CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
-{
-    return (char*)print(item, false, &global_hooks);
+    return writer_end(writer, &p, written);
 }
 
-CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
+static cJSON_bool writer_close(cJSON_Writer * const writer, const cJSON_bool object)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    printbuffer p;
+    cJSON_bool written = false;
 
-    if (prebuffer < 0)
+    if (!writer_begin(writer, &p))
     {
-        return NULL;
+        return false;
     }
 
-    p.buffer = (unsigned char*)global_hooks.allocate((size_t)prebuffer);
-    if (!p.buffer)
+    if ((writer->depth > 0) && !writer->after_key && ((writer_bit(writer->objects, writer->depth - 1) != 0) == object))
     {
-        return NULL;
+        written = writer_token(&p, object ? "}" : "]", 1);
+        if (written)
+        {
+            writer->depth--;
+            writer_close_value(writer);
+        }
     }
 
-    p.length = (size_t)prebuffer;
-    p.offset = 0;
-    p.noalloc = false;
-    p.format = fmt;
-    p.hooks = global_hooks;
+    return writer_end(writer, &p, written);
+}
 
-    if (!print_value(item, &p))
-    {
-        global_hooks.deallocate(p.buffer);
-        return NULL;
-    }
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteObjectStart(cJSON_Writer *writer)
+{
+    return writer_open(writer, true);
+}
 
-    return (char*)p.buffer;
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteObjectEnd(cJSON_Writer *writer)
+{
+    return writer_close(writer, true);
 }
 
-CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buf, const int len, const cJSON_bool fmt)
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteArrayStart(cJSON_Writer *writer)
 {
-    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+    return writer_open(writer, false);
+}
 
-    if ((len < 0) || (buf == NULL))
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteArrayEnd(cJSON_Writer *writer)
+{
+    return writer_close(writer, false);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteKey(cJSON_Writer *writer, const char *key)
+{
+    printbuffer p;
+    size_t depth = 0;
+    cJSON_bool written = false;
+
+    if (!writer_begin(writer, &p))
     {
         return false;
     }
 
-    p.buffer = (unsigned char*)buf;
-    p.length = (size_t)len;
-    p.offset = 0;
-    p.noalloc = true;
-    p.format = fmt;
-    p.hooks = global_hooks;
+    if ((key != NULL) && (writer->depth > 0) && !writer->after_key && writer_bit(writer->objects, writer->depth - 1))
+    {
+        depth = writer->depth - 1;
+        written = (!writer_bit(writer->elements, depth) || writer_token(&p, ",", 1))
+            && print_string_ptr((const unsigned char*)key, &p)
+            && writer_token(&p, ":", 1);
+        writer->after_key = written;
+    }
 
-    return print_value(item, &p);
+    return writer_end(writer, &p, written);
 }
 
-/* Parser core - when encountering text, process appropriately. */
-static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+/* Write one scalar value, which is either text already in JSON form or a string to be escaped. */
+static cJSON_bool writer_scalar(cJSON_Writer * const writer, const char * const text, const size_t length, const cJSON_bool string)
 {
-    if ((input_buffer == NULL) || (input_buffer->content == NULL))
-    {
-        return false; /* no input */
-    }
+    printbuffer p;
+    cJSON_bool written = false;
 
-    /* parse the different types of values */
-    /* null */
-    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
-    {
-        item->type = cJSON_NULL;
-        input_buffer->offset += 4;
-        return true;
-    }
-    /* false */
-    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
-    {
-        item->type = cJSON_False;
-        input_buffer->offset += 5;
-        return true;
-    }
-    /* true */
-    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
-    {
-        item->type = cJSON_True;
-        item->valueint = 1;
-        input_buffer->offset += 4;
-        return true;
-    }
-    /* string */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
-    {
-        return parse_string(item, input_buffer);
-    }
-    /* number */
-    if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
-    {
-        return parse_number(item, input_buffer);
-    }
-    /* array */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '['))
+    if (!writer_value(writer, &p))
     {
-        return parse_array(item, input_buffer);
+        return (writer != NULL) ? writer_end(writer, &p, false) : false;
     }
-    /* object */
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '{'))
+
+    written = string ? print_string_ptr((const unsigned char*)text, &p) : writer_token(&p, text, length);
+    if (written)
     {
-        return parse_object(item, input_buffer);
+        writer_close_value(writer);
     }
 
-    return false;
+    return writer_end(writer, &p, written);
 }
 
-/* Render a value to text. */
-static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteString(cJSON_Writer *writer, const char *string)
 {
-    unsigned char *output = NULL;
-
-    if ((item == NULL) || (output_buffer == NULL))
+    if (string == NULL)
     {
-        return false;
+        return writer_scalar(writer, "null", 4, false);
     }
 
-    switch ((item->type) & 0xFF)
-    {
-        case cJSON_NULL:
-            output = ensure(output_buffer, 5);
-            if (output == NULL)
-            {
-                return false;
-            }
-            strcpy((char*)output, "null");
-            return true;
-
-        case cJSON_False:
-            output = ensure(output_buffer, 6);
-            if (output == NULL)
-            {
-                return false;
-            }
-            strcpy((char*)output, "false");
-            return true;
-
-        case cJSON_True:
-            output = ensure(output_buffer, 5);
-            if (output == NULL)
-            {
-                return false;
-            }
-            strcpy((char*)output, "true");
-            return true;
+    return writer_scalar(writer, string, strlen(string), true);
+}
 
-        case cJSON_Number:
-            return print_number(item, output_buffer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteNumber(cJSON_Writer *writer, double number)
+{
+    unsigned char number_buffer[number_buffer_size];
+    int length = format_number(number, number_buffer);
 
-        case cJSON_Raw:
+    if (length < 0)
+    {
+        if (writer != NULL)
         {
-            size_t raw_length = 0;
-            if (item->valuestring == NULL)
-            {
-                return false;
-            }
-
-            raw_length = strlen(item->valuestring) + sizeof("");
-            output = ensure(output_buffer, raw_length);
-            if (output == NULL)
-            {
-                return false;
-            }
-            memcpy(output, item->valuestring, raw_length);
-            return true;
+            writer->failed = true;
         }
+        return false;
+    }
 
-        case cJSON_String:
-            return print_string(item, output_buffer);
-
-        case cJSON_Array:
-            return print_array(item, output_buffer);
-
-        case cJSON_Object:
-            return print_object(item, output_buffer);
+    return writer_scalar(writer, (const char*)number_buffer, (size_t)length, false);
+}
 
-        default:
-            return false;
-    }
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteBool(cJSON_Writer *writer, cJSON_bool boolean)
+{
+    return boolean ? writer_scalar(writer, "true", 4, false) : writer_scalar(writer, "false", 5, false);
 }
 
-/* Build an array from input text. */
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer)
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteNull(cJSON_Writer *writer)
 {
-    cJSON *head = NULL; /* head of the linked list */
-    cJSON *current_item = NULL;
+    return writer_scalar(writer, "null", 4, false);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteItem(cJSON_Writer *writer, const cJSON *item)
+{
+    printbuffer p;
+    cJSON_bool written = false;
 
-    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    if (!writer_value(writer, &p))
     {
-        return false; /* to deeply nested */
+        return (writer != NULL) ? writer_end(writer, &p, false) : false;
     }
-    input_buffer->depth++;
 
-    if (buffer_at_offset(input_buffer)[0] != '[')
+    written = (item != NULL) && print_value(item, &p);
+    if (written)
     {
-        /* not an array */
-        goto fail;
+        /* containers leave their closing bracket past the offset */
+        update_offset(&p);
+        writer_close_value(writer);
     }
 
-    input_buffer->offset++;
-    buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ']'))
+    return writer_end(writer, &p, written);
+}
+
+CJSON_PUBLIC(const char *) cJSON_FinishWriter(cJSON_Writer *writer, size_t *length)
+{
+    if ((writer == NULL) || writer->failed || (writer->buffer == NULL))
     {
-        /* empty array */
-        goto success;
+        return NULL;
     }
-
-    /* check if we skipped to the end of the buffer */
-    if (cannot_access_at_index(input_buffer, 0))
+    /* a value is complete, or nothing was started after the last line */
+    if (!writer->done && ((writer->lines == 0) || (writer->depth > 0)))
     {
-        input_buffer->offset--;
-        goto fail;
+        return NULL;
     }
 
-    /* step back to character in front of the first element */
-    input_buffer->offset--;
-    /* loop through the comma separated array elements */
-    do
+    if ((writer->flush != NULL) && (writer->length > 0))
     {
-        /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
-        if (new_item == NULL)
-        {
-            goto fail; /* allocation failure */
-        }
-
-        /* attach next item to list */
-        if (head == NULL)
-        {
-            /* start the linked list */
-            current_item = head = new_item;
-        }
-        else
-        {
-            /* add to the end and advance */
-            current_item->next = new_item;
-            new_item->prev = current_item;
-            current_item = new_item;
-        }
-
-        /* parse next value */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
+        if (writer->flush((const char*)writer->buffer, writer->length, writer->user) != writer->length)
         {
-            goto fail; /* failed to parse value */
+            writer->failed = true;
+            return NULL;
         }
-        buffer_skip_whitespace(input_buffer);
+        writer->flushed += writer->length;
+        writer->length = 0;
     }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
 
-    if (cannot_access_at_index(input_buffer, 0) || buffer_at_offset(input_buffer)[0] != ']')
+    /* every token left room for this */
+    writer->buffer[writer->length] = '\0';
+    if (length != NULL)
     {
-        goto fail; /* expected end of array */
+        *length = writer->flushed + writer->length;
     }
 
-success:
-    input_buffer->depth--;
-
-    item->type = cJSON_Array;
-    item->child = head;
-
-    input_buffer->offset++;
+    return (const char*)writer->buffer;
+}
 
-    return true;
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteLine(cJSON_Writer *writer)
+{
+    printbuffer p;
 
-fail:
-    if (head != NULL)
+    if (!writer_begin(writer, &p) || !writer->done || !writer_token(&p, "\n", 1))
     {
-        cJSON_Delete(head);
+        return (writer != NULL) ? writer_end(writer, &p, false) : false;
     }
+    writer->done = false;
+    writer->lines++;
 
-    return false;
+    return writer_end(writer, &p, true);
 }
 
-/* Render an array to text */
-static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer)
+static cJSON_bool line_reader_init(cJSON_LineReader * const reader)
 {
-    unsigned char *output_pointer = NULL;
-    size_t length = 0;
-    cJSON *current_element = item->child;
+    reader->arena = cJSON_CreateArena(0);
 
-    if (output_buffer == NULL)
-    {
-        return false;
-    }
+    return reader->arena != NULL;
+}
 
-    /* Compose the output array. */
-    /* opening square bracket */
-    output_pointer = ensure(output_buffer, 1);
-    if (output_pointer == NULL)
+CJSON_PUBLIC(cJSON_bool) cJSON_InitLineReader(cJSON_LineReader *reader, const char *data, size_t length)
+{
+    if (reader == NULL)
     {
         return false;
     }
 
-    *output_pointer = '[';
-    output_buffer->offset++;
-    output_buffer->depth++;
+    memset(reader, 0, sizeof(cJSON_LineReader));
+    reader->data = (data != NULL) ? data : "";
+    reader->length = (data != NULL) ? length : 0;
+    reader->end = true;
 
-    while (current_element != NULL)
-    {
-        if (!print_value(current_element, output_buffer))
-        {
-            return false;
-        }
-        update_offset(output_buffer);
-        if (current_element->next)
-        {
-            length = (size_t) (output_buffer->format ? 2 : 1);
-            output_pointer = ensure(output_buffer, length + 1);
-            if (output_pointer == NULL)
-            {
-                return false;
-            }
-            *output_pointer++ = ',';
-            if(output_buffer->format)
-            {
-                *output_pointer++ = ' ';
-            }
-            *output_pointer = '\0';
-            output_buffer->offset += length;
-        }
-        current_element = current_element->next;
-    }
+    return line_reader_init(reader);
+}
 
-    output_pointer = ensure(output_buffer, 2);
-    if (output_pointer == NULL)
+CJSON_PUBLIC(cJSON_bool) cJSON_InitStreamLineReader(cJSON_LineReader *reader, size_t fill_size, cJSON_ReaderFill fill, void *user)
+{
+    if (reader == NULL)
     {
         return false;
     }
-    *output_pointer++ = ']';
-    *output_pointer = '\0';
-    output_buffer->depth--;
 
-    return true;
+    memset(reader, 0, sizeof(cJSON_LineReader));
+    reader->data = "";
+    reader->fill_size = (fill_size > 0) ? fill_size : CJSON_READER_FILL_SIZE;
+    reader->fill = fill;
+    reader->user = user;
+    reader->end = (fill == NULL);
+
+    return line_reader_init(reader);
 }
 
-/* Build an object from the text. */
-static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer)
+/* Read more of a stream into the buffer, moving the line it is on to the front and growing the buffer if that line fills it. */
+static cJSON_bool line_reader_fill(cJSON_LineReader * const reader)
 {
-    cJSON *head = NULL; /* linked list head */
-    cJSON *current_item = NULL;
-
-    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
-    {
-        return false; /* to deeply nested */
-    }
-    input_buffer->depth++;
-
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '{'))
-    {
-        goto fail; /* not an object */
-    }
+    char *buffer = reader->buffer;
+    size_t size = reader->size;
+    size_t filled = 0;
 
-    input_buffer->offset++;
-    buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '}'))
-    {
-        goto success; /* empty object */
-    }
-
-    /* check if we skipped to the end of the buffer */
-    if (cannot_access_at_index(input_buffer, 0))
+    reader->length -= reader->offset;
+    if ((reader->offset > 0) && (reader->length > 0))
     {
-        input_buffer->offset--;
-        goto fail;
+        memmove(reader->buffer, reader->buffer + reader->offset, reader->length);
     }
+    reader->offset = 0;
 
-    /* step back to character in front of the first element */
-    input_buffer->offset--;
-    /* loop through the comma separated array elements */
-    do
+    if ((size - reader->length) < (reader->fill_size / 2))
     {
-        /* allocate next item */
-        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
-        if (new_item == NULL)
+        size = (size > 0) ? (size * 2) : reader->fill_size;
+        if (size < reader->size)
         {
-            goto fail; /* allocation failure */
-        }
-
-        /* attach next item to list */
-        if (head == NULL)
-        {
-            /* start the linked list */
-            current_item = head = new_item;
-        }
-        else
-        {
-            /* add to the end and advance */
-            current_item->next = new_item;
-            new_item->prev = current_item;
-            current_item = new_item;
-        }
-
-        /* parse the name of the child */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_string(current_item, input_buffer))
-        {
-            goto fail; /* failed to parse name */
+            return false;
         }
-        buffer_skip_whitespace(input_buffer);
-
-        /* swap valuestring and string, because we parsed the name */
-        current_item->string = current_item->valuestring;
-        current_item->valuestring = NULL;
-
-        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+        buffer = (char*)global_hooks.allocate(size);
+        if (buffer == NULL)
         {
-            goto fail; /* invalid object */
+            return false;
         }
-
-        /* parse the value */
-        input_buffer->offset++;
-        buffer_skip_whitespace(input_buffer);
-        if (!parse_value(current_item, input_buffer))
+        if (reader->length > 0)
         {
-            goto fail; /* failed to parse value */
+            memcpy(buffer, reader->buffer, reader->length);
         }
-        buffer_skip_whitespace(input_buffer);
+        global_hooks.deallocate(reader->buffer);
+        reader->buffer = buffer;
+        reader->size = size;
     }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
 
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '}'))
+    filled = reader->fill(reader->buffer + reader->length, reader->size - reader->length, reader->user);
+    if ((filled == 0) || (filled > (reader->size - reader->length)))
     {
-        goto fail; /* expected end of object */
+        reader->end = true;
     }
-
-success:
-    input_buffer->depth--;
-
-    item->type = cJSON_Object;
-    item->child = head;
-
-    input_buffer->offset++;
-    return true;
-
-fail:
-    if (head != NULL)
+    else
     {
-        cJSON_Delete(head);
+        reader->length += filled;
     }
+    reader->data = reader->buffer;
 
-    return false;
+    return true;
 }
 
-/* Render an object to text. */
-static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer)
+CJSON_PUBLIC(int) cJSON_ReadLine(cJSON_LineReader *reader, cJSON **value)
 {
-    unsigned char *output_pointer = NULL;
+    cJSON_ParseStatus status;
+    const char *line = NULL;
+    const char *newline = NULL;
+    size_t searched = 0;
     size_t length = 0;
-    cJSON *current_item = item->child;
-
-    if (output_buffer == NULL)
-    {
-        return false;
-    }
-
-    /* Compose the output: */
-    length = (size_t) (output_buffer->format ? 2 : 1); /* fmt: {\n */
-    output_pointer = ensure(output_buffer, length + 1);
-    if (output_pointer == NULL)
-    {
-        return false;
-    }
+    size_t start = 0;
 
-    *output_pointer++ = '{';
-    output_buffer->depth++;
-    if (output_buffer->format)
+    if ((reader == NULL) || (value == NULL))
     {
-        *output_pointer++ = '\n';
+        return cJSON_LineFailed;
     }
-    output_buffer->offset += length;
+    *value = NULL;
 
-    while (current_item)
+    for (;;)
     {
-        if (output_buffer->format)
+        /* the end of the next line, reading more of a stream until there is one */
+        searched = reader->offset;
+        newline = NULL;
+        while ((newline = (const char*)memchr(reader->data + searched, '\n', reader->length - searched)) == NULL)
         {
-            size_t i;
-            output_pointer = ensure(output_buffer, output_buffer->depth);
-            if (output_pointer == NULL)
+            if (reader->end)
             {
-                return false;
+                break;
             }
-            for (i = 0; i < output_buffer->depth; i++)
+            searched = reader->length - reader->offset;
+            if (!line_reader_fill(reader))
             {
-                *output_pointer++ = '\t';
+                return cJSON_LineFailed;
             }
-            output_buffer->offset += output_buffer->depth;
-        }
-
-        /* print key */
-        if (!print_string_ptr((unsigned char*)current_item->string, output_buffer))
-        {
-            return false;
-        }
-        update_offset(output_buffer);
-
-        length = (size_t) (output_buffer->format ? 2 : 1);
-        output_pointer = ensure(output_buffer, length);
-        if (output_pointer == NULL)
-        {
-            return false;
         }
-        *output_pointer++ = ':';
-        if (output_buffer->format)
+        if ((newline == NULL) && (reader->offset == reader->length))
         {
-            *output_pointer++ = '\t';
+            return cJSON_LineEnd;
         }
-        output_buffer->offset += length;
 
-        /* print value */
-        if (!print_value(current_item, output_buffer))
-        {
-            return false;
-        }
-        update_offset(output_buffer);
+        line = reader->data + reader->offset;
+        length = (newline != NULL) ? (size_t)(newline - line) : (reader->length - reader->offset);
+        reader->offset += length + ((newline != NULL) ? 1 : 0);
+        reader->line++;
 
-        /* print comma if not last */
-        length = ((size_t)(output_buffer->format ? 1 : 0) + (size_t)(current_item->next ? 1 : 0));
-        output_pointer = ensure(output_buffer, length + 1);
-        if (output_pointer == NULL)
-        {
-            return false;
-        }
-        if (current_item->next)
+        for (start = 0; (start < length) && ((line[start] == ' ') || (line[start] == '\t') || (line[start] == '\r')); start++)
         {
-            *output_pointer++ = ',';
         }
-
-        if (output_buffer->format)
+        if (start < length)
         {
-            *output_pointer++ = '\n';
+            break;
         }
-        *output_pointer = '\0';
-        output_buffer->offset += length;
-
-        current_item = current_item->next;
     }
 
-    output_pointer = ensure(output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
-    if (output_pointer == NULL)
+    cJSON_ResetArena(reader->arena);
+    *value = cJSON_ParseBufferInArena(line, length, &status, reader->arena);
+    for (; (status.end < length) && ((line[status.end] == ' ') || (line[status.end] == '\t') || (line[status.end] == '\r')); status.end++)
     {
-        return false;
     }
-    if (output_buffer->format)
+    if ((*value == NULL) || (status.end != length))
     {
-        size_t i;
-        for (i = 0; i < (output_buffer->depth - 1); i++)
-        {
-            *output_pointer++ = '\t';
-        }
+        *value = NULL;
+        reader->column = status.end + 1;
+        return cJSON_LineInvalid;
     }
-    *output_pointer++ = '}';
-    *output_pointer = '\0';
-    output_buffer->depth--;
 
-    return true;
+    return cJSON_LineValue;
+}
+
+CJSON_PUBLIC(void) cJSON_FreeLineReader(cJSON_LineReader *reader)
+{
+    if (reader == NULL)
+    {
+        return;
+    }
+
+    global_hooks.deallocate(reader->buffer);
+    cJSON_DeleteArena(reader->arena);
+    reader->buffer = NULL;
+    reader->arena = NULL;
+    reader->data = "";
+    reader->length = 0;
+    reader->offset = 0;
 }
 
 /* Get Array size/item / object item. */
@@ -1837,6 +5862,7 @@ static void suffix_object(cJSON *prev, cJSON *item)
 static cJSON *create_reference(const cJSON *item, const internal_hooks * const hooks)
 {
     cJSON *reference = NULL;
+    int pooled = 0;
     if (item == NULL)
     {
         return NULL;
@@ -1848,9 +5874,11 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
         return NULL;
     }
 
+    pooled = reference->type & cJSON_Pooled;
     memcpy(reference, item, sizeof(cJSON));
     reference->string = NULL;
-    reference->type |= cJSON_IsReference;
+    /* the reference's node is its own, whatever the node it refers to came from */
+    reference->type = (reference->type & ~(cJSON_Pooled | cJSON_InArena | cJSON_OwnsBuffer)) | pooled | cJSON_IsReference;
     reference->next = reference->prev = NULL;
     return reference;
 }
@@ -1890,21 +5918,6 @@ CJSON_PUBLIC(void) cJSON_AddItemToArray(cJSON *array, cJSON *item)
     add_item_to_array(array, item);
 }
 
-#if defined(__clang__) || (defined(__GNUC__)  && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
-    #pragma GCC diagnostic push
-#endif
-#ifdef __GNUC__
-#pragma GCC diagnostic ignored "-Wcast-qual"
-#endif
-/* helper function to cast away const */
-static void* cast_away_const(const void* string)
-{
-    return (void*)string;
-}
-#if defined(__clang__) || (defined(__GNUC__)  && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
-    #pragma GCC diagnostic pop
-#endif
-
 
 static cJSON_bool add_item_to_object(cJSON * const object, const char * const string, cJSON * const item, const internal_hooks * const hooks, const cJSON_bool constant_key)
 {
@@ -1948,6 +5961,19 @@ CJSON_PUBLIC(void) cJSON_AddItemToObject(cJSON *object, const char *string, cJSO
     add_item_to_object(object, string, item, &global_hooks, false);
 }
 
+CJSON_PUBLIC(void) cJSON_AddItemToObjectWithContext(cJSON_Context *context, cJSON *object, const char *string, cJSON *item)
+{
+    internal_hooks hooks;
+
+    if (context == NULL)
+    {
+        return;
+    }
+
+    hooks = context_hooks(context);
+    add_item_to_object(object, string, item, &hooks, false);
+}
+
 /* Add an item to an object with constant string as key */
 CJSON_PUBLIC(void) cJSON_AddItemToObjectCS(cJSON *object, const char *string, cJSON *item)
 {
@@ -2262,7 +6288,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNull(void)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if(item)
     {
-        item->type = cJSON_NULL;
+        item->type |= cJSON_NULL;
     }
 
     return item;
@@ -2273,7 +6299,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateTrue(void)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if(item)
     {
-        item->type = cJSON_True;
+        item->type |= cJSON_True;
     }
 
     return item;
@@ -2284,7 +6310,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateFalse(void)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if(item)
     {
-        item->type = cJSON_False;
+        item->type |= cJSON_False;
     }
 
     return item;
@@ -2295,7 +6321,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateBool(cJSON_bool b)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if(item)
     {
-        item->type = b ? cJSON_True : cJSON_False;
+        item->type |= b ? cJSON_True : cJSON_False;
     }
 
     return item;
@@ -2306,7 +6332,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if(item)
     {
-        item->type = cJSON_Number;
+        item->type |= cJSON_Number;
         item->valuedouble = num;
 
         /* use saturation in case of overflow */
@@ -2327,16 +6353,16 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
     return item;
 }
 
-CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
+static cJSON *create_string(const char *string, const internal_hooks * const hooks)
 {
-    cJSON *item = cJSON_New_Item(&global_hooks);
+    cJSON *item = cJSON_New_Item(hooks);
     if(item)
     {
-        item->type = cJSON_String;
-        item->valuestring = (char*)cJSON_strdup((const unsigned char*)string, &global_hooks);
+        item->type |= cJSON_String;
+        item->valuestring = (char*)cJSON_strdup((const unsigned char*)string, hooks);
         if(!item->valuestring)
         {
-            cJSON_Delete(item);
+            delete_item(item, hooks);
             return NULL;
         }
     }
@@ -2344,12 +6370,31 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
     return item;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
+{
+    return create_string(string, &global_hooks);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_CreateStringWithContext(cJSON_Context *context, const char *string)
+{
+    internal_hooks hooks;
+
+    if (context == NULL)
+    {
+        return NULL;
+    }
+
+    hooks = context_hooks(context);
+
+    return create_string(string, &hooks);
+}
+
 CJSON_PUBLIC(cJSON *) cJSON_CreateStringReference(const char *string)
 {
     cJSON *item = cJSON_New_Item(&global_hooks);
     if (item != NULL)
     {
-        item->type = cJSON_String | cJSON_IsReference;
+        item->type |= cJSON_String | cJSON_IsReference;
         item->valuestring = (char*)cast_away_const(string);
     }
 
@@ -2360,7 +6405,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateObjectReference(const cJSON *child)
 {
     cJSON *item = cJSON_New_Item(&global_hooks);
     if (item != NULL) {
-        item->type = cJSON_Object | cJSON_IsReference;
+        item->type |= cJSON_Object | cJSON_IsReference;
         item->child = (cJSON*)cast_away_const(child);
     }
 
@@ -2370,7 +6415,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateObjectReference(const cJSON *child)
 CJSON_PUBLIC(cJSON *) cJSON_CreateArrayReference(const cJSON *child) {
     cJSON *item = cJSON_New_Item(&global_hooks);
     if (item != NULL) {
-        item->type = cJSON_Array | cJSON_IsReference;
+        item->type |= cJSON_Array | cJSON_IsReference;
         item->child = (cJSON*)cast_away_const(child);
     }
 
@@ -2382,7 +6427,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateRaw(const char *raw)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if(item)
     {
-        item->type = cJSON_Raw;
+        item->type |= cJSON_Raw;
         item->valuestring = (char*)cJSON_strdup((const unsigned char*)raw, &global_hooks);
         if(!item->valuestring)
         {
@@ -2399,7 +6444,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateArray(void)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if(item)
     {
-        item->type=cJSON_Array;
+        item->type |= cJSON_Array;
     }
 
     return item;
@@ -2410,7 +6455,7 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateObject(void)
     cJSON *item = cJSON_New_Item(&global_hooks);
     if (item)
     {
-        item->type = cJSON_Object;
+        item->type |= cJSON_Object;
     }
 
     return item;
@@ -2561,31 +6606,24 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char **strings, int count)
 }
 
 /* Duplication */
-CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
+/* Copy one item without its children. */
+static cJSON *duplicate_node(const cJSON *item, const internal_hooks * const hooks)
 {
     cJSON *newitem = NULL;
-    cJSON *child = NULL;
-    cJSON *next = NULL;
-    cJSON *newchild = NULL;
 
-    /* Bail on bad ptr */
-    if (!item)
-    {
-        goto fail;
-    }
     /* Create new item */
-    newitem = cJSON_New_Item(&global_hooks);
+    newitem = cJSON_New_Item(hooks);
     if (!newitem)
     {
         goto fail;
     }
-    /* Copy over all vars */
-    newitem->type = item->type & (~cJSON_IsReference);
+    /* Copy over all vars, the copy's node is its own */
+    newitem->type = (newitem->type & cJSON_Pooled) | (item->type & (~(cJSON_IsReference | cJSON_InArena | cJSON_InSitu | cJSON_Interned | cJSON_Pooled | cJSON_OwnsBuffer)));
     newitem->valueint = item->valueint;
     newitem->valuedouble = item->valuedouble;
     if (item->valuestring)
     {
-        newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &global_hooks);
+        newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, hooks);
         if (!newitem->valuestring)
         {
             goto fail;
@@ -2593,51 +6631,140 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
     }
     if (item->string)
     {
-        newitem->string = (item->type&cJSON_StringIsConst) ? item->string : (char*)cJSON_strdup((unsigned char*)item->string, &global_hooks);
+        /* keys of arena, in-situ and interned items are marked const but die with their arena, buffer or table */
+        if ((item->type & cJSON_StringIsConst) && !(item->type & (cJSON_InArena | cJSON_InSitu | cJSON_Interned)))
+        {
+            newitem->string = item->string;
+        }
+        else
+        {
+            newitem->string = (char*)cJSON_strdup((unsigned char*)item->string, hooks);
+            newitem->type &= ~cJSON_StringIsConst;
+        }
         if (!newitem->string)
         {
             goto fail;
         }
     }
+
+    return newitem;
+
+fail:
+    if (newitem != NULL)
+    {
+        delete_item(newitem, hooks);
+    }
+
+    return NULL;
+}
+
+/* A container being copied: the original, its copy and the last child the copy has so far. */
+typedef struct
+{
+    const cJSON *item;
+    cJSON *copy;
+    cJSON *tail;
+} duplicate_frame;
+
+static cJSON *duplicate(const cJSON *item, cJSON_bool recurse, const internal_hooks * const hooks)
+{
+    walk_stack stack;
+    duplicate_frame *frame = NULL;
+    const cJSON *current = item;
+    cJSON *newitem = NULL;
+    cJSON *copy = NULL;
+
+    /* Bail on bad ptr */
+    if (!item)
+    {
+        return NULL;
+    }
+    newitem = duplicate_node(item, hooks);
     /* If non-recursive, then we're done! */
-    if (!recurse)
+    if ((newitem == NULL) || !recurse)
     {
         return newitem;
     }
-    /* Walk the ->next chain for the child. */
-    child = item->child;
-    while (child != NULL)
+
+    /* Copy the children in the order the recursion used to, each one right before its own children. */
+    walk_init(&stack, sizeof(duplicate_frame), hooks);
+    copy = newitem;
+    for (;;)
     {
-        newchild = cJSON_Duplicate(child, true); /* Duplicate (with recurse) each item in the ->next chain */
-        if (!newchild)
+        if (current->child != NULL)
+        {
+            frame = (duplicate_frame*)walk_push(&stack);
+            if (frame == NULL)
+            {
+                goto fail;
+            }
+            frame->item = current;
+            frame->copy = copy;
+            frame->tail = NULL;
+            current = current->child;
+        }
+        else
+        {
+            /* climb out of the containers current was the last child of */
+            while ((stack.count > 0) && (current->next == NULL))
+            {
+                current = ((duplicate_frame*)walk_top(&stack))->item;
+                walk_pop(&stack);
+            }
+            if (stack.count == 0)
+            {
+                break;
+            }
+            current = current->next;
+        }
+
+        frame = (duplicate_frame*)walk_top(&stack);
+        copy = duplicate_node(current, hooks);
+        if (copy == NULL)
         {
             goto fail;
         }
-        if (next != NULL)
+        if (frame->tail != NULL)
         {
-            /* If newitem->child already set, then crosswire ->prev and ->next and move on */
-            next->next = newchild;
-            newchild->prev = next;
-            next = newchild;
+            /* If the copy already has children, then crosswire ->prev and ->next and move on */
+            frame->tail->next = copy;
+            copy->prev = frame->tail;
         }
         else
         {
-            /* Set newitem->child and move to it */
-            newitem->child = newchild;
-            next = newchild;
+            frame->copy->child = copy;
         }
-        child = child->next;
+        frame->tail = copy;
     }
 
+    walk_free(&stack);
+
     return newitem;
 
 fail:
-    if (newitem != NULL)
+    walk_free(&stack);
+    delete_item(newitem, hooks);
+
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
+{
+    return duplicate(item, recurse, &global_hooks);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_DuplicateWithContext(cJSON_Context *context, const cJSON *item, cJSON_bool recurse)
+{
+    internal_hooks hooks;
+
+    if (context == NULL)
     {
-        cJSON_Delete(newitem);
+        return NULL;
     }
 
-    return NULL;
+    hooks = context_hooks(context);
+
+    return duplicate(item, recurse, &hooks);
 }
 
 static void skip_oneline_comment(char **input)
@@ -2835,15 +6962,34 @@ CJSON_PUBLIC(cJSON_bool) cJSON_IsRaw(const cJSON * const item)
     return (item->type & 0xFF) == cJSON_Raw;
 }
 
+/* An array or object pair being compared, with where the comparison is in each of them. */
+typedef struct
+{
+    const cJSON *a;
+    const cJSON *b;
+    const cJSON *a_element;
+    const cJSON *b_element;
+    cJSON_bool second_pass;
+} compare_frame;
+
 CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive)
 {
-    if ((a == NULL) || (b == NULL) || ((a->type & 0xFF) != (b->type & 0xFF)) || cJSON_IsInvalid(a))
+    walk_stack stack;
+    compare_frame *frame = NULL;
+    const cJSON *x = a;
+    const cJSON *y = b;
+    const cJSON *element = NULL;
+
+    walk_init(&stack, sizeof(compare_frame), &global_hooks);
+
+compare:
+    if ((x == NULL) || (y == NULL) || ((x->type & 0xFF) != (y->type & 0xFF)) || cJSON_IsInvalid(x))
     {
-        return false;
+        goto unequal;
     }
 
     /* check if type is valid */
-    switch (a->type & 0xFF)
+    switch (x->type & 0xFF)
     {
         case cJSON_False:
         case cJSON_True:
@@ -2856,108 +7002,500 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
             break;
 
         default:
-            return false;
+            goto unequal;
     }
 
     /* identical objects are equal */
-    if (a == b)
+    if (x == y)
     {
-        return true;
+        goto equal;
     }
 
-    switch (a->type & 0xFF)
+    switch (x->type & 0xFF)
     {
         /* in these cases and equal type is enough */
         case cJSON_False:
         case cJSON_True:
         case cJSON_NULL:
-            return true;
+            goto equal;
 
         case cJSON_Number:
-            if (a->valuedouble == b->valuedouble)
+            if (x->valuedouble == y->valuedouble)
             {
-                return true;
+                goto equal;
             }
-            return false;
+            goto unequal;
 
         case cJSON_String:
         case cJSON_Raw:
-            if ((a->valuestring == NULL) || (b->valuestring == NULL))
+            if ((x->valuestring == NULL) || (y->valuestring == NULL))
             {
-                return false;
+                goto unequal;
             }
-            if (strcmp(a->valuestring, b->valuestring) == 0)
+            if (strcmp(x->valuestring, y->valuestring) == 0)
             {
-                return true;
+                goto equal;
             }
+            goto unequal;
 
-            return false;
+        default:
+            /* arrays and objects, their elements are compared from the stack */
+            frame = (compare_frame*)walk_push(&stack);
+            if (frame == NULL)
+            {
+                goto unequal;
+            }
+            frame->a = x;
+            frame->b = y;
+            frame->a_element = x->child;
+            frame->b_element = y->child;
+            frame->second_pass = false;
+            goto equal;
+    }
 
-        case cJSON_Array:
-        {
-            cJSON *a_element = a->child;
-            cJSON *b_element = b->child;
+equal:
+    while (stack.count > 0)
+    {
+        frame = (compare_frame*)walk_top(&stack);
 
-            for (; (a_element != NULL) && (b_element != NULL);)
+        if ((frame->a->type & 0xFF) == cJSON_Array)
+        {
+            if ((frame->a_element != NULL) && (frame->b_element != NULL))
             {
-                if (!cJSON_Compare(a_element, b_element, case_sensitive))
-                {
-                    return false;
-                }
-
-                a_element = a_element->next;
-                b_element = b_element->next;
+                x = frame->a_element;
+                y = frame->b_element;
+                frame->a_element = x->next;
+                frame->b_element = y->next;
+                goto compare;
             }
 
             /* one of the arrays is longer than the other */
-            if (a_element != b_element) {
-                return false;
+            if (frame->a_element != frame->b_element)
+            {
+                goto unequal;
             }
 
-            return true;
+            walk_pop(&stack);
+            continue;
         }
 
-        case cJSON_Object:
+        if (!frame->second_pass)
         {
-            cJSON *a_element = NULL;
-            cJSON *b_element = NULL;
-            cJSON_ArrayForEach(a_element, a)
+            /* every member of a has to be in b */
+            if (frame->a_element != NULL)
             {
-                /* TODO This has O(n^2) runtime, which is horrible! */
-                b_element = get_object_item(b, a_element->string, case_sensitive);
-                if (b_element == NULL)
+                x = frame->a_element;
+                frame->a_element = x->next;
+                /* TODO This has O(n^2) runtime without an index, which is horrible! */
+                y = get_object_item(frame->b, x->string, case_sensitive);
+                if (y == NULL)
                 {
-                    return false;
+                    goto unequal;
                 }
+                goto compare;
+            }
+            frame->second_pass = true;
+        }
 
-                if (!cJSON_Compare(a_element, b_element, case_sensitive))
-                {
-                    return false;
-                }
+        /* and the other way round, so that a can't just be a subset of b */
+        while (frame->b_element != NULL)
+        {
+            element = frame->b_element;
+            frame->b_element = element->next;
+            x = get_object_item(frame->a, element->string, case_sensitive);
+            if (x == NULL)
+            {
+                goto unequal;
             }
 
-            /* doing this twice, once on a and b to prevent true comparison if a subset of b
-             * TODO: Do this the proper way, this is just a fix for now */
-            cJSON_ArrayForEach(b_element, b)
+            /* the first member of b with this key was compared with x in the first pass */
+            if (get_object_item(frame->b, x->string, case_sensitive) != element)
             {
-                a_element = get_object_item(a, b_element->string, case_sensitive);
-                if (a_element == NULL)
-                {
-                    return false;
-                }
+                y = element;
+                goto compare;
+            }
+        }
 
-                if (!cJSON_Compare(b_element, a_element, case_sensitive))
-                {
-                    return false;
-                }
+        walk_pop(&stack);
+    }
+
+    walk_free(&stack);
+
+    return true;
+
+unequal:
+    walk_free(&stack);
+
+    return false;
+}
+
+/* Spread the bits of a 32 bit hash (the MurmurHash3 finalizer), so that sums of member hashes stay well mixed. */
+static unsigned long hash_mix(unsigned long hash)
+{
+    hash &= 0xffffffffUL;
+    hash ^= hash >> 16;
+    hash = (hash * 0x85ebca6bUL) & 0xffffffffUL;
+    hash ^= hash >> 13;
+    hash = (hash * 0xc2b2ae35UL) & 0xffffffffUL;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+/* FNV-1a over length bytes, continuing from hash */
+static unsigned long hash_bytes(unsigned long hash, const unsigned char *bytes, size_t length)
+{
+    for (; length > 0; bytes++, length--)
+    {
+        hash = ((hash ^ *bytes) * 16777619UL) & 0xffffffffUL;
+    }
+
+    return hash;
+}
+
+/* The unmixed hash of a scalar, or the seed of an array or object. */
+static unsigned long hash_leaf(const cJSON * const item)
+{
+    const unsigned char type = (unsigned char)(item->type & 0xFF);
+    unsigned long hash = hash_bytes(2166136261UL, &type, 1);
+    double number = 0;
+
+    switch (type)
+    {
+        case cJSON_Number:
+            /* 0 and -0 are equal */
+            if (item->valuedouble != 0)
+            {
+                number = item->valuedouble;
             }
+            hash = hash_bytes(hash, (const unsigned char*)&number, sizeof(number));
+            break;
 
-            return true;
-        }
+        case cJSON_String:
+        case cJSON_Raw:
+            if (item->valuestring != NULL)
+            {
+                hash = hash_bytes(hash, (const unsigned char*)item->valuestring, strlen(item->valuestring));
+            }
+            break;
 
         default:
+            break;
+    }
+
+    return hash;
+}
+
+/* An array or object being hashed, with what its members added up to so far. */
+typedef struct
+{
+    const cJSON *item;
+    const cJSON *element;
+    unsigned long hash;
+} hash_frame;
+
+CJSON_PUBLIC(unsigned long) cJSON_Hash(const cJSON *item)
+{
+    walk_stack stack;
+    hash_frame *frame = NULL;
+    const cJSON *current = item;
+    unsigned long hash = 0;
+
+    if (item == NULL)
+    {
+        return 0;
+    }
+
+    walk_init(&stack, sizeof(hash_frame), &global_hooks);
+
+value:
+    if (!cJSON_IsArray(current) && !cJSON_IsObject(current))
+    {
+        hash = hash_mix(hash_leaf(current));
+        goto hashed;
+    }
+
+    frame = (hash_frame*)walk_push(&stack);
+    if (frame == NULL)
+    {
+        walk_free(&stack);
+        return 0;
+    }
+    frame->item = current;
+    frame->element = current->child;
+    /* arrays fold their elements in one after the other, objects add their members up so that order doesn't matter */
+    frame->hash = cJSON_IsArray(current) ? hash_leaf(current) : 0;
+    goto next;
+
+hashed:
+    if (stack.count == 0)
+    {
+        walk_free(&stack);
+        return (hash != 0) ? hash : 1;
+    }
+
+    frame = (hash_frame*)walk_top(&stack);
+    if (cJSON_IsArray(frame->item))
+    {
+        frame->hash = ((frame->hash ^ hash) * 16777619UL) & 0xffffffffUL;
+    }
+    else
+    {
+        if (current->string != NULL)
+        {
+            hash ^= hash_bytes(2166136261UL, (const unsigned char*)current->string, strlen(current->string));
+        }
+        frame->hash = (frame->hash + hash_mix(hash * 31)) & 0xffffffffUL;
+    }
+
+next:
+    frame = (hash_frame*)walk_top(&stack);
+    if (frame->element != NULL)
+    {
+        current = frame->element;
+        frame->element = current->next;
+        goto value;
+    }
+
+    if (cJSON_IsArray(frame->item))
+    {
+        hash = hash_mix(frame->hash);
+    }
+    else
+    {
+        hash = hash_mix(hash_leaf(frame->item) + frame->hash);
+    }
+    if (hash == 0)
+    {
+        hash = 1;
+    }
+    current = frame->item;
+    walk_pop(&stack);
+    goto hashed;
+}
+
+/* An object member and where it was in its object, which breaks ties between equal keys. */
+typedef struct
+{
+    const cJSON *member;
+    size_t position;
+} equal_member;
+
+static int equal_member_compare(const void *x, const void *y)
+{
+    const equal_member *a = (const equal_member*)x;
+    const equal_member *b = (const equal_member*)y;
+    int order = 0;
+
+    if ((a->member->string != NULL) && (b->member->string != NULL))
+    {
+        order = strcmp(a->member->string, b->member->string);
+    }
+    else
+    {
+        /* members without a key sort first */
+        order = (a->member->string != NULL) - (b->member->string != NULL);
+    }
+    if (order != 0)
+    {
+        return order;
+    }
+
+    return (a->position > b->position) - (a->position < b->position);
+}
+
+static cJSON_bool equal_keys(const char * const a, const char * const b)
+{
+    if ((a == NULL) || (b == NULL))
+    {
+        return a == b;
+    }
+
+    return strcmp(a, b) == 0;
+}
+
+/* An array or object pair being checked by cJSON_Equal. Objects whose keys aren't in the same order are walked sorted. */
+typedef struct
+{
+    const cJSON *a_element;
+    const cJSON *b_element;
+    equal_member *a_members; /* NULL while the elements are walked in order */
+    equal_member *b_members; /* in the same allocation as a_members */
+    size_t count;
+    size_t next;
+} equal_frame;
+
+/* Set frame up to walk the members of a and b. false if they can't be equal or memory ran out. */
+static cJSON_bool equal_open(equal_frame * const frame, const cJSON * const a, const cJSON * const b)
+{
+    const cJSON *a_element = a->child;
+    const cJSON *b_element = b->child;
+    cJSON_bool in_order = true;
+    size_t count = 0;
+    size_t i = 0;
+
+    frame->a_element = a->child;
+    frame->b_element = b->child;
+    frame->a_members = NULL;
+    frame->b_members = NULL;
+    frame->next = 0;
+
+    for (; (a_element != NULL) && (b_element != NULL); a_element = a_element->next, b_element = b_element->next)
+    {
+        if (in_order && cJSON_IsObject(a) && !equal_keys(a_element->string, b_element->string))
+        {
+            in_order = false;
+        }
+        count++;
+    }
+    if (a_element != b_element)
+    {
+        /* one has more members than the other */
+        return false;
+    }
+    frame->count = count;
+    if (in_order)
+    {
+        return true;
+    }
+
+    frame->a_members = (equal_member*)global_hooks.allocate(2 * count * sizeof(equal_member));
+    if (frame->a_members == NULL)
+    {
+        return false;
+    }
+    frame->b_members = frame->a_members + count;
+
+    for (a_element = a->child, b_element = b->child; i < count; a_element = a_element->next, b_element = b_element->next, i++)
+    {
+        frame->a_members[i].member = a_element;
+        frame->a_members[i].position = i;
+        frame->b_members[i].member = b_element;
+        frame->b_members[i].position = i;
+    }
+    qsort(frame->a_members, count, sizeof(equal_member), equal_member_compare);
+    qsort(frame->b_members, count, sizeof(equal_member), equal_member_compare);
+
+    for (i = 0; i < count; i++)
+    {
+        if (!equal_keys(frame->a_members[i].member->string, frame->b_members[i].member->string))
+        {
             return false;
+        }
+    }
+
+    return true;
+}
+
+static void equal_close(equal_frame * const frame)
+{
+    if (frame->a_members != NULL)
+    {
+        global_hooks.deallocate(frame->a_members);
+        frame->a_members = NULL;
+    }
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_Equal(const cJSON * const a, const cJSON * const b)
+{
+    walk_stack stack;
+    equal_frame *frame = NULL;
+    const cJSON *x = a;
+    const cJSON *y = b;
+
+    walk_init(&stack, sizeof(equal_frame), &global_hooks);
+
+compare:
+    if ((x == NULL) || (y == NULL) || ((x->type & 0xFF) != (y->type & 0xFF)))
+    {
+        goto unequal;
+    }
+
+    switch (x->type & 0xFF)
+    {
+        case cJSON_False:
+        case cJSON_True:
+        case cJSON_NULL:
+            goto equal;
+
+        case cJSON_Number:
+            if (x->valuedouble == y->valuedouble)
+            {
+                goto equal;
+            }
+            goto unequal;
+
+        case cJSON_String:
+        case cJSON_Raw:
+            if ((x->valuestring == NULL) || (y->valuestring == NULL))
+            {
+                goto unequal;
+            }
+            if (strcmp(x->valuestring, y->valuestring) == 0)
+            {
+                goto equal;
+            }
+            goto unequal;
+
+        case cJSON_Array:
+        case cJSON_Object:
+            if (x == y)
+            {
+                goto equal;
+            }
+            frame = (equal_frame*)walk_push(&stack);
+            if (frame == NULL)
+            {
+                goto unequal;
+            }
+            if (!equal_open(frame, x, y))
+            {
+                goto unequal;
+            }
+            goto equal;
+
+        default:
+            goto unequal;
+    }
+
+equal:
+    while (stack.count > 0)
+    {
+        frame = (equal_frame*)walk_top(&stack);
+
+        if ((frame->a_members == NULL) && (frame->a_element != NULL))
+        {
+            x = frame->a_element;
+            y = frame->b_element;
+            frame->a_element = x->next;
+            frame->b_element = y->next;
+            goto compare;
+        }
+        if ((frame->a_members != NULL) && (frame->next < frame->count))
+        {
+            x = frame->a_members[frame->next].member;
+            y = frame->b_members[frame->next].member;
+            frame->next++;
+            goto compare;
+        }
+
+        equal_close(frame);
+        walk_pop(&stack);
     }
+
+    walk_free(&stack);
+
+    return true;
+
+unequal:
+    while (stack.count > 0)
+    {
+        equal_close((equal_frame*)walk_top(&stack));
+        walk_pop(&stack);
+    }
+    walk_free(&stack);
+
+    return false;
 }
 
 CJSON_PUBLIC(void *) cJSON_malloc(size_t size)
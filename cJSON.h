@@ -98,6 +98,11 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
+#define cJSON_InArena 1024 /* node and valuestring belong to a cJSON_Arena */
+#define cJSON_InSitu 2048 /* valuestring and string point into the buffer given to cJSON_ParseInSitu */
+#define cJSON_Interned 8192 /* valuestring and string belong to a cJSON_Intern */
+#define cJSON_Pooled 16384 /* the node came from the node pool */
+#define cJSON_OwnsBuffer 65536 /* the root of a cJSON_ParseInSitu tree, its node also holds the buffer */
 
 /* The cJSON structure: */
 typedef struct cJSON
@@ -149,16 +154,296 @@ CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value);
 /* ParseWithOpts allows you to require (and check) that the JSON is null terminated, and to retrieve the pointer to the final byte parsed. */
 /* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match cJSON_GetErrorPtr(). */
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
+/* Where a cJSON_ParseBuffer stopped: just past the value and any whitespace after it, or at the error if failed is set. */
+typedef struct cJSON_ParseStatus
+{
+    size_t end;
+    cJSON_bool failed;
+} cJSON_ParseStatus;
+/* Parse the length bytes at value, which need not be null terminated and are never read past. The whole buffer was one document if status->end == length. status may be NULL. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseBuffer(const char *value, size_t length, cJSON_ParseStatus *status);
+
+/* Nodes can come from a pool of slabs with free lists, so documents that are parsed and deleted over and over stop hitting the allocator. */
+/* The pool is per thread and off until cJSON_EnablePool turns it on. A slab comes from the allocator of the call that needed it and goes back once all its nodes are deleted. */
+/* Pooled nodes must be released through cJSON_Delete (never cJSON_free). Any thread may delete them, nodes deleted on another thread go back to their slab atomically and are reused by the thread that made them. */
+/* Build with CJSON_NO_NODE_POOL to leave the pool out, compilers without GCC style atomics always do. */
+CJSON_PUBLIC(void) cJSON_EnablePool(cJSON_bool enable);
+/* Give the calling thread's unused slabs back, those still in use go back with their last node wherever it is deleted. Call it before a thread that used the pool exits, or its slabs are never freed. */
+CJSON_PUBLIC(void) cJSON_PoolRelease(void);
+typedef struct cJSON_PoolStats
+{
+    size_t slabs; /* slabs taken from the allocator */
+    size_t released; /* slabs handed back */
+    size_t taken; /* nodes handed out */
+    size_t reused; /* of those, nodes that came from the free list */
+    size_t given; /* nodes returned by cJSON_Delete */
+} cJSON_PoolStats;
+/* Counters of the calling thread's pool, all 0 with CJSON_NO_NODE_POOL. */
+CJSON_PUBLIC(void) cJSON_GetPoolStats(cJSON_PoolStats *stats);
+
+/* Arenas: a whole document is carved from a few large blocks instead of one allocation per node and string, and released with a single cJSON_DeleteArena. */
+/* Items parsed into an arena don't need cJSON_Delete, and must not be used after their arena was reset or deleted (use cJSON_Duplicate to keep one). */
+typedef struct cJSON_Arena cJSON_Arena;
+/* block_size is the size of each block taken from the allocator, 0 picks a default. */
+CJSON_PUBLIC(cJSON_Arena *) cJSON_CreateArena(size_t block_size);
+/* Forget everything parsed into the arena but keep its first block for reuse. */
+CJSON_PUBLIC(void) cJSON_ResetArena(cJSON_Arena *arena);
+CJSON_PUBLIC(void) cJSON_DeleteArena(cJSON_Arena *arena);
+/* Like cJSON_Parse/cJSON_ParseWithOpts, but allocating from arena. A NULL arena behaves exactly like the plain variants. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInArena(const char *value, cJSON_Arena *arena);
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOptsInArena(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated, cJSON_Arena *arena);
+CJSON_PUBLIC(cJSON *) cJSON_ParseBufferInArena(const char *value, size_t length, cJSON_ParseStatus *status, cJSON_Arena *arena);
+
+/* In-situ parsing: cJSON takes over buffer and decodes strings into it instead of copying them out, so a document costs little more than its nodes. */
+/* buffer must come from the cJSON allocator (malloc unless cJSON_InitHooks says otherwise). It is freed with the tree by cJSON_Delete, with the arena if one is given, or right away if the parse fails. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *buffer, size_t length, cJSON_ParseStatus *status, cJSON_Arena *arena);
+
+/* Interning: a table that the strings of parsed documents are kept in, with one shared copy of every short string. */
+/* Repeated keys and values then cost neither memory nor an allocation past their first copy. Strings are only freed with the table, */
+/* so cJSON_DeleteIntern must come after the cJSON_Delete of every tree parsed with it. Give it to cJSON_ParseWithContext through the context. */
+#ifndef CJSON_INTERN_MAX_LENGTH
+#define CJSON_INTERN_MAX_LENGTH 255
+#endif
+typedef struct cJSON_InternStats
+{
+    size_t allocations; /* taken from the allocator by the table */
+    size_t strings; /* copies made */
+    size_t shared; /* strings that got an existing copy */
+    size_t bytes; /* held by the copies, the unshared long strings included */
+} cJSON_InternStats;
+typedef struct cJSON_Intern cJSON_Intern;
+/* Strings up to max_length bytes are shared (0 picks 32, at most CJSON_INTERN_MAX_LENGTH), longer ones are kept in the table once each. */
+CJSON_PUBLIC(cJSON_Intern *) cJSON_CreateIntern(size_t max_length);
+CJSON_PUBLIC(void) cJSON_DeleteIntern(cJSON_Intern *intern);
+CJSON_PUBLIC(void) cJSON_GetInternStats(const cJSON_Intern *intern, cJSON_InternStats *stats);
+/* The table's terminated copy of the length bytes at string, shared like a parsed string would be. NULL if out of memory. */
+CJSON_PUBLIC(const char *) cJSON_InternString(cJSON_Intern *intern, const char *string, size_t length);
+
+/* A context carries the allocator and limits of a set of calls so that threads or libraries can use cJSON without sharing cJSON_InitHooks. */
+/* Its allocator is used for nodes, strings, keys and printed text. Delete a tree with the context it came from. */
+/* The calls without a context use cJSON_InitHooks and CJSON_NESTING_LIMIT, cJSON_GetErrorPtr is kept per thread for them. */
+typedef struct cJSON_Context
+{
+    void *(CJSON_CDECL *malloc_fn)(size_t sz);
+    void (CJSON_CDECL *free_fn)(void *ptr);
+    size_t nesting_limit;
+    /* if set, parsed strings come from this table instead of the allocator */
+    cJSON_Intern *intern;
+    /* where the last cJSON_ParseWithContext failed, NULL after a success */
+    const char *error;
+} cJSON_Context;
+
+/* Fill context with hooks (malloc/free if NULL) and CJSON_NESTING_LIMIT. */
+CJSON_PUBLIC(void) cJSON_InitContext(cJSON_Context *context, const cJSON_Hooks *hooks);
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithContext(cJSON_Context *context, const char *value, size_t length, cJSON_ParseStatus *status);
+CJSON_PUBLIC(char *) cJSON_PrintWithContext(cJSON_Context *context, const cJSON *item, cJSON_bool format);
+CJSON_PUBLIC(void) cJSON_DeleteWithContext(cJSON_Context *context, cJSON *item);
+CJSON_PUBLIC(cJSON *) cJSON_DuplicateWithContext(cJSON_Context *context, const cJSON *item, cJSON_bool recurse);
+CJSON_PUBLIC(cJSON *) cJSON_CreateStringWithContext(cJSON_Context *context, const char *string);
+CJSON_PUBLIC(void) cJSON_AddItemToObjectWithContext(cJSON_Context *context, cJSON *object, const char *string, cJSON *item);
+
+/* Event parsing: instead of building a tree, report what is read to a callback, which keeps its memory bounded. */
+/* Input may be fed in pieces as it arrives, the parser keeps its place between them. */
+#define cJSON_EventObjectStart 1
+#define cJSON_EventObjectEnd 2
+#define cJSON_EventArrayStart 3
+#define cJSON_EventArrayEnd 4
+#define cJSON_EventKey 5
+#define cJSON_EventString 6
+#define cJSON_EventNumber 7
+#define cJSON_EventTrue 8
+#define cJSON_EventFalse 9
+#define cJSON_EventNull 10
+
+/* what a callback returns */
+#define cJSON_EventContinue 0
+#define cJSON_EventPause 1 /* return from cJSON_FeedEventParser now, feeding the rest resumes */
+#define cJSON_EventStop 2
+
+/* cJSON_EventParserStatus */
+#define cJSON_EventParserReading 0 /* wants more input */
+#define cJSON_EventParserPaused 1
+#define cJSON_EventParserStopped 2
+#define cJSON_EventParserDone 3 /* a whole value was read */
+#define cJSON_EventParserFailed 4
+
+/* Longest key, string or number an event parser takes by default. */
+#ifndef CJSON_EVENT_TOKEN_SIZE
+#define CJSON_EVENT_TOKEN_SIZE 4096
+#endif
+
+typedef struct cJSON_Event
+{
+    int type;
+    /* containers around the event, the start and end of a container count as outside of it */
+    size_t depth;
+    /* decoded and terminated text of keys and strings, only valid during the callback */
+    const char *string;
+    size_t length;
+    double number;
+} cJSON_Event;
+
+typedef int (*cJSON_EventCallback)(const cJSON_Event *event, void *user);
+
+typedef struct cJSON_EventParser cJSON_EventParser;
+/* token_size is the longest key, string or number accepted, 0 picks CJSON_EVENT_TOKEN_SIZE. It is the only allocation. */
+CJSON_PUBLIC(cJSON_EventParser *) cJSON_CreateEventParser(cJSON_EventCallback callback, void *user, size_t token_size);
+/* Returns the bytes consumed, fewer than length if the callback paused or stopped or the input is invalid. */
+CJSON_PUBLIC(size_t) cJSON_FeedEventParser(cJSON_EventParser *parser, const char *data, size_t length);
+/* Call at the end of the input, a number at the top level only ends there. Returns the status. */
+CJSON_PUBLIC(int) cJSON_FinishEventParser(cJSON_EventParser *parser);
+CJSON_PUBLIC(int) cJSON_EventParserStatus(const cJSON_EventParser *parser);
+CJSON_PUBLIC(void) cJSON_DeleteEventParser(cJSON_EventParser *parser);
+/* Feed all of value at once, returns the final status. */
+CJSON_PUBLIC(int) cJSON_ParseEvents(const char *value, size_t length, cJSON_EventCallback callback, void *user);
+
+/* cJSON_ExtractString results */
+#define cJSON_ExtractFound 0
+#define cJSON_ExtractMissing 1 /* valid JSON, but key is not a string member of the top level object */
+#define cJSON_ExtractTooLong 2 /* the string and its terminator don't fit into buffer */
+#define cJSON_ExtractInvalid 3
+
+/* Read the string member key (matched like cJSON_GetObjectItem does) of the top level object in the first length bytes of value into buffer. */
+/* The rest of the document is checked as cJSON_ParseBuffer would without building it, nothing is allocated. status is filled like cJSON_ParseBuffer does. */
+CJSON_PUBLIC(int) cJSON_ExtractString(const char *value, size_t length, const char *key, char *buffer, size_t size, cJSON_ParseStatus *status);
+
+/* Tapes: a read-only document packed into one array of 16 byte entries instead of a tree of cJSON nodes. */
+/* A container entry is followed by its items (an object's each preceded by an entry for its key) and an invalid entry. */
+#define cJSON_TapeKey 4096 /* type of the entry for an object key */
+
+typedef struct cJSON_TapeItem
+{
+    unsigned int type; /* cJSON_False ... cJSON_Object */
+    unsigned int span; /* entries up to the next item, 1 for anything but a container */
+    union
+    {
+        double number;
+        const char *string; /* points into the parsed buffer */
+        size_t size; /* items of an array or object */
+    } value;
+} cJSON_TapeItem;
+
+typedef struct cJSON_Tape cJSON_Tape;
+/* Strings are decoded and terminated in buffer, so it is changed and has to live as long as the tape. status is filled like cJSON_ParseBuffer does. */
+CJSON_PUBLIC(cJSON_Tape *) cJSON_ParseTape(char *buffer, size_t length, cJSON_ParseStatus *status);
+CJSON_PUBLIC(void) cJSON_DeleteTape(cJSON_Tape *tape);
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeRoot(const cJSON_Tape *tape);
+/* Bytes held by the tape, the buffer not included. */
+CJSON_PUBLIC(size_t) cJSON_TapeMemory(const cJSON_Tape *tape);
+/* The first and next item of a container, NULL past the end. */
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeChild(const cJSON_TapeItem *item);
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeNext(const cJSON_TapeItem *item);
+/* The key of an object's item, NULL for anything else. */
+CJSON_PUBLIC(const char *) cJSON_TapeGetKey(const cJSON_TapeItem *item);
+/* Like their cJSON_Get* counterparts. */
+CJSON_PUBLIC(int) cJSON_TapeGetArraySize(const cJSON_TapeItem *array);
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeGetArrayItem(const cJSON_TapeItem *array, int index);
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeGetObjectItem(const cJSON_TapeItem *object, const char *string);
+CJSON_PUBLIC(const cJSON_TapeItem *) cJSON_TapeGetObjectItemCaseSensitive(const cJSON_TapeItem *object, const char *string);
+CJSON_PUBLIC(const char *) cJSON_TapeGetStringValue(const cJSON_TapeItem *item);
+CJSON_PUBLIC(double) cJSON_TapeGetNumberValue(const cJSON_TapeItem *item);
+#define cJSON_TapeArrayForEach(element, array) for(element = cJSON_TapeChild(array); element != NULL; element = cJSON_TapeNext(element))
 
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
 /* Render a cJSON entity to text for transfer/storage without any formatting. */
 CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item);
+/* The exact length of what cJSON_Print (format true) or cJSON_PrintUnformatted returns, without the terminator. 0 if item can't be printed. */
+/* cJSON_PrintPreallocated succeeds with a buffer of one byte more. */
+CJSON_PUBLIC(size_t) cJSON_PrintedLength(const cJSON *item, cJSON_bool format);
 /* Render a cJSON entity to text using a buffered strategy. prebuffer is a guess at the final size. guessing well reduces reallocation. fmt=0 gives unformatted, =1 gives formatted */
 CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt);
 /* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
 /* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
 CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+
+/* Writer: emits unformatted JSON a token at a time without building items, putting in the commas and colons itself. */
+/* cJSON_InitWriter writes into buffer and fails rather than go past size (one byte of which is kept for the terminator), */
+/* with a NULL buffer it allocates and grows its own. A stream writer hands its text to flush each time flush_size bytes piled up. */
+/* The cJSON_Write* calls return 0 for a token that doesn't fit where it is written, the writer then stays failed. */
+#ifndef CJSON_WRITER_NESTING_LIMIT
+#define CJSON_WRITER_NESTING_LIMIT 64
+#endif
+#define CJSON_WRITER_FLUSH_SIZE 4096
+/* returns the bytes it took, anything short of length fails the writer */
+typedef size_t (*cJSON_WriterFlush)(const char *data, size_t length, void *user);
+typedef struct cJSON_Writer
+{
+    unsigned char *buffer;
+    size_t size;
+    size_t length; /* in buffer */
+    size_t flushed; /* already handed to flush */
+    size_t flush_size;
+    size_t depth;
+    unsigned char objects[(CJSON_WRITER_NESTING_LIMIT + 7) / 8]; /* per depth, the container is an object */
+    unsigned char elements[(CJSON_WRITER_NESTING_LIMIT + 7) / 8]; /* per depth, the container has an element */
+    cJSON_bool after_key;
+    cJSON_bool done; /* the top level value is complete */
+    size_t lines; /* values ended with cJSON_WriteLine */
+    cJSON_bool fixed;
+    cJSON_bool failed;
+    cJSON_WriterFlush flush;
+    void *user;
+} cJSON_Writer;
+CJSON_PUBLIC(void) cJSON_InitWriter(cJSON_Writer *writer, char *buffer, size_t size);
+CJSON_PUBLIC(void) cJSON_InitStreamWriter(cJSON_Writer *writer, size_t flush_size, cJSON_WriterFlush flush, void *user);
+/* Start over on a new value, keeping the buffer. */
+CJSON_PUBLIC(void) cJSON_ResetWriter(cJSON_Writer *writer);
+/* Free a buffer the writer allocated. */
+CJSON_PUBLIC(void) cJSON_FreeWriter(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteObjectStart(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteObjectEnd(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteArrayStart(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteArrayEnd(cJSON_Writer *writer);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteKey(cJSON_Writer *writer, const char *key);
+/* A NULL string is written as null. */
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteString(cJSON_Writer *writer, const char *string);
+/* Numbers are written as cJSON_Print writes them, the shortest text that reads back the same. */
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteNumber(cJSON_Writer *writer, double number);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteBool(cJSON_Writer *writer, cJSON_bool boolean);
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteNull(cJSON_Writer *writer);
+/* Write item and everything in it as one value. */
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteItem(cJSON_Writer *writer, const cJSON *item);
+/* Once a complete value was written: the terminated text and its exact length. A stream writer flushes the rest, */
+/* returns an empty text and the length of all it flushed. NULL if the writer failed or the value isn't complete. */
+CJSON_PUBLIC(const char *) cJSON_FinishWriter(cJSON_Writer *writer, size_t *length);
+/* End a complete value with a newline so that another one can follow, as in newline delimited JSON (NDJSON). */
+/* cJSON_FinishWriter also takes a writer whose last value was ended this way. */
+CJSON_PUBLIC(cJSON_bool) cJSON_WriteLine(cJSON_Writer *writer);
+
+/* Line reader: newline delimited JSON (NDJSON), one value per line, handed out one value at a time. */
+/* cJSON_InitLineReader reads the length bytes at data, a mapped file for example, in place. A stream line reader calls fill */
+/* for more whenever it runs out of complete lines and only keeps the line it is on. Values are parsed into an arena of */
+/* the reader's that the next cJSON_ReadLine resets, cJSON_Duplicate a value to keep it. */
+#define CJSON_READER_FILL_SIZE 65536
+/* returns the bytes it put into data, 0 at the end of the input */
+typedef size_t (*cJSON_ReaderFill)(char *data, size_t size, void *user);
+typedef struct cJSON_LineReader
+{
+    const char *data;
+    size_t length;
+    size_t offset; /* where the next line starts */
+    char *buffer; /* of a stream line reader, data points into it */
+    size_t size;
+    size_t fill_size;
+    size_t line; /* of the last value or error, counting from 1 */
+    size_t column; /* of the last error, counting from 1 */
+    cJSON_Arena *arena;
+    cJSON_bool end; /* fill has nothing more */
+    cJSON_ReaderFill fill;
+    void *user;
+} cJSON_LineReader;
+/* cJSON_ReadLine results */
+#define cJSON_LineValue 0
+#define cJSON_LineEnd 1 /* no lines left */
+#define cJSON_LineInvalid 2 /* the line isn't a single JSON value, the next call goes on with the line after it */
+#define cJSON_LineFailed 3 /* out of memory */
+/* Both return 0 if the reader's arena can't be allocated. */
+CJSON_PUBLIC(cJSON_bool) cJSON_InitLineReader(cJSON_LineReader *reader, const char *data, size_t length);
+CJSON_PUBLIC(cJSON_bool) cJSON_InitStreamLineReader(cJSON_LineReader *reader, size_t fill_size, cJSON_ReaderFill fill, void *user);
+/* The value on the next line that isn't blank. It stays valid until the next call. */
+CJSON_PUBLIC(int) cJSON_ReadLine(cJSON_LineReader *reader, cJSON **value);
+CJSON_PUBLIC(void) cJSON_FreeLineReader(cJSON_LineReader *reader);
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *c);
 
@@ -170,6 +455,7 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
 CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string);
+
 /* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
 CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
 
@@ -249,6 +535,13 @@ The item->next and ->prev pointers are always zero on return from Duplicate. */
 /* Recursively compare two cJSON items for equality. If either a or b is NULL or invalid, they will be considered unequal.
  * case_sensitive determines if object keys are treated case sensitive (1) or case insensitive (0) */
 CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive);
+/* Structural hash of item: items that cJSON_Equal finds equal hash the same, whatever the order of their object members. */
+/* The hash fits in 32 bits and is 0 only if item is NULL or memory ran out. */
+CJSON_PUBLIC(unsigned long) cJSON_Hash(const cJSON *item);
+/* cJSON_Compare(a, b, true) without a key lookup per member: object members are matched up by sorting them by key, */
+/* unless both objects have their keys in the same order. */
+/* Members with the same key in one object are matched in the order they appear. */
+CJSON_PUBLIC(cJSON_bool) cJSON_Equal(const cJSON * const a, const cJSON * const b);
 
 
 CJSON_PUBLIC(void) cJSON_Minify(char *json);
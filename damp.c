@@ -0,0 +1,300 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "damp.h"
+
+static cJSON *
+read_state(const char * path, int * missing)
+{
+	FILE * fp;
+	long length;
+	char * contents;
+	cJSON * root;
+
+	*missing = 0;
+
+	fp = fopen(path, "r");
+	if (fp == NULL) {
+		*missing = errno == ENOENT;
+		return NULL;
+	}
+
+	root = NULL;
+	contents = NULL;
+
+	if (fseek(fp, 0, SEEK_END) != 0 || (length = ftell(fp)) < 0 ||
+		fseek(fp, 0, SEEK_SET) != 0) {
+		goto done;
+	}
+
+	contents = malloc((size_t)length + 1);
+	if (contents == NULL) {
+		goto done;
+	}
+
+	if (fread(contents, 1, (size_t)length, fp) != (size_t)length) {
+		goto done;
+	}
+	contents[length] = 0;
+
+	root = cJSON_Parse(contents);
+
+done:
+	free(contents);
+	fclose(fp);
+
+	return root;
+}
+
+static void
+roll_window(damp_record * rec, const damp_options * options, time_t now)
+{
+	unsigned int window;
+
+	window = options->window ? options->window : DAMP_WINDOW_DEFAULT;
+
+	if (rec->window_start == 0 || now - rec->window_start >= (time_t)window) {
+		rec->window_start = now;
+		rec->writes = 0;
+	}
+}
+
+/* Returns DAMP_CAPPED if the current window has no room for another write. */
+static int
+damp_cap(damp_record * rec, const damp_options * options, time_t now)
+{
+	if (options->max_writes != 0) {
+		roll_window(rec, options, now);
+		if (rec->writes >= options->max_writes) {
+			rec->suppressed += 1;
+			return DAMP_CAPPED;
+		}
+	}
+
+	return DAMP_ALLOW;
+}
+
+/*
+ * Load the state file at path into table. A missing file is not an error,
+ * the table simply starts empty. Returns -1 if the file exists but cannot be
+ * parsed, the table is then empty as well.
+ */
+int
+damp_open(damp_table * table, const char * path)
+{
+	int missing;
+	int ret;
+
+	table->changed = 0;
+	table->root = read_state(path, &missing);
+	if (cJSON_IsObject(table->root)) {
+		return 0;
+	}
+
+	ret = table->root == NULL && missing ? 0 : -1;
+	cJSON_Delete(table->root);
+	table->root = cJSON_CreateObject();
+
+	return table->root != NULL ? ret : -1;
+}
+
+/* Fill rec with the state for key, zeroed if there is none. */
+void
+damp_get(const damp_table * table, const char * key, damp_record * rec)
+{
+	cJSON * entry, * item;
+
+	memset(rec, 0, sizeof(damp_record));
+
+	entry = cJSON_GetObjectItemCaseSensitive(table->root, key);
+
+	item = cJSON_GetObjectItemCaseSensitive(entry, "candidate");
+	if (cJSON_IsString(item)) {
+		snprintf(rec->candidate, sizeof rec->candidate, "%s",
+			item->valuestring);
+	}
+
+	item = cJSON_GetObjectItemCaseSensitive(entry, "since");
+	rec->since = cJSON_IsNumber(item) ? (time_t)item->valuedouble : 0;
+
+	item = cJSON_GetObjectItemCaseSensitive(entry, "observations");
+	rec->observations = cJSON_IsNumber(item) ?
+		(unsigned int)item->valuedouble : 0;
+
+	item = cJSON_GetObjectItemCaseSensitive(entry, "window_start");
+	rec->window_start = cJSON_IsNumber(item) ?
+		(time_t)item->valuedouble : 0;
+
+	item = cJSON_GetObjectItemCaseSensitive(entry, "writes");
+	rec->writes = cJSON_IsNumber(item) ? (unsigned int)item->valuedouble : 0;
+
+	item = cJSON_GetObjectItemCaseSensitive(entry, "suppressed");
+	rec->suppressed = cJSON_IsNumber(item) ?
+		(unsigned long)item->valuedouble : 0;
+}
+
+/*
+ * Store rec under key in table, it reaches the file with damp_close(). A
+ * record equal to the one already there leaves the table unchanged, so a run
+ * that changes nothing doesn't rewrite the file.
+ */
+int
+damp_put(damp_table * table, const char * key, const damp_record * rec)
+{
+	cJSON * entry, * current;
+
+	if (table->root == NULL) {
+		return -1;
+	}
+
+	entry = cJSON_CreateObject();
+	if (entry == NULL) {
+		return -1;
+	}
+
+	if (cJSON_AddStringToObject(entry, "candidate", rec->candidate) == NULL ||
+		cJSON_AddNumberToObject(entry, "since", (double)rec->since) == NULL ||
+		cJSON_AddNumberToObject(entry, "observations",
+		rec->observations) == NULL ||
+		cJSON_AddNumberToObject(entry, "window_start",
+		(double)rec->window_start) == NULL ||
+		cJSON_AddNumberToObject(entry, "writes", rec->writes) == NULL ||
+		cJSON_AddNumberToObject(entry, "suppressed",
+		(double)rec->suppressed) == NULL) {
+		cJSON_Delete(entry);
+		return -1;
+	}
+
+	current = cJSON_GetObjectItemCaseSensitive(table->root, key);
+	if (cJSON_Equal(current, entry)) {
+		cJSON_Delete(entry);
+		return 0;
+	}
+
+	if (current != NULL) {
+		cJSON_ReplaceItemViaPointer(table->root, current, entry);
+	} else {
+		cJSON_AddItemToObject(table->root, key, entry);
+	}
+	table->changed = 1;
+
+	return 0;
+}
+
+/*
+ * Write table to the state file at path if anything was put into it, and
+ * free it. A NULL path only frees it. The file is replaced with rename(2) so
+ * a concurrent reader never sees a partial write.
+ */
+int
+damp_close(damp_table * table, const char * path)
+{
+	char * data;
+	char tmp_path[1024];
+	FILE * fp;
+	int ret;
+
+	ret = -1;
+	data = NULL;
+
+	if (path == NULL || !table->changed) {
+		ret = 0;
+		goto done;
+	}
+
+	if (table->root == NULL) {
+		goto done;
+	}
+
+	data = cJSON_Print(table->root);
+	if (data == NULL) {
+		goto done;
+	}
+
+	if ((size_t)snprintf(tmp_path, sizeof tmp_path, "%s.tmp", path) >=
+		sizeof tmp_path) {
+		goto done;
+	}
+
+	fp = fopen(tmp_path, "w");
+	if (fp == NULL) {
+		goto done;
+	}
+
+	if (fputs(data, fp) == EOF || fputc('\n', fp) == EOF) {
+		fclose(fp);
+		remove(tmp_path);
+		goto done;
+	}
+
+	if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+		remove(tmp_path);
+		goto done;
+	}
+
+	ret = 0;
+
+done:
+	cJSON_free(data);
+	cJSON_Delete(table->root);
+	table->root = NULL;
+	table->changed = 0;
+
+	return ret;
+}
+
+/*
+ * Account for one observation of ipv4 and decide whether it may be written.
+ * A new address becomes the candidate; it is allowed once it has been seen
+ * options->observations times in a row or has held for options->hold
+ * seconds, and only while the write cap for the current window has room.
+ */
+int
+damp_check(damp_record * rec, const damp_options * options,
+	const char * ipv4, time_t now)
+{
+	int held;
+
+	if (strcmp(rec->candidate, ipv4) != 0) {
+		snprintf(rec->candidate, sizeof rec->candidate, "%s", ipv4);
+		rec->since = now;
+		rec->observations = 0;
+	}
+	rec->observations += 1;
+
+	if (options->observations == 0 && options->hold == 0) {
+		held = 1;
+	} else {
+		held = (options->observations != 0 &&
+			rec->observations >= options->observations) ||
+			(options->hold != 0 &&
+			now - rec->since >= (time_t)options->hold);
+	}
+
+	if (!held) {
+		rec->suppressed += 1;
+		return DAMP_HOLD;
+	}
+
+	return damp_cap(rec, options, now);
+}
+
+/* The record already holds the current address, forget any candidate. */
+void
+damp_settled(damp_record * rec)
+{
+	rec->candidate[0] = 0;
+	rec->since = 0;
+	rec->observations = 0;
+}
+
+void
+damp_wrote(damp_record * rec, const damp_options * options, time_t now)
+{
+	roll_window(rec, options, now);
+	rec->writes += 1;
+	damp_settled(rec);
+}
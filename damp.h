@@ -0,0 +1,57 @@
+#ifndef _DAMP_H_
+#define _DAMP_H_
+
+#include <time.h>
+
+#include "cJSON.h"
+
+#define DAMP_ALLOW 0
+#define DAMP_HOLD 1
+#define DAMP_CAPPED 2
+
+#define DAMP_WINDOW_DEFAULT 3600
+
+typedef struct {
+	unsigned int observations;	/* sightings required before a write */
+	unsigned int hold;		/* seconds a change must hold */
+	unsigned int max_writes;	/* writes allowed per window, 0 = no cap */
+	unsigned int window;		/* length of the write window in seconds */
+} damp_options;
+
+typedef struct {
+	char candidate[16];
+	time_t since;
+	unsigned int observations;
+	time_t window_start;
+	unsigned int writes;
+	unsigned long suppressed;
+} damp_record;
+
+/* the damping state of every record in a state file, read once per run */
+typedef struct {
+	cJSON * root;		/* records by key */
+	int changed;		/* root has to be written back */
+} damp_table;
+
+int
+damp_open(damp_table *, const char *);
+
+void
+damp_get(const damp_table *, const char *, damp_record *);
+
+int
+damp_put(damp_table *, const char *, const damp_record *);
+
+int
+damp_close(damp_table *, const char *);
+
+int
+damp_check(damp_record *, const damp_options *, const char *, time_t);
+
+void
+damp_settled(damp_record *);
+
+void
+damp_wrote(damp_record *, const damp_options *, time_t);
+
+#endif /* !_DAMP_H_ */
@@ -1,6 +1,13 @@
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <getopt.h>
 
@@ -10,14 +17,21 @@
 #endif
 
 #include "cJSON.h"
+#include "damp.h"
+#include "dns.h"
 #include "req.h"
+#include "rrset.h"
+#include "rrtab.h"
 
 #define CREATE 0
 #define UPDATE 1
 #define ACCURATE 2
+#define DAMPED 3
+#define FAILED 4	/* LiveDNS turned the change down or couldn't be asked */
 
 #define LIVEDNS_MAX_TTL 2592000
 #define LIVEDNS_MIN_TTL 300
+#define LIVEDNS_API_URL "https://dns.api.gandi.net/api/v5"
 #define TTL_CHAR_BUFSIZE 8
 
 #define EMERG 0
@@ -32,6 +46,34 @@
 #define IPV4_LOOKUP_URL_DEFAULT "https://ifconfig.co/json"
 #define IPV4_LOOKUP_PROPERTY_DEFAULT "ip"
 
+#define RESULTS_FLUSH_SIZE 65536
+
+/* One A record to keep at the current address. */
+typedef struct {
+	const char * domain;
+	const char * subdomain;
+	int ttl;
+	size_t line;		/* in the -B file, 0 for -s and -d */
+} target;
+
+/* What every target of a run is updated with. */
+typedef struct {
+	req_options * options;
+	const char * api_url;		/* where LiveDNS is reached */
+	const char * ipv4;
+	unsigned short dry_run;
+	unsigned short forced;		/* the address was given with -f */
+	unsigned short verify_dns;
+	const char * dns_server;
+	const char * damp_path;
+	damp_options damping;
+	damp_table damp;		/* the state file, written back at exit */
+	rrtab zone;
+	char * zone_domain;		/* whose listing zone holds, or NULL */
+	cJSON_Writer * results;		/* NDJSON results instead of messages */
+	unsigned int errors;		/* targets that hit an error */
+} run_state;
+
 static void usage(void);
 
 static void
@@ -40,6 +82,48 @@ fail_hard_if_null(void *, const char *, const char *, unsigned int);
 static void
 logmsg(int, const char *, const char *, const char *, unsigned int);
 
+static unsigned int
+parse_count(const char *, const char *);
+
+static double
+parse_rate(const char *, const char *);
+
+static int
+clamp_ttl(int);
+
+static void
+save_damp_state(run_state *, const char *, const damp_record *);
+
+static void
+zone_written(run_state *, const target *);
+
+static void
+say(const run_state *, const char *, ...);
+
+static size_t
+write_results(const char *, size_t, void *);
+
+static int
+update_target(run_state *, const target *, long *);
+
+static void
+update_targets(run_state *, const char *, const target *);
+
+static int
+read_target(const cJSON *, const target *, target *);
+
+static void
+write_result(run_state *, const target *, size_t, int, long);
+
+static int
+livedns_zone(const char *, req_options *, rrtab *);
+
+static unsigned short
+record_state(const rrtab *, const char *, const char *);
+
+static const char *
+rrset_body(char *, size_t, const char *, const char *, int, size_t *);
+
 static int verbosity;
 
 int
@@ -51,43 +135,84 @@ main(int argc, char * argv[])
 	size_t optarg_length;
 
 	req_options * options;
+	req_options lookup_options;
+	cJSON_Arena * arena;
 	const char * headers[2];
-	const char * new_ip_array[1];
-	char url[2048]; /* XXX use malloc */
 	char api_key_header[256];
 	char current_ipv4[16];
 
 	char * api_key;
+	const char * api_url;
 	char * domain;
 	char * subdomain;
 	char * ipv4_lookup_url;
 	char * ipv4_lookup_property;
 
-	cJSON * root, * item, * type, * name, * values, * ip, * new_obj, * new_array;
-
 	int ttl = LIVEDNS_MIN_TTL;
 	char ttl_buffer[TTL_CHAR_BUFSIZE + 1];
 	unsigned short dry_run;
 	unsigned short skip_GET;
-	unsigned short update_mode;
 	long last_status;
 	char last_status_buffer[4];
+	int lookup;
+
+	char * damp_path;
+	damp_options damping;
+
+	ratelimit livedns_limit;
+	double rate;
+	double burst;
+
+	unsigned short verify_dns;
+	char * dns_server;
+
+	char * targets_path;
+	char * results_path;
+	FILE * results_file;
+	cJSON_Writer results;
+	run_state run;
+	target single;
+	int result;
 
 	domain = NULL;
 	subdomain = NULL;
 	ipv4_lookup_url = NULL;
 	ipv4_lookup_property = NULL;
-	update_mode = CREATE;
 	dry_run = 0;
 
 	verbosity = ERR;
 	skip_GET = 0;
 
+	memset(&lookup_options, 0, sizeof lookup_options);
+
+	damp_path = NULL;
+	memset(&damping, 0, sizeof damping);
+
+	rate = 0;
+	burst = 1;
+
+	verify_dns = 0;
+	dns_server = NULL;
+
+	targets_path = NULL;
+	results_path = NULL;
+	results_file = NULL;
+
 	setprogname(argv[0]);
 
-	while ((opt_char = getopt(argc, argv, "d:i:f:p:s:t:v:x")) != -1) {
+	while ((opt_char = getopt(argc, argv, "ab:d:i:f:n:o:p:r:s:t:v:w:xA:B:S:T:W:")) != -1) {
 		switch (opt_char) {
 
+			/* verify against the zone's authoritative nameservers */
+			case 'a':
+				verify_dns = 1;
+				break;
+
+			/* burst of LiveDNS requests allowed by the rate limiter */
+			case 'b':
+				burst = parse_rate(optarg, "-b");
+				break;
+
 			/* domain */
 			case 'd':
 				optarg_length = strlen(optarg);
@@ -112,6 +237,19 @@ main(int argc, char * argv[])
 				skip_GET = 1;
 				break;
 
+			/* observations required before a change is written */
+			case 'n':
+				damping.observations = parse_count(optarg, "-n");
+				break;
+
+			/* NDJSON results file */
+			case 'o':
+				optarg_length = strlen(optarg);
+				results_path = malloc(optarg_length + 1);
+				fail_hard_if_null(results_path, NULL, __FILE__, __LINE__);
+				strlcpy(results_path, optarg, optarg_length + 1);
+				break;
+
 			/* JSON property containing ipv4 address */
 			case 'p':
 				optarg_length = strlen(optarg);
@@ -122,6 +260,11 @@ main(int argc, char * argv[])
 					optarg_length + 1);
 				break;
 
+			/* LiveDNS requests per second */
+			case 'r':
+				rate = parse_rate(optarg, "-r");
+				break;
+
 			/* subdomain */
 			case 's':
 				optarg_length = strlen(optarg);
@@ -147,11 +290,51 @@ main(int argc, char * argv[])
 				}
 				break;
 
+			/* maximum writes per damping window */
+			case 'w':
+				damping.max_writes = parse_count(optarg, "-w");
+				break;
+
 			/* dry run */
 			case 'x':
 				dry_run = 1;
 				break;
 
+			/* verify against this authoritative nameserver */
+			case 'A':
+				optarg_length = strlen(optarg);
+				dns_server = malloc(optarg_length + 1);
+				fail_hard_if_null(dns_server, NULL, __FILE__, __LINE__);
+				strlcpy(dns_server, optarg, optarg_length + 1);
+				verify_dns = 1;
+				break;
+
+			/* NDJSON file of targets */
+			case 'B':
+				optarg_length = strlen(optarg);
+				targets_path = malloc(optarg_length + 1);
+				fail_hard_if_null(targets_path, NULL, __FILE__, __LINE__);
+				strlcpy(targets_path, optarg, optarg_length + 1);
+				break;
+
+			/* damping state file */
+			case 'S':
+				optarg_length = strlen(optarg);
+				damp_path = malloc(optarg_length + 1);
+				fail_hard_if_null(damp_path, NULL, __FILE__, __LINE__);
+				strlcpy(damp_path, optarg, optarg_length + 1);
+				break;
+
+			/* seconds a change must hold before it is written */
+			case 'T':
+				damping.hold = parse_count(optarg, "-T");
+				break;
+
+			/* length of the damping window in seconds */
+			case 'W':
+				damping.window = parse_count(optarg, "-W");
+				break;
+
 			case '?':
 			case 'h':
 			default:
@@ -171,9 +354,15 @@ main(int argc, char * argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	api_url = getenv("GANDI_DNS_API_URL");
+	if (api_url == NULL) {
+		api_url = LIVEDNS_API_URL;
+	}
+
+	/* with -B the domain is only the default of targets that don't name one */
 	if (domain == NULL) {
 		domain = getenv("GANDI_DNS_DOMAIN");
-		if (domain == NULL || strlen(domain) < 3) {
+		if ((domain == NULL || strlen(domain) < 3) && targets_path == NULL) {
 			logmsg(EMERG, "FATAL: ", "Unable to find a value for 'domain' in "
 				"either the -d argument or the 'GANDI_DNS_DOMAIN' environment "
 				"variable." , __FILE__, __LINE__);
@@ -183,7 +372,7 @@ main(int argc, char * argv[])
 
 	logmsg(INFO, "domain=", domain, __FILE__, __LINE__);
 
-	if (subdomain == NULL) {
+	if (subdomain == NULL && targets_path == NULL) {
 		subdomain = getenv("GANDI_DNS_SUBDOMAIN");
 		if (subdomain == NULL || strlen(subdomain) < 1) {
 			logmsg(EMERG, "FATAL: ", "Unable to find a value for 'subdomain' "
@@ -193,7 +382,11 @@ main(int argc, char * argv[])
 		}
 	}
 
-	logmsg(INFO, "subdomain=", subdomain, __FILE__, __LINE__);
+	if (targets_path != NULL) {
+		logmsg(INFO, "targets_path=", targets_path, __FILE__, __LINE__);
+	} else {
+		logmsg(INFO, "subdomain=", subdomain, __FILE__, __LINE__);
+	}
 
 	if (ipv4_lookup_url == NULL) {
 		ipv4_lookup_url = IPV4_LOOKUP_URL_DEFAULT;
@@ -208,250 +401,756 @@ main(int argc, char * argv[])
 	logmsg(INFO, "ipv4_lookup_property=", ipv4_lookup_property,
 		__FILE__, __LINE__);
 
+	ttl = clamp_ttl(ttl);
 	snprintf(ttl_buffer, TTL_CHAR_BUFSIZE, "%d", ttl);
+	logmsg(INFO, "ttl=", ttl_buffer, __FILE__, __LINE__);
 
-	if (ttl > LIVEDNS_MAX_TTL) {
-		ttl = LIVEDNS_MAX_TTL;
-		snprintf(ttl_buffer, TTL_CHAR_BUFSIZE, "%d", ttl);
-		logmsg(ERR, "Desired ttl exceeded LIVEDNS_MAX_TTL, capped to ",
-			ttl_buffer, __FILE__, __LINE__);
+	if (damp_path == NULL && (damping.observations || damping.hold ||
+		damping.max_writes || damping.window)) {
+		logmsg(EMERG, "FATAL: ", "Damping options -n, -T, -w and -W require "
+			"a state file set with -S.", __FILE__, __LINE__);
+		exit(EXIT_FAILURE);
 	}
 
-	if (ttl < LIVEDNS_MIN_TTL) {
-		ttl = LIVEDNS_MIN_TTL;
-		snprintf(ttl_buffer, TTL_CHAR_BUFSIZE, "%d", ttl);
-		logmsg(ERR, "Desired ttl lower than LIVEDNS_MIN_TTL, increased to ",
-			ttl_buffer, __FILE__, __LINE__);
+	if (damp_path != NULL) {
+		logmsg(INFO, "damp_path=", damp_path, __FILE__, __LINE__);
 	}
 
-	snprintf(ttl_buffer, TTL_CHAR_BUFSIZE, "%d", ttl);
-	logmsg(INFO, "ttl=", ttl_buffer, __FILE__, __LINE__);
+	if (results_path != NULL) {
+		logmsg(INFO, "results_path=", results_path, __FILE__, __LINE__);
+		if (strcmp(results_path, "-") == 0) {
+			results_file = stdout;
+		} else {
+			results_file = fopen(results_path, "w");
+		}
+		if (results_file == NULL) {
+			logmsg(EMERG, "FATAL: unable to open results file ",
+				results_path, __FILE__, __LINE__);
+			exit(EXIT_FAILURE);
+		}
+		cJSON_InitStreamWriter(&results, RESULTS_FLUSH_SIZE, write_results,
+			results_file);
+	}
 
-	if (!skip_GET) {
-		root = req_get(ipv4_lookup_url, NULL, &last_status);
+	/* the responses of a target are parsed into one arena, reset for the next */
+	arena = cJSON_CreateArena(0);
+	fail_hard_if_null(arena, NULL, __FILE__, __LINE__);
 
-		fail_hard_if_null(root, "failed to fetch IPv4 address, no parsable JSON"
-			" response returned", __FILE__, __LINE__);
+	if (!skip_GET) {
+		/* only the one property is read, the response is never built */
+		lookup = req_get_string(ipv4_lookup_url, &lookup_options,
+			&last_status, ipv4_lookup_property, current_ipv4,
+			sizeof current_ipv4);
+
+		if (lookup == cJSON_ExtractInvalid) {
+			logmsg(EMERG, "failed to fetch IPv4 address, no parsable JSON"
+				" response returned", NULL, __FILE__, __LINE__);
+			exit(EXIT_FAILURE);
+		}
 
 		snprintf(last_status_buffer, 4, "%ld", last_status);
 
 		logmsg(DEBUG, "HTTP status from ipv4_lookup_url=", last_status_buffer,
 			__FILE__, __LINE__);
 
-		logmsg(DEBUG, "response from ipv4_lookup_url=",
-			cJSON_PrintUnformatted(root), __FILE__, __LINE__);
-
 		if (last_status >= 400) {
 			logmsg(EMERG, "received error response from ipv4_lookup_url=",
 				last_status_buffer, __FILE__, __LINE__);
 			exit(EXIT_FAILURE);
 		}
 
-		if (cJSON_HasObjectItem(root, ipv4_lookup_property)) {
-			ip = cJSON_GetObjectItem(root, ipv4_lookup_property);
-			snprintf(current_ipv4, sizeof current_ipv4, "%s",
-				cJSON_GetStringValue(ip));
-			cJSON_free(ip);
-			logmsg(NOTICE, "current_ipv4=", current_ipv4, __FILE__, __LINE__);
+		if (lookup == cJSON_ExtractTooLong) {
+			logmsg(EMERG, "value too long for an IPv4 address in "
+				"ipv4_lookup_property=", ipv4_lookup_property, __FILE__,
+				__LINE__);
+			exit(EXIT_FAILURE);
 		}
-		cJSON_free(root);
-	}
 
-	/* XXX Use malloc here */
-	snprintf(url, sizeof url,
-		"https://dns.api.gandi.net/api/v5/domains/%s/records",
-		domain);
+		if (lookup == cJSON_ExtractMissing) {
+			logmsg(CRIT, "no string value for ipv4_lookup_property=",
+				ipv4_lookup_property, __FILE__, __LINE__);
+			exit(EXIT_FAILURE);
+		}
 
-	logmsg(DEBUG, "url=", url, __FILE__, __LINE__);
+		logmsg(NOTICE, "current_ipv4=", current_ipv4, __FILE__, __LINE__);
+	}
 
 	/* XXX Use malloc here */
 	snprintf(api_key_header, sizeof api_key_header,
 		"X-Api-Key: %s", api_key);
 
-	options = malloc(sizeof(req_options));
+	options = calloc(1, sizeof(req_options));
+	fail_hard_if_null(options, NULL, __FILE__, __LINE__);
 	headers[0] = api_key_header;
 	headers[1] = NULL;
 	options->headers = headers;
 
-	root = req_get(url, options, &last_status);
+	ratelimit_init(&livedns_limit, rate, burst);
+	options->ratelimit = &livedns_limit;
+	options->arena = arena;
+
+	memset(&run, 0, sizeof run);
+	run.options = options;
+	run.api_url = api_url;
+	run.ipv4 = current_ipv4;
+	run.dry_run = dry_run;
+	run.forced = skip_GET;
+	run.verify_dns = verify_dns;
+	run.dns_server = dns_server;
+	run.damp_path = damp_path;
+	run.damping = damping;
+	if (damp_path != NULL && damp_open(&run.damp, damp_path) != 0) {
+		logmsg(ERR, "unable to read damping state, starting fresh from ",
+			damp_path, __FILE__, __LINE__);
+	}
+	run.results = results_file != NULL ? &results : NULL;
+
+	single.domain = domain;
+	single.subdomain = subdomain;
+	single.ttl = ttl;
+	single.line = 0;
+
+	if (targets_path != NULL) {
+		update_targets(&run, targets_path, &single);
+	} else {
+		result = update_target(&run, &single, &last_status);
+		write_result(&run, &single, 0, result, last_status);
+	}
 
-	fail_hard_if_null(root, "failed to fetch DNS records, no parsable JSON "
-		"response returned from LiveDNS", __FILE__, __LINE__);
+	if (run.zone_domain != NULL) {
+		rrtab_free(&run.zone);
+		free(run.zone_domain);
+	}
 
-	snprintf(last_status_buffer, 4, "%ld", last_status);
+	/* every target's damping state goes back to the file in one write */
+	if (damp_path != NULL &&
+		damp_close(&run.damp, dry_run ? NULL : damp_path) != 0) {
+		logmsg(ERR, "unable to save damping state to ", damp_path,
+			__FILE__, __LINE__);
+	}
 
-	logmsg(DEBUG, "HTTP status from LiveDNS GET=",
-		last_status_buffer, __FILE__, __LINE__);
+	if (results_file != NULL) {
+		/* a run without any target has no value to finish */
+		if ((results.lines > 0 && cJSON_FinishWriter(&results, NULL) == NULL) ||
+			fflush(results_file) != 0) {
+			logmsg(ERR, "unable to write results to ", results_path,
+				__FILE__, __LINE__);
+			run.errors++;
+		}
+		cJSON_FreeWriter(&results);
+		if (results_file != stdout) {
+			fclose(results_file);
+		}
+	}
 
-	logmsg(DEBUG, "response from LiveDNS GET=",
-		cJSON_PrintUnformatted(root), __FILE__, __LINE__);
+	cJSON_DeleteArena(arena);
 
-	if (last_status >= 400) {
-		logmsg(EMERG, "received an error response from LiveDNS GET=",
-			last_status_buffer, __FILE__, __LINE__);
+	return run.errors > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Bring the A record of t in line with the run's address. Returns what was
+ * (or with -x would be) done, the HTTP status of the change in status.
+ */
+static int
+update_target(run_state * run, const target * t, long * status)
+{
+	char url[2048]; /* XXX use malloc */
+	char fqdn[512];
+	char body_buffer[2048];
+	const char * body;
+	size_t body_len;
+	char * printed;
+	cJSON * root;
+	unsigned short update_mode;
+	char last_status_buffer[4];
+	char damp_key[512];
+	char damp_buffer[32];
+	damp_record damp_state;
+	int damping;
+	time_t now;
 
-		item = cJSON_GetObjectItem(root, "message");
+	*status = 0;
+	update_mode = CREATE;
+	memset(&damp_state, 0, sizeof damp_state);
+	now = 0;
 
-		fail_hard_if_null(item, "No error message provided",
-			__FILE__, __LINE__);
+	cJSON_ResetArena(run->options->arena);
 
-		logmsg(EMERG, "error=", cJSON_GetStringValue(item),
-			__FILE__, __LINE__);
+	if (run->damp_path != NULL) {
+		snprintf(damp_key, sizeof damp_key, "%s.%s", t->subdomain, t->domain);
+		damp_get(&run->damp, damp_key, &damp_state);
+	}
 
-		exit(EXIT_FAILURE);
+	if (run->verify_dns) {
+		if (strcmp(t->subdomain, "@") == 0) {
+			snprintf(fqdn, sizeof fqdn, "%s", t->domain);
+		} else {
+			snprintf(fqdn, sizeof fqdn, "%s.%s", t->subdomain, t->domain);
+		}
+
+		switch (dns_verify_a(t->domain, fqdn, run->dns_server, run->ipv4)) {
+			case DNS_MATCH:
+				logmsg(INFO, "authoritative DNS already has the current "
+					"ipv4 address for ", fqdn, __FILE__, __LINE__);
+				update_mode = ACCURATE;
+				break;
+			case DNS_MISMATCH:
+				logmsg(INFO, "authoritative DNS differs, checking LiveDNS for ",
+					fqdn, __FILE__, __LINE__);
+				break;
+			default:
+				logmsg(WARN, "authoritative DNS inconclusive, checking "
+					"LiveDNS for ", fqdn, __FILE__, __LINE__);
+		}
 	}
 
-	cJSON_ArrayForEach(item, root) {
-		type = cJSON_GetObjectItem(item, "rrset_type");
-		name = cJSON_GetObjectItem(item, "rrset_name");
-		values = cJSON_GetObjectItem(item, "rrset_values");
+	/* XXX Use malloc here */
+	snprintf(url, sizeof url, "%s/domains/%s/records", run->api_url,
+		t->domain);
 
-		if (strcmp(cJSON_GetStringValue(type), "A") == 0 &&
-			strcmp(cJSON_GetStringValue(name), subdomain) == 0) {
+	logmsg(DEBUG, "url=", url, __FILE__, __LINE__);
 
-			logmsg(DEBUG, "found matching record: ",
-				cJSON_PrintUnformatted(item), __FILE__, __LINE__);
+	if (update_mode != ACCURATE) {
+		/* consecutive targets in one domain share its listing */
+		if (run->zone_domain == NULL ||
+			strcmp(run->zone_domain, t->domain) != 0) {
+			if (run->zone_domain != NULL) {
+				rrtab_free(&run->zone);
+				free(run->zone_domain);
+				run->zone_domain = NULL;
+			}
+			if (livedns_zone(url, run->options, &run->zone) != 0) {
+				run->errors++;
+				return FAILED;
+			}
+			run->zone_domain = strdup(t->domain);
+			fail_hard_if_null(run->zone_domain, NULL, __FILE__, __LINE__);
+		}
+		update_mode = record_state(&run->zone, t->subdomain, run->ipv4);
+	}
 
-			update_mode = UPDATE;
+	if (run->damp_path != NULL) {
+		now = time(NULL);
 
-			cJSON_ArrayForEach(ip, values) {
-				if (strcmp(ip->valuestring, current_ipv4) == 0) {
-					update_mode = ACCURATE;
-				} else {
-					logmsg(INFO, "record doesn't have accurate ipv4"
-						" address in A record. Stale value=",
-						ip->valuestring, __FILE__, __LINE__);
-				}
+		if (update_mode == ACCURATE) {
+			damp_settled(&damp_state);
+			damping = DAMP_ALLOW;
+		} else if (run->forced) {
+			/* the write still goes into the window once it is made */
+			logmsg(INFO, "IPv4 address forced with -f, bypassing damping",
+				NULL, __FILE__, __LINE__);
+			damping = DAMP_ALLOW;
+		} else {
+			damping = damp_check(&damp_state, &run->damping, run->ipv4, now);
+		}
+
+		if (damping != DAMP_ALLOW) {
+			snprintf(damp_buffer, sizeof damp_buffer, "%lu",
+				damp_state.suppressed);
+			logmsg(NOTICE, "change suppressed by damping, total suppressed=",
+				damp_buffer, __FILE__, __LINE__);
+			say(run, "The 'A' record for '%s' was not changed to '%s' as the "
+				"change is being damped.\n", t->subdomain, run->ipv4);
+			if (!run->dry_run) {
+				save_damp_state(run, damp_key, &damp_state);
 			}
+			return DAMPED;
+		}
+
+		if (update_mode == ACCURATE && !run->dry_run) {
+			save_damp_state(run, damp_key, &damp_state);
 		}
-		cJSON_free(type);
-		cJSON_free(name);
-		cJSON_free(values);
 	}
-	cJSON_free(root);
 
 	switch (update_mode) {
 		case ACCURATE:
 			logmsg(INFO, "Record is in the desired state, nothing to do",
 				NULL, __FILE__, __LINE__);
-			printf("The 'A' record for '%s' is already set to the current "
+			say(run, "The 'A' record for '%s' is already set to the current "
 				"public IPv4 address of '%s'.\nNothing to do.\n",
-				subdomain, current_ipv4);
+				t->subdomain, run->ipv4);
 		break;
 
 		case UPDATE:
 			logmsg(INFO, "'A' record needs to be updated=",
-				subdomain, __FILE__, __LINE__);
-			if (dry_run) {
+				t->subdomain, __FILE__, __LINE__);
+			if (run->dry_run) {
 				logmsg(INFO, "Not proceeding with operation as dry_run was set "
 					"with -x", NULL, __FILE__, __LINE__);
-				printf("The 'A' record for '%s' will be updated with an IPv4 "
+				say(run, "The 'A' record for '%s' will be updated with an IPv4 "
 					"address of '%s'.\nNot proceeding with operation as the "
-					"dry_run option was set with -x.\n", subdomain,
-					current_ipv4);
-				exit(EXIT_SUCCESS);
+					"dry_run option was set with -x.\n", t->subdomain,
+					run->ipv4);
+				break;
 			}
 
-			new_ip_array[0] = current_ipv4;
-			new_obj = cJSON_CreateObject();
-			new_array = cJSON_CreateStringArray(new_ip_array, 1);
-
-			cJSON_AddItemToObject(new_obj, "rrset_values", new_array);
-			cJSON_AddNumberToObject(new_obj, "rrset_ttl", ttl);
+			body = rrset_body(body_buffer, sizeof body_buffer,
+				NULL, run->ipv4, t->ttl, &body_len);
+			if (body == NULL) {
+				logmsg(EMERG, "record too large for the request body", NULL,
+					__FILE__, __LINE__);
+				run->errors++;
+				return FAILED;
+			}
 
-			snprintf(url, sizeof url,
-				"https://dns.api.gandi.net/api/v5/domains/%s/records/%s/A",
-				domain, subdomain);
+			snprintf(url, sizeof url, "%s/domains/%s/records/%s/A",
+				run->api_url, t->domain, t->subdomain);
 
-			root = req_put(url, new_obj, options, &last_status);
+			root = req_put_data(url, body, body_len, run->options, status);
 
-			fail_hard_if_null(root, "failed to update DNS record, no parsable "
-				" JSON response returned from LiveDNS", __FILE__, __LINE__);
+			if (root == NULL) {
+				logmsg(EMERG, "failed to update DNS record, no parsable "
+					" JSON response returned from LiveDNS", NULL, __FILE__,
+					__LINE__);
+				run->errors++;
+				return FAILED;
+			}
 
-			snprintf(last_status_buffer, 4, "%ld", last_status);
+			snprintf(last_status_buffer, 4, "%ld", *status);
 
 			logmsg(DEBUG, "HTTP status from LiveDNS PUT=", last_status_buffer,
 				__FILE__, __LINE__);
 
-			logmsg(DEBUG, "response from LiveDNS PUT=",
-				cJSON_PrintUnformatted(root), __FILE__, __LINE__);
+			if (verbosity >= DEBUG) {
+				printed = cJSON_PrintUnformatted(root);
+				logmsg(DEBUG, "response from LiveDNS PUT=", printed,
+					__FILE__, __LINE__);
+				free(printed);
+			}
 
-			if (last_status >= 200 && last_status <= 299) {
+			if (*status >= 200 && *status <= 299) {
+				if (run->damp_path != NULL) {
+					damp_wrote(&damp_state, &run->damping, now);
+					save_damp_state(run, damp_key, &damp_state);
+				}
+				zone_written(run, t);
 				logmsg(NOTICE, "new 'A' record update for ",
-					subdomain, __FILE__, __LINE__);
-				printf("The 'A' record for '%s' was updated to the public IPv4 "
-					"address of '%s'.\n", subdomain, current_ipv4);
+					t->subdomain, __FILE__, __LINE__);
+				say(run, "The 'A' record for '%s' was updated to the public "
+					"IPv4 address of '%s'.\n", t->subdomain, run->ipv4);
 			} else {
 				logmsg(CRIT, "'A' record not update for ",
-					subdomain, __FILE__, __LINE__);
-				printf("The 'A' record for '%s' was NOT updated to the public "
-					"IPv4 address of '%s'. Set increased verbosity to see "
-					"details and try again.\n", subdomain, current_ipv4);
+					t->subdomain, __FILE__, __LINE__);
+				say(run, "The 'A' record for '%s' was NOT updated to the "
+					"public IPv4 address of '%s'. Set increased verbosity to "
+					"see details and try again.\n", t->subdomain, run->ipv4);
+				run->errors++;
+				return FAILED;
 			}
-
-			cJSON_free(new_array);
-			cJSON_free(new_obj);
 		break;
 
 		case CREATE:
-			logmsg(INFO, "'A' record needs to be created=", subdomain,
+			logmsg(INFO, "'A' record needs to be created=", t->subdomain,
 				__FILE__, __LINE__);
 
-			if (dry_run) {
+			if (run->dry_run) {
 				logmsg(INFO, "Not proceeding with operation as dry_run was set "
 					"with -x", NULL, __FILE__, __LINE__);
-				printf("A new 'A' record will be created for '%s' with an IPv4 "
-					"address of '%s'.\nNot proceeding with operation as the "
-					"dry_run option was set with -x.\n",
-					subdomain, current_ipv4);
-				exit(EXIT_SUCCESS);
+				say(run, "A new 'A' record will be created for '%s' with an "
+					"IPv4 address of '%s'.\nNot proceeding with operation as "
+					"the dry_run option was set with -x.\n",
+					t->subdomain, run->ipv4);
+				break;
 			}
 
-			new_ip_array[0] = current_ipv4;
-			new_obj = cJSON_CreateObject();
-			new_array = cJSON_CreateStringArray(new_ip_array, 1);
-
-			cJSON_AddItemToObject(new_obj, "rrset_values", new_array);
-			cJSON_AddStringToObject(new_obj, "rrset_name", subdomain);
-			cJSON_AddStringToObject(new_obj, "rrset_type", "A");
-			cJSON_AddNumberToObject(new_obj, "rrset_ttl", ttl);
+			body = rrset_body(body_buffer, sizeof body_buffer,
+				t->subdomain, run->ipv4, t->ttl, &body_len);
+			if (body == NULL) {
+				logmsg(EMERG, "record too large for the request body", NULL,
+					__FILE__, __LINE__);
+				run->errors++;
+				return FAILED;
+			}
 
 			logmsg(DEBUG, "JSON to be used for record creation=",
-					cJSON_PrintUnformatted(new_obj), __FILE__, __LINE__);
+					body, __FILE__, __LINE__);
 
-			root = req_post(url, new_obj, options, &last_status);
+			root = req_post_data(url, body, body_len, run->options, status);
 
-			fail_hard_if_null(root, "failed to create DNS record, no parsable "
-				"JSON response returned from LiveDNS", __FILE__, __LINE__);
+			if (root == NULL) {
+				logmsg(EMERG, "failed to create DNS record, no parsable "
+					"JSON response returned from LiveDNS", NULL, __FILE__,
+					__LINE__);
+				run->errors++;
+				return FAILED;
+			}
 
-			snprintf(last_status_buffer, 4, "%ld", last_status);
+			snprintf(last_status_buffer, 4, "%ld", *status);
 
 			logmsg(DEBUG, "HTTP status from LiveDNS POST=",
 				last_status_buffer, __FILE__, __LINE__);
 
-			logmsg(DEBUG, "response from LiveDNS POST=",
-				cJSON_PrintUnformatted(root), __FILE__, __LINE__);
+			if (verbosity >= DEBUG) {
+				printed = cJSON_PrintUnformatted(root);
+				logmsg(DEBUG, "response from LiveDNS POST=", printed,
+					__FILE__, __LINE__);
+				free(printed);
+			}
 
-			if (last_status >= 200 && last_status <= 299) {
-				logmsg(NOTICE, "new 'A' record created for ", subdomain,
+			if (*status >= 200 && *status <= 299) {
+				if (run->damp_path != NULL) {
+					damp_wrote(&damp_state, &run->damping, now);
+					save_damp_state(run, damp_key, &damp_state);
+				}
+				zone_written(run, t);
+				logmsg(NOTICE, "new 'A' record created for ", t->subdomain,
 					__FILE__, __LINE__);
-				printf("An 'A' record for '%s' was created with the public IPv4"
-					" address of '%s'.\n", subdomain, current_ipv4);
+				say(run, "An 'A' record for '%s' was created with the public "
+					"IPv4 address of '%s'.\n", t->subdomain, run->ipv4);
 			} else {
 				logmsg(CRIT, "'A' record not created for ",
-					subdomain, __FILE__, __LINE__);
-				printf("An 'A' record for '%s' was NOT created with the public "
-					"IPv4 address of '%s'. Set increased verbosity to see more "
-					"details and try again.\n\n", subdomain, current_ipv4);
+					t->subdomain, __FILE__, __LINE__);
+				say(run, "An 'A' record for '%s' was NOT created with the "
+					"public IPv4 address of '%s'. Set increased verbosity to "
+					"see more details and try again.\n\n", t->subdomain,
+					run->ipv4);
+				run->errors++;
+				return FAILED;
 			}
-
-			cJSON_free(new_array);
-			cJSON_free(new_obj);
 		break;
 	}
+
+	return update_mode;
+}
+
+static size_t
+read_targets(char * data, size_t size, void * file)
+{
+	return fread(data, 1, size, (FILE *)file);
+}
+
+/*
+ * Update every target in the NDJSON file at path, "-" for stdin. Regular
+ * files are mapped, anything else is read as a stream. Lines that aren't a
+ * target are logged, reported as invalid and skipped.
+ */
+static void
+update_targets(run_state * run, const char * path, const target * defaults)
+{
+	cJSON_LineReader reader;
+	struct stat sb;
+	cJSON * value;
+	FILE * file;
+	void * map;
+	target t;
+	char line_buffer[21];
+	long status;
+	int result;
+	int fd;
+
+	file = NULL;
+	map = NULL;
+
+	if (strcmp(path, "-") == 0) {
+		file = stdin;
+	} else {
+		fd = open(path, O_RDONLY);
+		if (fd == -1 || fstat(fd, &sb) != 0) {
+			logmsg(EMERG, "FATAL: unable to open targets file ", path,
+				__FILE__, __LINE__);
+			exit(EXIT_FAILURE);
+		}
+		if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+			map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd,
+				0);
+			if (map == MAP_FAILED) {
+				map = NULL;
+			}
+		}
+		if (map == NULL) {
+			file = fdopen(fd, "r");
+			fail_hard_if_null(file, NULL, __FILE__, __LINE__);
+		} else {
+			close(fd);
+		}
+	}
+
+	if (map != NULL) {
+		if (!cJSON_InitLineReader(&reader, map, (size_t)sb.st_size)) {
+			fail_hard_if_null(NULL, NULL, __FILE__, __LINE__);
+		}
+	} else if (!cJSON_InitStreamLineReader(&reader, 0, read_targets, file)) {
+		fail_hard_if_null(NULL, NULL, __FILE__, __LINE__);
+	}
+
+	for (;;) {
+		result = cJSON_ReadLine(&reader, &value);
+		if (result == cJSON_LineEnd) {
+			break;
+		}
+		if (result == cJSON_LineFailed) {
+			fail_hard_if_null(NULL, "unable to read targets", __FILE__,
+				__LINE__);
+		}
+
+		snprintf(line_buffer, sizeof line_buffer, "%zu", reader.line);
+
+		if (result == cJSON_LineInvalid ||
+			read_target(value, defaults, &t) != 0) {
+			logmsg(ERR, "skipping invalid target on line ", line_buffer,
+				__FILE__, __LINE__);
+			write_result(run, NULL, reader.line, FAILED, 0);
+			run->errors++;
+			continue;
+		}
+		t.line = reader.line;
+
+		logmsg(DEBUG, "target from line ", line_buffer, __FILE__, __LINE__);
+		result = update_target(run, &t, &status);
+		write_result(run, &t, t.line, result, status);
+	}
+
+	if (file != NULL && ferror(file)) {
+		logmsg(ERR, "unable to read all targets from ", path,
+			__FILE__, __LINE__);
+		run->errors++;
+	}
+
+	cJSON_FreeLineReader(&reader);
+	if (map != NULL) {
+		munmap(map, (size_t)sb.st_size);
+	}
+	if (file != NULL && file != stdin) {
+		fclose(file);
+	}
+}
+
+/*
+ * Fill t from a target line, {"subdomain": "www", "domain": "foo.com",
+ * "ttl": 600}. The domain and ttl default to those of -d and -t. Returns -1
+ * if the line is no such object.
+ */
+static int
+read_target(const cJSON * value, const target * defaults, target * t)
+{
+	const cJSON * item;
+
+	*t = *defaults;
+
+	item = cJSON_GetObjectItemCaseSensitive(value, "subdomain");
+	if (!cJSON_IsString(item) || item->valuestring[0] == '\0') {
+		return -1;
+	}
+	t->subdomain = item->valuestring;
+
+	item = cJSON_GetObjectItemCaseSensitive(value, "domain");
+	if (cJSON_IsString(item)) {
+		t->domain = item->valuestring;
+	}
+	if (t->domain == NULL || strlen(t->domain) < 3) {
+		return -1;
+	}
+
+	item = cJSON_GetObjectItemCaseSensitive(value, "ttl");
+	if (item != NULL) {
+		if (!cJSON_IsNumber(item)) {
+			return -1;
+		}
+		t->ttl = clamp_ttl(item->valueint);
+	}
+
 	return 0;
 }
 
+/*
+ * Write the NDJSON result of a target, t is NULL for a line that wasn't
+ * one. Nothing is written without -o.
+ */
+static void
+write_result(run_state * run, const target * t, size_t line, int result,
+	long status)
+{
+	cJSON_Writer * writer;
+	const char * name;
+
+	writer = run->results;
+	if (writer == NULL) {
+		return;
+	}
+
+	switch (result) {
+		case CREATE:
+			name = run->dry_run ? "create" : "created";
+			break;
+		case UPDATE:
+			name = run->dry_run ? "update" : "updated";
+			break;
+		case ACCURATE:
+			name = "accurate";
+			break;
+		case DAMPED:
+			name = "damped";
+			break;
+		case FAILED:
+		default:
+			name = t != NULL ? "failed" : "invalid";
+	}
+
+	cJSON_WriteObjectStart(writer);
+	if (line > 0) {
+		cJSON_WriteKey(writer, "line");
+		cJSON_WriteNumber(writer, (double)line);
+	}
+	if (t != NULL) {
+		cJSON_WriteKey(writer, "domain");
+		cJSON_WriteString(writer, t->domain);
+		cJSON_WriteKey(writer, "subdomain");
+		cJSON_WriteString(writer, t->subdomain);
+		cJSON_WriteKey(writer, "ipv4");
+		cJSON_WriteString(writer, run->ipv4);
+	}
+	cJSON_WriteKey(writer, "result");
+	cJSON_WriteString(writer, name);
+	if (status > 0) {
+		cJSON_WriteKey(writer, "status");
+		cJSON_WriteNumber(writer, (double)status);
+	}
+	cJSON_WriteObjectEnd(writer);
+
+	/* a failed writer stays failed, cJSON_FinishWriter reports it */
+	cJSON_WriteLine(writer);
+}
+
+/*
+ * Fetch the zone's records from LiveDNS into zone. The listing is walked one
+ * rrset at a time as it arrives so only the table itself stays in memory.
+ * Each rrset is decoded straight into the table without cJSON items. Returns
+ * -1, with nothing left to free, if the zone couldn't be fetched.
+ */
+static int
+livedns_zone(const char * url, req_options * options, rrtab * zone)
+{
+	cJSON * item;
+	rrset_stream stream;
+	long last_status;
+	char last_status_buffer[4];
+	char count_buffer[21];
+	int failed;
+
+	if (rrtab_init(zone, 0) != 0) {
+		fail_hard_if_null(NULL, NULL, __FILE__, __LINE__);
+	}
+
+	rrset_stream_init(&stream, rrtab_collect_record, zone);
+
+	failed = req_get_stream(url, options, &last_status, rrset_stream_write,
+		&stream);
+
+	if (failed == 0) {
+		failed = rrset_stream_finish(&stream);
+	}
+
+	if (failed != 0) {
+		logmsg(EMERG, "failed to fetch DNS records, no parsable JSON "
+			"response returned from LiveDNS", NULL, __FILE__, __LINE__);
+		rrset_stream_free(&stream);
+		rrtab_free(zone);
+		return -1;
+	}
+
+	snprintf(last_status_buffer, 4, "%ld", last_status);
+
+	logmsg(DEBUG, "HTTP status from LiveDNS GET=",
+		last_status_buffer, __FILE__, __LINE__);
+
+	if (last_status >= 400) {
+		logmsg(EMERG, "received an error response from LiveDNS GET=",
+			last_status_buffer, __FILE__, __LINE__);
+
+		item = cJSON_GetObjectItem(stream.other, "message");
+
+		if (item == NULL) {
+			logmsg(EMERG, "No error message provided", NULL,
+				__FILE__, __LINE__);
+		} else {
+			logmsg(EMERG, "error=", cJSON_GetStringValue(item),
+				__FILE__, __LINE__);
+		}
+
+		rrset_stream_free(&stream);
+		rrtab_free(zone);
+		return -1;
+	}
+
+	if (stream.other != NULL) {
+		logmsg(WARN, "LiveDNS GET did not return a list of records",
+			NULL, __FILE__, __LINE__);
+	}
+
+	snprintf(count_buffer, sizeof count_buffer, "%zu", zone->count);
+	logmsg(DEBUG, "rrsets read from LiveDNS GET=", count_buffer,
+		__FILE__, __LINE__);
+
+	rrset_stream_free(&stream);
+
+	return 0;
+}
+
+/* Work out what has to happen to the A record for subdomain. */
+static unsigned short
+record_state(const rrtab * zone, const char * subdomain,
+	const char * current_ipv4)
+{
+	const rrtab_entry * entry;
+	const char * value;
+	char buffer[64];
+	size_t i;
+
+	entry = rrtab_find(zone, "A", subdomain);
+	if (entry == NULL) {
+		return CREATE;
+	}
+
+	logmsg(DEBUG, "found matching record: ", entry->name,
+		__FILE__, __LINE__);
+
+	if (rrtab_has_ipv4(entry, current_ipv4)) {
+		return ACCURATE;
+	}
+
+	for (i = 0; i < entry->nvalues; i++) {
+		value = rrtab_value(entry, i, buffer, sizeof buffer, NULL);
+		logmsg(INFO, "record doesn't have accurate ipv4"
+			" address in A record. Stale value=",
+			value, __FILE__, __LINE__);
+	}
+
+	return UPDATE;
+}
+
+/*
+ * Write the body that sets the A record to ipv4 into buf, with name and type
+ * when it is created (name not NULL). Returns the body, with its length in
+ * len, or NULL if it didn't fit.
+ */
+static const char *
+rrset_body(char * buf, size_t size, const char * name, const char * ipv4,
+	int ttl, size_t * len)
+{
+	cJSON_Writer writer;
+
+	cJSON_InitWriter(&writer, buf, size);
+
+	cJSON_WriteObjectStart(&writer);
+	cJSON_WriteKey(&writer, "rrset_values");
+	cJSON_WriteArrayStart(&writer);
+	cJSON_WriteString(&writer, ipv4);
+	cJSON_WriteArrayEnd(&writer);
+	if (name != NULL) {
+		cJSON_WriteKey(&writer, "rrset_name");
+		cJSON_WriteString(&writer, name);
+		cJSON_WriteKey(&writer, "rrset_type");
+		cJSON_WriteString(&writer, "A");
+	}
+	cJSON_WriteKey(&writer, "rrset_ttl");
+	cJSON_WriteNumber(&writer, ttl);
+	cJSON_WriteObjectEnd(&writer);
+
+	/* the writer stays failed after the first token that didn't fit */
+	return cJSON_FinishWriter(&writer, len);
+}
+
 static void
 logmsg(int level, const char * msg, const char * value, const char * file,
 	unsigned int line)
@@ -494,11 +1193,119 @@ logmsg(int level, const char * msg, const char * value, const char * file,
 static void
 usage(void)
 {
-	fprintf(stderr, "Usage:\n  %s [-xh] [-i ipv4 lookup] [-p json prop] "
-		"[-t ttl] [-v verbosity] -s subdomain -d domain\n", getprogname());
+	fprintf(stderr, "Usage:\n  %s [-xh] [-i ipv4 lookup] [-f ipv4] "
+		"[-p json prop] [-t ttl] [-v verbosity]\n"
+		"\t[-r requests per second] [-b burst] [-a] [-A nameserver]\n"
+		"\t[-S state file [-n observations] [-T hold] [-w writes] "
+		"[-W window]]\n\t-s subdomain -d domain\n"
+		"  %s [-xh] [...] [-o results] -B targets [-d domain]\n",
+		getprogname(), getprogname());
 	exit(EXIT_FAILURE);
 }
 
+static unsigned int
+parse_count(const char * value, const char * option)
+{
+	char * end;
+	unsigned long count;
+
+	count = strtoul(value, &end, 10);
+	if (*value == '\0' || *value == '-' || *end != '\0' || count > 86400000) {
+		logmsg(EMERG, "FATAL: invalid value for ", option, __FILE__, __LINE__);
+		exit(EXIT_FAILURE);
+	}
+
+	return (unsigned int)count;
+}
+
+static double
+parse_rate(const char * value, const char * option)
+{
+	char * end;
+	double rate;
+
+	rate = strtod(value, &end);
+	if (end == value || *end != '\0' || !(rate >= 0) || rate > 1e6) {
+		logmsg(EMERG, "FATAL: invalid value for ", option, __FILE__, __LINE__);
+		exit(EXIT_FAILURE);
+	}
+
+	return rate;
+}
+
+/* Keep ttl within what LiveDNS accepts, logging any change. */
+static int
+clamp_ttl(int ttl)
+{
+	char ttl_buffer[TTL_CHAR_BUFSIZE + 1];
+
+	if (ttl > LIVEDNS_MAX_TTL) {
+		ttl = LIVEDNS_MAX_TTL;
+		snprintf(ttl_buffer, TTL_CHAR_BUFSIZE, "%d", ttl);
+		logmsg(ERR, "Desired ttl exceeded LIVEDNS_MAX_TTL, capped to ",
+			ttl_buffer, __FILE__, __LINE__);
+	}
+
+	if (ttl < LIVEDNS_MIN_TTL) {
+		ttl = LIVEDNS_MIN_TTL;
+		snprintf(ttl_buffer, TTL_CHAR_BUFSIZE, "%d", ttl);
+		logmsg(ERR, "Desired ttl lower than LIVEDNS_MIN_TTL, increased to ",
+			ttl_buffer, __FILE__, __LINE__);
+	}
+
+	return ttl;
+}
+
+/* printf() for the messages of a run, -o replaces them with results. */
+static void
+say(const run_state * run, const char * format, ...)
+{
+	va_list ap;
+
+	if (run->results != NULL) {
+		return;
+	}
+
+	va_start(ap, format);
+	vprintf(format, ap);
+	va_end(ap);
+}
+
+/* cJSON_WriterFlush for the results file */
+static size_t
+write_results(const char * data, size_t length, void * file)
+{
+	return fwrite(data, 1, length, (FILE *)file);
+}
+
+static void
+save_damp_state(run_state * run, const char * key, const damp_record * rec)
+{
+	if (damp_put(&run->damp, key, rec) != 0) {
+		logmsg(ERR, "unable to keep damping state for ", key,
+			__FILE__, __LINE__);
+	}
+}
+
+/*
+ * Record a write of t's A record in the run's zone, so that a later target
+ * with the same name finds it done instead of writing it again.
+ */
+static void
+zone_written(run_state * run, const target * t)
+{
+	if (run->zone_domain == NULL) {
+		return;
+	}
+
+	if (rrtab_set_ipv4(&run->zone, t->subdomain, run->ipv4, t->ttl) != 0) {
+		/* the next target of the domain fetches the listing again */
+		rrtab_free(&run->zone);
+		free(run->zone_domain);
+		run->zone_domain = NULL;
+	}
+}
+
 static void
 fail_hard_if_null(void * ptr, const char * msg, const char * file,
 	unsigned int line)
@@ -0,0 +1,407 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <bsd/stdlib.h>
+#endif
+
+#include "dns.h"
+
+#define DNS_HEADER_SIZE 12
+#define DNS_PACKET_SIZE 512
+#define DNS_CLASS_IN 1
+#define DNS_RCODE_NXDOMAIN 3
+#define DNS_MAX_POINTERS 16
+
+static int
+encode_name(unsigned char * out, size_t out_len, const char * name)
+{
+	const char * label;
+	size_t label_len;
+	size_t offset;
+
+	offset = 0;
+	label = name;
+
+	while (*label != '\0') {
+		label_len = strcspn(label, ".");
+		if (label_len == 0 || label_len > 63 ||
+			offset + label_len + 2 > out_len) {
+			return -1;
+		}
+
+		out[offset++] = (unsigned char)label_len;
+		memcpy(out + offset, label, label_len);
+		offset += label_len;
+
+		label += label_len;
+		if (*label == '.') {
+			label++;
+		}
+	}
+
+	if (offset + 1 > out_len || offset + 1 > 255) {
+		return -1;
+	}
+	out[offset++] = 0;
+
+	return (int)offset;
+}
+
+/*
+ * Read the possibly compressed name at *offset into out as a dotted string
+ * and move *offset past it.
+ */
+static int
+decode_name(const unsigned char * msg, size_t msg_len, size_t * offset,
+	char * out, size_t out_len)
+{
+	size_t pos;
+	size_t written;
+	size_t label_len;
+	int jumps;
+
+	pos = *offset;
+	written = 0;
+	jumps = 0;
+
+	for (;;) {
+		if (pos >= msg_len) {
+			return -1;
+		}
+
+		label_len = msg[pos];
+
+		if ((label_len & 0xc0) == 0xc0) {
+			if (pos + 1 >= msg_len || ++jumps > DNS_MAX_POINTERS) {
+				return -1;
+			}
+			if (jumps == 1) {
+				*offset = pos + 2;
+			}
+			pos = ((label_len & 0x3f) << 8) | msg[pos + 1];
+			continue;
+		}
+
+		if (label_len > 63) {
+			return -1;
+		}
+
+		pos += 1;
+
+		if (label_len == 0) {
+			break;
+		}
+
+		if (pos + label_len > msg_len ||
+			written + label_len + 2 > out_len) {
+			return -1;
+		}
+
+		if (written > 0) {
+			out[written++] = '.';
+		}
+		memcpy(out + written, msg + pos, label_len);
+		written += label_len;
+		pos += label_len;
+	}
+
+	out[written] = '\0';
+
+	if (jumps == 0) {
+		*offset = pos;
+	}
+
+	return 0;
+}
+
+static int
+parse_response(const unsigned char * msg, size_t msg_len, unsigned short id,
+	const char * name, unsigned short qtype, dns_result * result)
+{
+	size_t offset;
+	unsigned int questions;
+	unsigned int answers;
+	unsigned int type;
+	unsigned int class;
+	size_t rdlength;
+	char owner[256];
+
+	if (msg_len < DNS_HEADER_SIZE ||
+		((msg[0] << 8) | msg[1]) != id ||
+		!(msg[2] & 0x80)) {
+		return -1;
+	}
+
+	result->authoritative = (msg[2] & 0x04) != 0;
+	result->truncated = (msg[2] & 0x02) != 0;
+	result->rcode = msg[3] & 0x0f;
+
+	questions = (msg[4] << 8) | msg[5];
+	answers = (msg[6] << 8) | msg[7];
+
+	offset = DNS_HEADER_SIZE;
+
+	/* the one question we asked has to come back, or it isn't our answer */
+	if (questions != 1 ||
+		decode_name(msg, msg_len, &offset, owner, sizeof owner) != 0 ||
+		offset + 4 > msg_len ||
+		strcasecmp(owner, name) != 0 ||
+		((msg[offset] << 8) | msg[offset + 1]) != qtype ||
+		((msg[offset + 2] << 8) | msg[offset + 3]) != DNS_CLASS_IN) {
+		return -1;
+	}
+	offset += 4;
+
+	while (answers-- > 0) {
+		if (decode_name(msg, msg_len, &offset, owner, sizeof owner) != 0 ||
+			offset + 10 > msg_len) {
+			return -1;
+		}
+
+		type = (msg[offset] << 8) | msg[offset + 1];
+		class = (msg[offset + 2] << 8) | msg[offset + 3];
+		rdlength = (msg[offset + 8] << 8) | msg[offset + 9];
+		offset += 10;
+
+		if (offset + rdlength > msg_len) {
+			return -1;
+		}
+
+		if (class == DNS_CLASS_IN && strcasecmp(owner, name) == 0) {
+			if (type == DNS_TYPE_A && rdlength == 4 &&
+				result->naddrs < DNS_MAX_ANSWERS) {
+				inet_ntop(AF_INET, msg + offset,
+					result->addrs[result->naddrs++], 16);
+			} else if (type == DNS_TYPE_NS &&
+				result->nhosts < DNS_MAX_ANSWERS) {
+				size_t rdata = offset;
+				if (decode_name(msg, msg_len, &rdata,
+					result->hosts[result->nhosts], 256) == 0) {
+					result->nhosts++;
+				}
+			}
+		}
+
+		offset += rdlength;
+	}
+
+	return 0;
+}
+
+/*
+ * Send a single UDP query for name to server, given as "host" or
+ * "host:port", and collect the A or NS answers owned by name.
+ * Returns -1 if no valid response arrived within DNS_TIMEOUT_MS.
+ */
+int
+dns_query(const char * server, const char * name, unsigned short qtype,
+	int recurse, dns_result * result)
+{
+	unsigned char packet[DNS_PACKET_SIZE];
+	char host[256];
+	char qname[256];
+	const char * port;
+	const char * colon;
+	struct addrinfo hints, * res;
+	struct pollfd pfd;
+	unsigned short id;
+	ssize_t received;
+	size_t length;
+	int name_len;
+	int sock;
+	int ret;
+
+	memset(result, 0, sizeof(dns_result));
+
+	colon = strchr(server, ':');
+	if (colon != NULL) {
+		if ((size_t)(colon - server) >= sizeof host) {
+			return -1;
+		}
+		memcpy(host, server, (size_t)(colon - server));
+		host[colon - server] = '\0';
+		port = colon + 1;
+	} else {
+		snprintf(host, sizeof host, "%s", server);
+		port = DNS_PORT;
+	}
+
+	snprintf(qname, sizeof qname, "%s", name);
+	length = strlen(qname);
+	if (length > 0 && qname[length - 1] == '.') {
+		qname[length - 1] = '\0';
+	}
+
+	id = (unsigned short)(arc4random() & 0xffff);
+
+	memset(packet, 0, DNS_HEADER_SIZE);
+	packet[0] = (unsigned char)(id >> 8);
+	packet[1] = (unsigned char)(id & 0xff);
+	packet[2] = recurse ? 0x01 : 0x00;
+	packet[5] = 1;
+
+	name_len = encode_name(packet + DNS_HEADER_SIZE,
+		sizeof packet - DNS_HEADER_SIZE - 4, qname);
+	if (name_len < 0) {
+		return -1;
+	}
+
+	length = DNS_HEADER_SIZE + (size_t)name_len;
+	packet[length++] = (unsigned char)(qtype >> 8);
+	packet[length++] = (unsigned char)(qtype & 0xff);
+	packet[length++] = 0;
+	packet[length++] = DNS_CLASS_IN;
+
+	memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	if (getaddrinfo(host, port, &hints, &res) != 0) {
+		return -1;
+	}
+
+	ret = -1;
+
+	sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (sock < 0) {
+		freeaddrinfo(res);
+		return -1;
+	}
+
+	if (connect(sock, res->ai_addr, res->ai_addrlen) != 0 ||
+		send(sock, packet, length, 0) != (ssize_t)length) {
+		goto done;
+	}
+
+	pfd.fd = sock;
+	pfd.events = POLLIN;
+
+	/* skip anything that is not the answer to our query */
+	while (poll(&pfd, 1, DNS_TIMEOUT_MS) == 1) {
+		received = recv(sock, packet, sizeof packet, 0);
+		if (received < 0) {
+			break;
+		}
+		if (parse_response(packet, (size_t)received, id, qname, qtype,
+			result) == 0) {
+			ret = 0;
+			break;
+		}
+		memset(result, 0, sizeof(dns_result));
+	}
+
+done:
+	close(sock);
+	freeaddrinfo(res);
+
+	return ret;
+}
+
+/* Copy the first IPv4 nameserver listed in resolv.conf into server. */
+int
+dns_system_resolver(char * server, size_t server_len)
+{
+	FILE * fp;
+	char line[256];
+	char address[64];
+	struct in_addr addr;
+	int ret;
+
+	fp = fopen(DNS_RESOLV_CONF, "r");
+	if (fp == NULL) {
+		return -1;
+	}
+
+	ret = -1;
+
+	while (fgets(line, sizeof line, fp) != NULL) {
+		if (sscanf(line, " nameserver %63s", address) == 1 &&
+			inet_pton(AF_INET, address, &addr) == 1) {
+			snprintf(server, server_len, "%s", address);
+			ret = 0;
+			break;
+		}
+	}
+
+	fclose(fp);
+
+	return ret;
+}
+
+static int
+compare_a(const dns_result * result, const char * ipv4)
+{
+	if (result->truncated || !result->authoritative) {
+		return DNS_INCONCLUSIVE;
+	}
+
+	if (result->rcode == DNS_RCODE_NXDOMAIN) {
+		return DNS_MISMATCH;
+	}
+
+	if (result->rcode != 0) {
+		return DNS_INCONCLUSIVE;
+	}
+
+	/* other addresses next to ours still need the update to remove them */
+	if (result->naddrs == 1 && strcmp(result->addrs[0], ipv4) == 0) {
+		return DNS_MATCH;
+	}
+
+	return DNS_MISMATCH;
+}
+
+/*
+ * Ask an authoritative server of zone whether name already has an A record
+ * for ipv4. If server is NULL, the zone's nameservers are looked up through
+ * the system resolver and tried in turn until one gives a usable answer.
+ */
+int
+dns_verify_a(const char * zone, const char * name, const char * server,
+	const char * ipv4)
+{
+	dns_result result;
+	char resolver[64];
+	char hosts[DNS_MAX_ANSWERS][256];
+	size_t nhosts;
+	size_t i;
+	int verdict;
+
+	if (server != NULL) {
+		if (dns_query(server, name, DNS_TYPE_A, 0, &result) != 0) {
+			return DNS_INCONCLUSIVE;
+		}
+		return compare_a(&result, ipv4);
+	}
+
+	if (dns_system_resolver(resolver, sizeof resolver) != 0 ||
+		dns_query(resolver, zone, DNS_TYPE_NS, 1, &result) != 0) {
+		return DNS_INCONCLUSIVE;
+	}
+
+	nhosts = result.nhosts;
+	memcpy(hosts, result.hosts, sizeof hosts);
+
+	for (i = 0; i < nhosts; i++) {
+		if (dns_query(hosts[i], name, DNS_TYPE_A, 0, &result) != 0) {
+			continue;
+		}
+		verdict = compare_a(&result, ipv4);
+		if (verdict != DNS_INCONCLUSIVE) {
+			return verdict;
+		}
+	}
+
+	return DNS_INCONCLUSIVE;
+}
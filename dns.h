@@ -0,0 +1,37 @@
+#ifndef _DNS_H_
+#define _DNS_H_
+
+#include <stddef.h>
+
+#define DNS_PORT "53"
+#define DNS_TIMEOUT_MS 2000
+#define DNS_MAX_ANSWERS 16
+#define DNS_RESOLV_CONF "/etc/resolv.conf"
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_NS 2
+
+#define DNS_MATCH 0
+#define DNS_MISMATCH 1
+#define DNS_INCONCLUSIVE 2
+
+typedef struct {
+	int rcode;
+	int authoritative;
+	int truncated;
+	char addrs[DNS_MAX_ANSWERS][16];	/* A answers, dotted quad */
+	size_t naddrs;
+	char hosts[DNS_MAX_ANSWERS][256];	/* NS answers */
+	size_t nhosts;
+} dns_result;
+
+int
+dns_query(const char *, const char *, unsigned short, int, dns_result *);
+
+int
+dns_system_resolver(char *, size_t);
+
+int
+dns_verify_a(const char *, const char *, const char *, const char *);
+
+#endif /* !_DNS_H_ */
@@ -0,0 +1,149 @@
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "ratelimit.h"
+
+void
+ratelimit_init(ratelimit * rl, double rate, double burst)
+{
+	memset(rl, 0, sizeof(ratelimit));
+
+	if (rate < 0) {
+		rate = 0;
+	}
+	if (burst < 1) {
+		burst = 1;
+	}
+
+	rl->rate = rate;
+	rl->current = rate;
+	rl->burst = burst;
+	rl->tokens = burst;
+	rl->last = -1;
+}
+
+static void
+refill(ratelimit * rl, double now)
+{
+	if (rl->last < 0) {
+		rl->last = now;
+		return;
+	}
+
+	if (now > rl->last) {
+		rl->tokens += (now - rl->last) * rl->current;
+		if (rl->tokens > rl->burst) {
+			rl->tokens = rl->burst;
+		}
+		rl->last = now;
+	}
+}
+
+/*
+ * Take a token for a request that wants to start at now and return how many
+ * seconds the caller has to wait before sending it. The token is consumed
+ * even if the bucket is empty, so requests queue up behind each other in the
+ * order they reserved.
+ */
+double
+ratelimit_reserve(ratelimit * rl, double now)
+{
+	double wait;
+
+	wait = 0;
+
+	if (rl->blocked_until > now) {
+		wait = rl->blocked_until - now;
+	}
+
+	if (rl->current <= 0) {
+		return wait;
+	}
+
+	refill(rl, now);
+	rl->tokens -= 1;
+
+	if (rl->tokens < 0 && -rl->tokens / rl->current > wait) {
+		wait = -rl->tokens / rl->current;
+	}
+
+	return wait;
+}
+
+/*
+ * Feed back what the server said about the last request: its status, the
+ * remaining quota (-1 if unknown), when the quota resets and how long it asked
+ * us to back off, both in seconds from now (0 if not given).
+ *
+ * A 429 halves the effective rate and blocks until the server's retry time,
+ * successful responses creep back up to the configured rate, and the bucket
+ * never holds more tokens than the server says are left.
+ */
+void
+ratelimit_observe(ratelimit * rl, long status, long remaining, double reset,
+	double retry_after, double now)
+{
+	if (status == 429) {
+		if (retry_after <= 0) {
+			retry_after = reset > 0 ? reset : 1;
+		}
+		if (rl->rate > 0) {
+			rl->current /= 2;
+			if (rl->current < RATELIMIT_FLOOR) {
+				rl->current = RATELIMIT_FLOOR;
+			}
+			rl->tokens = 0;
+			rl->last = now;
+		}
+	} else if (rl->rate > 0 && rl->current < rl->rate) {
+		rl->current += rl->rate / 10;
+		if (rl->current > rl->rate) {
+			rl->current = rl->rate;
+		}
+	}
+
+	if (remaining == 0 && reset > retry_after) {
+		retry_after = reset;
+	}
+
+	if (retry_after > 0 && now + retry_after > rl->blocked_until) {
+		rl->blocked_until = now + retry_after;
+	}
+
+	if (remaining >= 0 && rl->tokens > remaining) {
+		rl->tokens = remaining;
+	}
+}
+
+double
+ratelimit_now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+		return (double)time(NULL);
+	}
+
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Block until the next request is allowed to start. */
+void
+ratelimit_acquire(ratelimit * rl)
+{
+	struct timespec ts;
+	double wait;
+
+	wait = ratelimit_reserve(rl, ratelimit_now());
+	if (wait <= 0) {
+		return;
+	}
+
+	ts.tv_sec = (time_t)wait;
+	ts.tv_nsec = (long)((wait - (double)ts.tv_sec) * 1e9);
+
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+		continue;
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef _RATELIMIT_H_
+#define _RATELIMIT_H_
+
+/* never back off below this many requests per second after a 429 */
+#define RATELIMIT_FLOOR 0.05
+
+typedef struct {
+	double rate;		/* configured requests per second, 0 = no limit */
+	double burst;		/* bucket capacity */
+	double current;		/* rate in effect after backing off */
+	double tokens;
+	double last;		/* when the bucket was last refilled */
+	double blocked_until;	/* no request may start before this */
+} ratelimit;
+
+void
+ratelimit_init(ratelimit *, double, double);
+
+double
+ratelimit_reserve(ratelimit *, double);
+
+void
+ratelimit_observe(ratelimit *, long, long, double, double, double);
+
+double
+ratelimit_now(void);
+
+void
+ratelimit_acquire(ratelimit *);
+
+#endif /* !_RATELIMIT_H_ */
@@ -1,11 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
 
 #include <curl/curl.h>
 
 #include "req.h"
 
+typedef struct {
+	long remaining;
+	double reset;
+	double retry_after;
+} req_limits;
+
+typedef struct {
+	CURL * handle;
+	req_writer writer;
+	void * ctx;
+	int retry;	/* a 429 to this attempt is sent again */
+} req_sink;
+
 static size_t
 write_mem_callback(void * contents, size_t size, size_t nmemb, void *userp)
 {
@@ -15,7 +30,7 @@ write_mem_callback(void * contents, size_t size, size_t nmemb, void *userp)
 
 	realsize = size * nmemb;
 	mem = (req_mem *)userp;
-	ptr = realloc(mem->memory, mem->size + realsize + 1);
+	ptr = realloc(mem->memory, mem->size + realsize);
 
 	if (ptr == NULL) {
 		fprintf(stderr, "not enough memory (realloc returned NULL)\n");
@@ -25,11 +40,30 @@ write_mem_callback(void * contents, size_t size, size_t nmemb, void *userp)
 	mem->memory = ptr;
 	memcpy(&(mem->memory[mem->size]), contents, realsize);
 	mem->size += realsize;
-	mem->memory[mem->size] = 0;
 
 	return realsize;
 }
 
+static size_t
+write_sink_callback(void * contents, size_t size, size_t nmemb, void * userp)
+{
+	size_t realsize;
+	req_sink * sink;
+	long status;
+
+	realsize = size * nmemb;
+	sink = (req_sink *)userp;
+	status = 0;
+
+	/* a 429 that perform() retries isn't passed on, the last one is */
+	curl_easy_getinfo(sink->handle, CURLINFO_RESPONSE_CODE, &status);
+	if (status == 429 && sink->retry) {
+		return realsize;
+	}
+
+	return sink->writer((const char *)contents, realsize, sink->ctx);
+}
+
 static size_t
 read_mem_callback(void * dest, size_t size, size_t nmemb, void *userp)
 {
@@ -56,28 +90,169 @@ read_mem_callback(void * dest, size_t size, size_t nmemb, void *userp)
 	return 0;
 }
 
-cJSON *
-req_put_or_post(CURLoption method, const char * url, cJSON * body,
-	req_options * options, long * status)
+static double
+header_seconds(const char * value)
+{
+	char * end;
+	double seconds;
+
+	seconds = strtod(value, &end);
+	if (end == value || seconds < 0) {
+		return 0;
+	}
+
+	/* some servers send an epoch timestamp rather than a delay */
+	if (seconds > 1e9) {
+		seconds -= (double)time(NULL);
+	}
+
+	return seconds > 0 ? seconds : 0;
+}
+
+static size_t
+header_callback(char * buffer, size_t size, size_t nitems, void * userp)
+{
+	size_t realsize;
+	req_limits * limits;
+	char line[256];
+	char * value;
+
+	realsize = size * nitems;
+	limits = (req_limits *)userp;
+
+	if (realsize >= sizeof line) {
+		return realsize;
+	}
+
+	memcpy(line, buffer, realsize);
+	line[realsize] = 0;
+
+	value = strchr(line, ':');
+	if (value == NULL) {
+		return realsize;
+	}
+	*value++ = 0;
+
+	if (strcasecmp(line, "X-RateLimit-Remaining") == 0) {
+		limits->remaining = strtol(value, NULL, 10);
+	} else if (strcasecmp(line, "X-RateLimit-Reset") == 0) {
+		limits->reset = header_seconds(value);
+	} else if (strcasecmp(line, "Retry-After") == 0) {
+		limits->retry_after = header_seconds(value);
+	}
+
+	return realsize;
+}
+
+/*
+ * Parse the collected body in place, it is not NUL terminated. The body's
+ * memory goes to the result (or the arena in options) and its strings point
+ * into it. A body that isn't JSON is reported, an empty one is not.
+ */
+static cJSON *
+parse_body(req_mem * chunk, req_options * options)
+{
+	cJSON_ParseStatus parsed;
+	cJSON * root;
+
+	root = cJSON_ParseInSitu(chunk->memory, chunk->size, &parsed,
+		options != NULL ? options->arena : NULL);
+	chunk->memory = NULL;
+
+	if (parsed.failed && chunk->size > 0) {
+		fprintf(stderr, "invalid JSON in response at byte %zu\n",
+			parsed.end);
+	}
+
+	return root;
+}
+
+/*
+ * Run the transfer, waiting on the rate limiter in options first if there is
+ * one. A 429 response is fed back into the limiter and the request is queued
+ * again instead of being returned, up to REQ_MAX_ATTEMPTS times. If retry is
+ * given it is set before each attempt to whether a 429 to it is retried.
+ */
+static CURLcode
+perform(CURL * curl_handle, req_mem * chunk, const req_mem * body,
+	req_mem * read_chunk, req_options * options, long * status, int * retry)
+{
+	CURLcode res;
+	req_limits limits;
+	ratelimit * rl;
+	int attempt;
+
+	rl = options != NULL ? options->ratelimit : NULL;
+
+	if (rl != NULL) {
+		curl_easy_setopt(curl_handle, CURLOPT_HEADERFUNCTION, header_callback);
+		curl_easy_setopt(curl_handle, CURLOPT_HEADERDATA, (void *)&limits);
+	}
+
+	for (attempt = 1; ; attempt++) {
+		limits.remaining = -1;
+		limits.reset = 0;
+		limits.retry_after = 0;
+
+		if (chunk != NULL) {
+			chunk->size = 0;
+		}
+
+		if (body != NULL) {
+			*read_chunk = *body;
+		}
+
+		if (rl != NULL) {
+			ratelimit_acquire(rl);
+		}
+
+		if (retry != NULL) {
+			*retry = rl != NULL && attempt < REQ_MAX_ATTEMPTS;
+		}
+
+		res = curl_easy_perform(curl_handle);
+		if (res != CURLE_OK) {
+			return res;
+		}
+
+		curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, status);
+
+		if (rl == NULL) {
+			return res;
+		}
+
+		ratelimit_observe(rl, *status, limits.remaining, limits.reset,
+			limits.retry_after, ratelimit_now());
+
+		if (*status != 429 || attempt >= REQ_MAX_ATTEMPTS) {
+			return res;
+		}
+	}
+}
+
+/* Send length bytes of data with method and parse the JSON response. */
+static cJSON *
+send_data(CURLoption method, const char * url, const char * data,
+	size_t length, req_options * options, long * status)
 {
 	CURL * curl_handle;
 	CURLcode res;
 	struct curl_slist * list;
 	req_mem chunk;
+	req_mem body_chunk;
 	req_mem read_chunk;
-	char * data;
 	cJSON *root;
 
 	root = NULL;
 	list = NULL;
- 	
-	data = cJSON_PrintUnformatted(body);
 
-	chunk.memory = malloc(1);
+	chunk.memory = NULL;
 	chunk.size = 0;
 
-	read_chunk.memory = data;
-	read_chunk.size = strlen(data);
+	/* read_mem_callback only advances its copy */
+	body_chunk.memory = (char *)data;
+	body_chunk.size = length;
+	read_chunk = body_chunk;
 
 	curl_global_init(CURL_GLOBAL_ALL);
 
@@ -90,7 +265,7 @@ req_put_or_post(CURLoption method, const char * url, cJSON * body,
 	curl_easy_setopt(curl_handle, CURLOPT_READFUNCTION, read_mem_callback);
 	curl_easy_setopt(curl_handle, CURLOPT_READDATA, (void *)&read_chunk);
 	curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, REQ_USERAGENT);
-	curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDSIZE, read_chunk.size);
+	curl_easy_setopt(curl_handle, CURLOPT_POSTFIELDSIZE, (long)length);
 	curl_easy_setopt(curl_handle, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
 
 	list = curl_slist_append(list, "Content-Type: application/json");
@@ -107,14 +282,14 @@ req_put_or_post(CURLoption method, const char * url, cJSON * body,
 		}
 	}
 
-	res = curl_easy_perform(curl_handle);
+	res = perform(curl_handle, &chunk, &body_chunk, &read_chunk, options,
+		status, NULL);
 
 	if (res != CURLE_OK) {
 		fprintf(stderr, "curl_easy_perform() failed: %s\n",
 		curl_easy_strerror(res));
 	} else {
-		curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, status);
-		root = cJSON_Parse(chunk.memory);
+		root = parse_body(&chunk, options);
 	}
 
 	curl_easy_cleanup(curl_handle);
@@ -129,19 +304,44 @@ req_put_or_post(CURLoption method, const char * url, cJSON * body,
 }
 
 cJSON *
-req_get(const char * url, req_options * options, long * status)
+req_put_or_post(CURLoption method, const char * url, cJSON * body,
+	req_options * options, long * status)
+{
+	size_t length;
+	char * data;
+	cJSON *root;
+
+	/* the body is measured first and printed into one exact allocation */
+	length = cJSON_PrintedLength(body, 0);
+	data = cJSON_malloc(length + 1);
+
+	if (data == NULL || !cJSON_PrintPreallocated(body, data,
+		(int)length + 1, 0)) {
+		fprintf(stderr, "could not print the request body\n");
+		cJSON_free(data);
+		return NULL;
+	}
+
+	root = send_data(method, url, data, length, options, status);
+
+	cJSON_free(data);
+
+	return root;
+}
+
+/* GET url and collect the body into chunk, which the caller frees. */
+static CURLcode
+get_body(const char * url, req_options * options, long * status,
+	req_mem * chunk)
 {
 	CURL *curl_handle;
 	CURLcode res;
 	struct curl_slist * list;
-	req_mem chunk;
-	cJSON *root;
 
 	list = NULL;
-	root = NULL;
 
-	chunk.memory = malloc(1);
-	chunk.size = 0;
+	chunk->memory = NULL;
+	chunk->size = 0;
 
 	curl_global_init(CURL_GLOBAL_ALL);
 
@@ -149,7 +349,7 @@ req_get(const char * url, req_options * options, long * status)
 
 	curl_easy_setopt(curl_handle, CURLOPT_URL, url);
 	curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_mem_callback);
-	curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
+	curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)chunk);
 	curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, REQ_USERAGENT);
 	curl_easy_setopt(curl_handle, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
 
@@ -164,14 +364,11 @@ req_get(const char * url, req_options * options, long * status)
 		}
 	}
 
-	res = curl_easy_perform(curl_handle);
+	res = perform(curl_handle, chunk, NULL, NULL, options, status, NULL);
 
 	if (res != CURLE_OK) {
 		fprintf(stderr, "curl_easy_perform() failed: %s\n",
 		curl_easy_strerror(res));
-	} else {
-		curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, status);
-		root = cJSON_Parse(chunk.memory);
 	}
 
 	curl_easy_cleanup(curl_handle);
@@ -180,11 +377,117 @@ req_get(const char * url, req_options * options, long * status)
 		curl_slist_free_all(list);
 	}
 
+	curl_global_cleanup();
+
+	return res;
+}
+
+cJSON *
+req_get(const char * url, req_options * options, long * status)
+{
+	req_mem chunk;
+	cJSON *root;
+
+	root = NULL;
+
+	if (get_body(url, options, status, &chunk) == CURLE_OK) {
+		root = parse_body(&chunk, options);
+	}
+
+	free(chunk.memory);
+
+	return root;
+}
+
+/*
+ * Like req_get(), but only the string member key of the top level object is
+ * read from the body, into buf. Nothing else of the body is kept. Returns a
+ * cJSON_ExtractString() result, a failed transfer counts as invalid JSON.
+ */
+int
+req_get_string(const char * url, req_options * options, long * status,
+	const char * key, char * buf, size_t len)
+{
+	cJSON_ParseStatus parsed;
+	req_mem chunk;
+	int res;
+
+	res = cJSON_ExtractInvalid;
+
+	if (get_body(url, options, status, &chunk) == CURLE_OK) {
+		res = cJSON_ExtractString(chunk.memory, chunk.size, key, buf, len,
+			&parsed);
+		if (parsed.failed && chunk.size > 0) {
+			fprintf(stderr, "invalid JSON in response at byte %zu\n",
+				parsed.end);
+		}
+	}
+
 	free(chunk.memory);
 
+	return res;
+}
+
+/*
+ * Like req_get(), but every piece of the body is passed to writer as it
+ * arrives instead of being collected and parsed. writer returns how many
+ * bytes it consumed, anything short of the full piece aborts the transfer.
+ * Returns 0 if the transfer completed.
+ */
+int
+req_get_stream(const char * url, req_options * options, long * status,
+	req_writer writer, void * ctx)
+{
+	CURL *curl_handle;
+	CURLcode res;
+	struct curl_slist * list;
+	req_sink sink;
+
+	list = NULL;
+
+	curl_global_init(CURL_GLOBAL_ALL);
+
+	curl_handle = curl_easy_init();
+
+	sink.handle = curl_handle;
+	sink.writer = writer;
+	sink.ctx = ctx;
+	sink.retry = 0;
+
+	curl_easy_setopt(curl_handle, CURLOPT_URL, url);
+	curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_sink_callback);
+	curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&sink);
+	curl_easy_setopt(curl_handle, CURLOPT_USERAGENT, REQ_USERAGENT);
+	curl_easy_setopt(curl_handle, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+
+	if (options != NULL) {
+		if (options->headers != NULL) {
+			int i = 0;
+			while (options->headers[i] != NULL) {
+				list = curl_slist_append(list, options->headers[i]);
+				i += 1;
+			}
+			curl_easy_setopt(curl_handle, CURLOPT_HTTPHEADER, list);
+		}
+	}
+
+	res = perform(curl_handle, NULL, NULL, NULL, options, status,
+		&sink.retry);
+
+	if (res != CURLE_OK) {
+		fprintf(stderr, "curl_easy_perform() failed: %s\n",
+		curl_easy_strerror(res));
+	}
+
+	curl_easy_cleanup(curl_handle);
+
+	if (list != NULL) {
+		curl_slist_free_all(list);
+	}
+
 	curl_global_cleanup();
 
-	return root;
+	return res == CURLE_OK ? 0 : -1;
 }
 
 cJSON *
@@ -200,3 +503,18 @@ req_post(const char *url, cJSON * body, req_options * options,
 {
 	return req_put_or_post(CURLOPT_POST, url, body, options, status);
 }
+
+/* PUT length bytes of JSON, such as a body from a cJSON_Writer, to url. */
+cJSON *
+req_put_data(const char * url, const char * data, size_t length,
+	req_options * options, long * status)
+{
+	return send_data(CURLOPT_PUT, url, data, length, options, status);
+}
+
+cJSON *
+req_post_data(const char * url, const char * data, size_t length,
+	req_options * options, long * status)
+{
+	return send_data(CURLOPT_POST, url, data, length, options, status);
+}
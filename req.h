@@ -2,11 +2,17 @@
 #define _REQ_H_
 
 #include "cJSON.h"
+#include "ratelimit.h"
 
 #define REQ_USERAGENT "libcurl-agent/1.0"
 
+/* how often a request is sent before a 429 is handed back to the caller */
+#define REQ_MAX_ATTEMPTS 5
+
 typedef struct {
 	const char ** headers;
+	ratelimit * ratelimit;
+	cJSON_Arena * arena;	/* parse responses into this arena if set */
 } req_options;
 
 typedef struct {
@@ -14,14 +20,30 @@ typedef struct {
   size_t size;
 } req_mem;
 
+/* consumes a piece of a streamed response body, returns the bytes used */
+typedef size_t (*req_writer)(const char *, size_t, void *);
+
 cJSON *
 req_get(const char *, req_options *, long *);
 
+int
+req_get_string(const char *, req_options *, long *, const char *, char *,
+	size_t);
+
+int
+req_get_stream(const char *, req_options *, long *, req_writer, void *);
+
 cJSON *
 req_put(const char *, cJSON *, req_options *, long *);
 
 cJSON *
 req_post(const char *, cJSON *, req_options *, long *);
 
+cJSON *
+req_put_data(const char *, const char *, size_t, req_options *, long *);
+
+cJSON *
+req_post_data(const char *, const char *, size_t, req_options *, long *);
+
 #endif /* !_REQ_H_ */
 
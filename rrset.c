@@ -0,0 +1,530 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rrset.h"
+
+#define RRSET_BUFSIZE 1024
+#define RRSET_TOKEN_SIZE 65536	/* the longest string of a listing */
+#define RRSET_BOM "\xef\xbb\xbf"
+#define RRSET_VALUES_BUFSIZE 256
+
+/* the fields an rrset_reader reads, as bits of the ones already seen */
+#define RRSET_FIELD_TYPE 1
+#define RRSET_FIELD_NAME 2
+#define RRSET_FIELD_TTL 4
+#define RRSET_FIELD_VALUES 8
+
+#define RRSET_NOWHERE ((size_t)-1)	/* no such string in the text */
+
+#define is_space(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+static const struct {
+	const char * name;
+	size_t len;
+	int type;
+} rrset_types[] = {
+	{ "A", 1, RRSET_TYPE_A },
+	{ "AAAA", 4, RRSET_TYPE_AAAA },
+	{ "ALIAS", 5, RRSET_TYPE_ALIAS },
+	{ "CAA", 3, RRSET_TYPE_CAA },
+	{ "CNAME", 5, RRSET_TYPE_CNAME },
+	{ "MX", 2, RRSET_TYPE_MX },
+	{ "NS", 2, RRSET_TYPE_NS },
+	{ "PTR", 3, RRSET_TYPE_PTR },
+	{ "SRV", 3, RRSET_TYPE_SRV },
+	{ "TXT", 3, RRSET_TYPE_TXT },
+};
+
+/* The RRSET_TYPE_* of the len bytes at name. */
+int
+rrset_type(const char * name, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(rrset_types) / sizeof(rrset_types[0]); i++) {
+		if (rrset_types[i].len == len &&
+			memcmp(rrset_types[i].name, name, len) == 0) {
+			return rrset_types[i].type;
+		}
+	}
+
+	return RRSET_TYPE_OTHER;
+}
+
+static int
+reserve(void ** ptr, size_t * size, size_t need)
+{
+	size_t grown;
+	void * grown_ptr;
+
+	if (need <= *size) {
+		return 0;
+	}
+
+	grown = *size ? *size : RRSET_VALUES_BUFSIZE;
+	while (grown < need) {
+		grown *= 2;
+	}
+
+	grown_ptr = realloc(*ptr, grown);
+	if (grown_ptr == NULL) {
+		return -1;
+	}
+
+	*ptr = grown_ptr;
+	*size = grown;
+
+	return 0;
+}
+
+/* Turn the text values of an A or AAAA rrset into addresses. */
+static int
+decode_addrs(rrset_record * rec)
+{
+	size_t width, i, n;
+	int family;
+
+	width = rec->type == RRSET_TYPE_A ? 4 : 16;
+	family = rec->type == RRSET_TYPE_A ? AF_INET : AF_INET6;
+
+	if (reserve((void **)&rec->addrs, &rec->addrs_size,
+		rec->nvalues * width) != 0) {
+		return -1;
+	}
+
+	n = 0;
+	for (i = 0; i < rec->nvalues; i++) {
+		/* keep the listing usable if LiveDNS hands back junk */
+		if (inet_pton(family, rec->values[i].ptr,
+			rec->addrs + n * width) == 1) {
+			n++;
+		}
+	}
+	rec->nvalues = n;
+
+	return 0;
+}
+
+/* Which of the fields dldns reads the key names, 0 for any other. */
+static int
+decode_field(const char * key, size_t len)
+{
+	const char * name;
+
+	if (len < 9 || memcmp(key, "rrset_", 6) != 0) {
+		return 0;
+	}
+	name = key + 6;
+
+	switch (len - 6) {
+		case 3:
+			return memcmp(name, "ttl", 3) == 0 ? RRSET_FIELD_TTL : 0;
+		case 4:
+			if (memcmp(name, "type", 4) == 0) {
+				return RRSET_FIELD_TYPE;
+			}
+			return memcmp(name, "name", 4) == 0 ? RRSET_FIELD_NAME : 0;
+		case 6:
+			return memcmp(name, "values", 6) == 0 ? RRSET_FIELD_VALUES : 0;
+		default:
+			return 0;
+	}
+}
+
+/* Start reading the rrset whose members are events at depth into rec. */
+static void
+read_start(rrset_reader * rd, rrset_record * rec, size_t depth)
+{
+	rec->type = RRSET_TYPE_OTHER;
+	rec->type_name.ptr = NULL;
+	rec->name.ptr = NULL;
+	rec->ttl = 0;
+	rec->has_ttl = 0;
+	rec->nvalues = 0;
+	rec->text_len = 0;
+
+	rd->rec = rec;
+	rd->depth = depth;
+	rd->field = 0;
+	rd->seen = 0;
+	rd->values = 0;
+	rd->type_at = RRSET_NOWHERE;
+	rd->name_at = RRSET_NOWHERE;
+	rd->values_at = 0;
+}
+
+/* Copy a decoded string and its terminator into the record's text. */
+static int
+keep_text(rrset_record * rec, const cJSON_Event * event, size_t * at)
+{
+	if (reserve((void **)&rec->text, &rec->text_size,
+		rec->text_len + event->length + 1) != 0) {
+		return -1;
+	}
+
+	memcpy(rec->text + rec->text_len, event->string, event->length + 1);
+	*at = rec->text_len;
+	rec->text_len += event->length + 1;
+
+	return 0;
+}
+
+/*
+ * Take one event of the rrset being read. Values of the wrong type are
+ * passed over, and as with cJSON_GetObjectItemCaseSensitive() the first of
+ * repeated fields counts. Returns -1 if out of memory.
+ */
+static int
+read_event(rrset_reader * rd, const cJSON_Event * event)
+{
+	rrset_record * rec;
+	size_t at;
+	int field;
+
+	rec = rd->rec;
+
+	if (rd->values) {
+		if (event->depth == rd->depth) {
+			rd->values = 0;		/* the end of rrset_values */
+		} else if (event->depth == rd->depth + 1 &&
+			event->type == cJSON_EventString) {
+			if (reserve((void **)&rec->values, &rec->values_size,
+				(rec->nvalues + 1) * sizeof(rrset_span)) != 0 ||
+				keep_text(rec, event, &at) != 0) {
+				return -1;
+			}
+			rec->values[rec->nvalues].len = event->length;
+			rec->nvalues += 1;
+		}
+		return 0;
+	}
+
+	if (event->depth != rd->depth) {
+		return 0;
+	}
+
+	if (event->type == cJSON_EventKey) {
+		field = decode_field(event->string, event->length);
+		rd->field = field & ~rd->seen;
+		rd->seen |= field;
+		return 0;
+	}
+
+	switch (rd->field) {
+		case RRSET_FIELD_TYPE:
+			if (event->type == cJSON_EventString) {
+				rec->type_name.len = event->length;
+				if (keep_text(rec, event, &rd->type_at) != 0) {
+					return -1;
+				}
+			}
+			break;
+
+		case RRSET_FIELD_NAME:
+			if (event->type == cJSON_EventString) {
+				rec->name.len = event->length;
+				if (keep_text(rec, event, &rd->name_at) != 0) {
+					return -1;
+				}
+			}
+			break;
+
+		case RRSET_FIELD_TTL:
+			if (event->type == cJSON_EventNumber &&
+				event->number >= 0 && event->number <= UINT32_MAX) {
+				rec->ttl = (uint32_t)event->number;
+				rec->has_ttl = 1;
+			}
+			break;
+
+		case RRSET_FIELD_VALUES:
+			if (event->type == cJSON_EventArrayStart) {
+				rd->values = 1;
+				rd->values_at = rec->text_len;
+			}
+			break;
+	}
+	rd->field = 0;
+
+	return 0;
+}
+
+/*
+ * Point the record's spans into its text once the whole rrset was read.
+ * Returns RRSET_SKIPPED without an rrset_type and rrset_name.
+ */
+static int
+read_finish(rrset_reader * rd)
+{
+	rrset_record * rec;
+	const char * text;
+	size_t i;
+
+	rec = rd->rec;
+
+	if (rd->type_at == RRSET_NOWHERE || rd->name_at == RRSET_NOWHERE) {
+		rec->nvalues = 0;
+		return RRSET_SKIPPED;
+	}
+
+	rec->type_name.ptr = rec->text + rd->type_at;
+	rec->name.ptr = rec->text + rd->name_at;
+
+	/* nothing else is kept while rrset_values is read */
+	text = rec->text + rd->values_at;
+	for (i = 0; i < rec->nvalues; i++) {
+		rec->values[i].ptr = text;
+		text += rec->values[i].len + 1;
+	}
+
+	rec->type = rrset_type(rec->type_name.ptr, rec->type_name.len);
+	if ((rec->type == RRSET_TYPE_A || rec->type == RRSET_TYPE_AAAA) &&
+		decode_addrs(rec) != 0) {
+		return RRSET_INVALID;
+	}
+
+	return RRSET_DECODED;
+}
+
+static int
+decode_event(const cJSON_Event * event, void * user)
+{
+	return read_event((rrset_reader *)user, event) == 0 ?
+		cJSON_EventContinue : cJSON_EventStop;
+}
+
+/*
+ * Decode one rrset object of a LiveDNS listing into rec, without building
+ * cJSON items. The spans of rec point into its own copy of the strings.
+ * Fields other than rrset_type, rrset_name, rrset_ttl and rrset_values are
+ * only checked.
+ */
+int
+rrset_decode(const char * json, size_t len, rrset_record * rec)
+{
+	rrset_reader reader;
+
+	read_start(&reader, rec, 1);
+
+	if (cJSON_ParseEvents(json, len, decode_event, &reader) !=
+		cJSON_EventParserDone) {
+		return RRSET_INVALID;
+	}
+
+	return read_finish(&reader);
+}
+
+void
+rrset_record_free(rrset_record * rec)
+{
+	free(rec->values);
+	free(rec->addrs);
+	free(rec->text);
+
+	rec->values = NULL;
+	rec->addrs = NULL;
+	rec->text = NULL;
+	rec->values_size = 0;
+	rec->addrs_size = 0;
+	rec->text_size = 0;
+	rec->text_len = 0;
+	rec->nvalues = 0;
+}
+
+void
+rrset_stream_init(rrset_stream * rs, rrset_callback callback, void * ctx)
+{
+	memset(rs, 0, sizeof(rrset_stream));
+	rs->callback = callback;
+	rs->ctx = ctx;
+	rs->state = RRSET_START;
+}
+
+static int
+append(rrset_stream * rs, const char * data, size_t len)
+{
+	size_t size;
+	char * ptr;
+
+	if (rs->length + len + 1 > rs->size) {
+		size = rs->size ? rs->size : RRSET_BUFSIZE;
+		while (rs->length + len + 1 > size) {
+			size *= 2;
+		}
+
+		ptr = realloc(rs->buffer, size);
+		if (ptr == NULL) {
+			rs->state = RRSET_ERROR;
+			return -1;
+		}
+
+		rs->buffer = ptr;
+		rs->size = size;
+	}
+
+	memcpy(rs->buffer + rs->length, data, len);
+	rs->length += len;
+	rs->buffer[rs->length] = 0;
+
+	return 0;
+}
+
+/*
+ * Read the records of the listing's elements from the parser's events. The
+ * listing is at depth 0, the members of an rrset object at depth 2.
+ */
+static int
+stream_event(const cJSON_Event * event, void * user)
+{
+	rrset_stream * rs;
+	int decoded;
+
+	rs = (rrset_stream *)user;
+
+	if (event->depth > 1) {
+		return read_event(&rs->reader, event) == 0 ?
+			cJSON_EventContinue : cJSON_EventStop;
+	}
+	if (event->depth == 0) {
+		return cJSON_EventContinue;
+	}
+
+	switch (event->type) {
+		case cJSON_EventObjectStart:
+		case cJSON_EventArrayStart:
+			read_start(&rs->reader, &rs->record, 2);
+			return cJSON_EventContinue;
+		case cJSON_EventObjectEnd:
+		case cJSON_EventArrayEnd:
+			decoded = read_finish(&rs->reader);
+			break;
+		default:
+			decoded = RRSET_SKIPPED;	/* a scalar element */
+			break;
+	}
+
+	rs->count += 1;
+	if (decoded == RRSET_INVALID || (decoded == RRSET_DECODED &&
+		rs->callback != NULL && rs->callback(&rs->record, rs->ctx))) {
+		return cJSON_EventStop;
+	}
+
+	return cJSON_EventContinue;
+}
+
+/*
+ * Consume the next len bytes of the body. An array is handed to an event
+ * parser as it comes, anything else is kept for rrset_stream_finish().
+ * Returns -1 on malformed input or when the callback stops.
+ */
+int
+rrset_stream_feed(rrset_stream * rs, const char * data, size_t len)
+{
+	size_t i;
+	unsigned char c;
+
+	for (i = 0; rs->state == RRSET_START && i < len; i++) {
+		c = (unsigned char)data[i];
+
+		/* only a whole BOM, and only before anything else */
+		if (rs->bom < 3 && c == (unsigned char)RRSET_BOM[rs->bom]) {
+			rs->bom += 1;
+			continue;
+		}
+		if (rs->bom > 0 && rs->bom < 3) {
+			rs->state = RRSET_ERROR;
+			return -1;
+		}
+		if (is_space(c)) {
+			rs->bom = 3;
+			continue;
+		}
+
+		if (c != '[') {
+			rs->state = RRSET_OTHER;
+			break;
+		}
+
+		rs->parser = cJSON_CreateEventParser(stream_event, rs,
+			RRSET_TOKEN_SIZE);
+		if (rs->parser == NULL) {
+			rs->state = RRSET_ERROR;
+			return -1;
+		}
+		rs->state = RRSET_LIST;
+		break;
+	}
+
+	switch (rs->state) {
+		case RRSET_START:
+			return 0;
+
+		case RRSET_LIST:
+			if (cJSON_FeedEventParser(rs->parser, data + i, len - i) !=
+				len - i) {
+				rs->state = RRSET_ERROR;
+				return -1;
+			}
+			return 0;
+
+		case RRSET_OTHER:
+			return append(rs, data + i, len - i);
+
+		default:
+			return -1;
+	}
+}
+
+/* rrset_stream_feed() in the shape of a req_get_stream() writer */
+size_t
+rrset_stream_write(const char * data, size_t len, void * ctx)
+{
+	return rrset_stream_feed((rrset_stream *)ctx, data, len) == 0 ? len : 0;
+}
+
+/*
+ * Call once the whole body was fed. Returns 0 if it was a complete array or,
+ * failing that, a single JSON value which is then left in rs->other.
+ */
+int
+rrset_stream_finish(rrset_stream * rs)
+{
+	switch (rs->state) {
+		case RRSET_LIST:
+			if (cJSON_FinishEventParser(rs->parser) !=
+				cJSON_EventParserDone) {
+				rs->state = RRSET_ERROR;
+				return -1;
+			}
+			return 0;
+
+		case RRSET_OTHER:
+			rs->other = cJSON_ParseWithOpts(rs->buffer, NULL, 1);
+			rs->length = 0;
+			return rs->other != NULL ? 0 : -1;
+
+		default:
+			rs->state = RRSET_ERROR;
+			return -1;
+	}
+}
+
+void
+rrset_stream_free(rrset_stream * rs)
+{
+	free(rs->buffer);
+	cJSON_Delete(rs->other);
+	cJSON_DeleteEventParser(rs->parser);
+	rrset_record_free(&rs->record);
+
+	rs->buffer = NULL;
+	rs->other = NULL;
+	rs->parser = NULL;
+	rs->length = 0;
+	rs->size = 0;
+}
@@ -0,0 +1,119 @@
+#ifndef _RRSET_H_
+#define _RRSET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cJSON.h"
+
+#define RRSET_START 0	/* nothing but whitespace seen yet */
+#define RRSET_LIST 1	/* inside the array */
+#define RRSET_OTHER 2	/* the body is not an array */
+#define RRSET_ERROR 3
+
+#define RRSET_TYPE_OTHER 0	/* any type not listed here */
+#define RRSET_TYPE_A 1
+#define RRSET_TYPE_AAAA 2
+#define RRSET_TYPE_ALIAS 3
+#define RRSET_TYPE_CAA 4
+#define RRSET_TYPE_CNAME 5
+#define RRSET_TYPE_MX 6
+#define RRSET_TYPE_NS 7
+#define RRSET_TYPE_PTR 8
+#define RRSET_TYPE_SRV 9
+#define RRSET_TYPE_TXT 10
+
+/* rrset_decode() results */
+#define RRSET_DECODED 0
+#define RRSET_SKIPPED 1	/* valid JSON, but no rrset_type and rrset_name */
+#define RRSET_INVALID -1
+
+/* A decoded string, NUL terminated in the text of its record. */
+typedef struct {
+	const char * ptr;
+	size_t len;
+} rrset_span;
+
+/*
+ * The fields of one rrset that dldns uses. Values of A and AAAA rrsets are
+ * kept in addrs as 4 and 16 byte addresses, values that aren't addresses are
+ * dropped. The values of any other type are spans. The arrays and the text
+ * the spans point into are reused by the next rrset read into the record.
+ */
+typedef struct {
+	int type;		/* RRSET_TYPE_* */
+	rrset_span type_name;
+	rrset_span name;
+	uint32_t ttl;
+	int has_ttl;
+	size_t nvalues;
+	rrset_span * values;
+	unsigned char * addrs;
+	char * text;		/* the decoded strings */
+	size_t values_size;
+	size_t addrs_size;
+	size_t text_size;
+	size_t text_len;
+} rrset_record;
+
+/* How far into an rrset the events that build its record have come. */
+typedef struct {
+	rrset_record * rec;
+	size_t depth;		/* of the rrset's members */
+	int field;		/* the field whose value comes next */
+	int seen;		/* fields already read */
+	int values;		/* inside rrset_values */
+	size_t type_at;		/* offsets into the record's text */
+	size_t name_at;
+	size_t values_at;
+} rrset_reader;
+
+/* return non-zero to stop the iteration */
+typedef int (*rrset_callback)(const rrset_record *, void *);
+
+/*
+ * Walks a top-level JSON array such as a LiveDNS zone listing one element at
+ * a time. The body goes through a cJSON event parser as it arrives and each
+ * element is decoded into a record, which is handed to the callback once the
+ * element ends. The record is only valid during the callback.
+ */
+typedef struct {
+	rrset_callback callback;
+	void * ctx;
+	int state;
+	size_t bom;		/* bytes of a leading UTF-8 BOM seen */
+	cJSON_EventParser * parser;
+	char * buffer;		/* a non-array body */
+	size_t length;
+	size_t size;
+	size_t count;		/* elements read */
+	cJSON * other;		/* the parsed body if it was not an array */
+	rrset_reader reader;
+	rrset_record record;
+} rrset_stream;
+
+int
+rrset_type(const char *, size_t);
+
+int
+rrset_decode(const char *, size_t, rrset_record *);
+
+void
+rrset_record_free(rrset_record *);
+
+void
+rrset_stream_init(rrset_stream *, rrset_callback, void *);
+
+int
+rrset_stream_feed(rrset_stream *, const char *, size_t);
+
+size_t
+rrset_stream_write(const char *, size_t, void *);
+
+int
+rrset_stream_finish(rrset_stream *);
+
+void
+rrset_stream_free(rrset_stream *);
+
+#endif /* !_RRSET_H_ */
@@ -0,0 +1,339 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rrtab.h"
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+static uint32_t
+hash_key(const char * type, const char * name)
+{
+	uint32_t hash;
+
+	hash = FNV_OFFSET;
+
+	while (*type != '\0') {
+		hash = (hash ^ (unsigned char)*type++) * FNV_PRIME;
+	}
+	hash *= FNV_PRIME;	/* the NUL between type and name */
+	while (*name != '\0') {
+		hash = (hash ^ (unsigned char)*name++) * FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/* Width of one binary value for an RRSET_TYPE_*, 0 if values are strings. */
+static size_t
+value_width(int rrtype)
+{
+	switch (rrtype) {
+		case RRSET_TYPE_A:
+			return 4;
+		case RRSET_TYPE_AAAA:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+static rrtab_entry *
+probe(rrtab_entry * slots, size_t size, uint32_t hash, const char * type,
+	const char * name)
+{
+	size_t i;
+
+	i = hash & (size - 1);
+
+	while (slots[i].type != NULL) {
+		if (slots[i].hash == hash && strcmp(slots[i].type, type) == 0 &&
+			strcmp(slots[i].name, name) == 0) {
+			break;
+		}
+		i = (i + 1) & (size - 1);
+	}
+
+	return &slots[i];
+}
+
+static int
+grow(rrtab * tab)
+{
+	rrtab_entry * slots;
+	rrtab_entry * slot;
+	size_t size;
+	size_t i;
+
+	size = tab->size * 2;
+	slots = calloc(size, sizeof(rrtab_entry));
+	if (slots == NULL) {
+		return -1;
+	}
+
+	for (i = 0; i < tab->size; i++) {
+		if (tab->slots[i].type != NULL) {
+			slot = probe(slots, size, tab->slots[i].hash,
+				tab->slots[i].type, tab->slots[i].name);
+			*slot = tab->slots[i];
+		}
+	}
+
+	free(tab->slots);
+	tab->slots = slots;
+	tab->size = size;
+
+	return 0;
+}
+
+/* Size the table for about hint rrsets, it grows past that as needed. */
+int
+rrtab_init(rrtab * tab, size_t hint)
+{
+	size_t size;
+
+	size = RRTAB_MIN_SLOTS;
+	while (size < hint * 2) {
+		size *= 2;
+	}
+
+	tab->slots = calloc(size, sizeof(rrtab_entry));
+	tab->size = size;
+	tab->count = 0;
+	tab->strings = cJSON_CreateIntern(CJSON_INTERN_MAX_LENGTH);
+
+	if (tab->slots == NULL || tab->strings == NULL) {
+		rrtab_free(tab);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* The entry for (type, name), added if it isn't in the table yet. */
+static rrtab_entry *
+claim(rrtab * tab, const char * type, const char * name, int rrtype)
+{
+	rrtab_entry * entry;
+	uint32_t hash;
+
+	if ((tab->count + 1) * 10 > tab->size * 7 && grow(tab) != 0) {
+		return NULL;
+	}
+
+	hash = hash_key(type, name);
+	entry = probe(tab->slots, tab->size, hash, type, name);
+
+	if (entry->type == NULL) {
+		entry->name = cJSON_InternString(tab->strings, name,
+			strlen(name));
+		entry->type = cJSON_InternString(tab->strings, type,
+			strlen(type));
+		if (entry->type == NULL || entry->name == NULL) {
+			entry->type = NULL;
+			return NULL;
+		}
+
+		entry->hash = hash;
+		entry->rrtype = rrtype;
+		tab->count += 1;
+	}
+
+	return entry;
+}
+
+/*
+ * Add a decoded rrset of a LiveDNS zone listing. Values of an rrset that is
+ * already in the table are appended to it.
+ */
+int
+rrtab_add_record(rrtab * tab, const rrset_record * rec)
+{
+	rrtab_entry * entry;
+	unsigned char * ptr;
+	size_t width, length, n, i;
+
+	entry = claim(tab, rec->type_name.ptr, rec->name.ptr, rec->type);
+	if (entry == NULL) {
+		return -1;
+	}
+
+	if (rec->has_ttl) {
+		entry->ttl = rec->ttl;
+	}
+
+	/* strings are kept whole behind their length, NULs in them included */
+	width = value_width(rec->type);
+	length = rec->nvalues * width;
+	for (i = 0; !width && i < rec->nvalues; i++) {
+		length += sizeof(size_t) + rec->values[i].len + 1;
+	}
+
+	if (length == 0) {
+		return 0;
+	}
+
+	ptr = realloc(entry->values, entry->values_len + length);
+	if (ptr == NULL) {
+		return -1;
+	}
+	entry->values = ptr;
+	ptr += entry->values_len;
+
+	if (width) {
+		memcpy(ptr, rec->addrs, length);
+	}
+	for (i = 0; !width && i < rec->nvalues; i++) {
+		n = rec->values[i].len;
+		memcpy(ptr, &n, sizeof n);
+		ptr += sizeof n;
+		memcpy(ptr, rec->values[i].ptr, n + 1);
+		ptr += n + 1;
+	}
+
+	entry->values_len += length;
+	entry->nvalues += rec->nvalues;
+
+	return 0;
+}
+
+/*
+ * Make the A rrset of name hold just ipv4, which is what writing it to
+ * LiveDNS did. Returns -1 if ipv4 isn't an address or out of memory.
+ */
+int
+rrtab_set_ipv4(rrtab * tab, const char * name, const char * ipv4, long ttl)
+{
+	rrtab_entry * entry;
+	unsigned char addr[4];
+	unsigned char * values;
+
+	if (inet_pton(AF_INET, ipv4, addr) != 1) {
+		return -1;
+	}
+
+	entry = claim(tab, "A", name, RRSET_TYPE_A);
+	if (entry == NULL) {
+		return -1;
+	}
+
+	if (entry->values_len < sizeof addr) {
+		values = realloc(entry->values, sizeof addr);
+		if (values == NULL) {
+			return -1;
+		}
+		entry->values = values;
+	}
+
+	memcpy(entry->values, addr, sizeof addr);
+	entry->values_len = sizeof addr;
+	entry->nvalues = 1;
+	entry->ttl = ttl;
+
+	return 0;
+}
+
+/* rrtab_add_record() in the shape of an rrset_stream record callback */
+int
+rrtab_collect_record(const rrset_record * rec, void * ctx)
+{
+	return rrtab_add_record((rrtab *)ctx, rec) != 0;
+}
+
+const rrtab_entry *
+rrtab_find(const rrtab * tab, const char * type, const char * name)
+{
+	const rrtab_entry * entry;
+
+	entry = probe(tab->slots, tab->size, hash_key(type, name), type, name);
+
+	return entry->type != NULL ? entry : NULL;
+}
+
+/* Does the A rrset entry hold the dotted quad ipv4? */
+int
+rrtab_has_ipv4(const rrtab_entry * entry, const char * ipv4)
+{
+	unsigned char addr[4];
+	size_t i;
+
+	if (entry->rrtype != RRSET_TYPE_A ||
+		inet_pton(AF_INET, ipv4, addr) != 1) {
+		return 0;
+	}
+
+	for (i = 0; i < entry->nvalues; i++) {
+		if (memcmp(entry->values + i * 4, addr, 4) == 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Return value i of entry in its text form. Addresses are formatted into
+ * buf, strings are returned in place and may hold NULs. Its length goes to
+ * value_len unless that is NULL. NULL if i is out of range.
+ */
+const char *
+rrtab_value(const rrtab_entry * entry, size_t i, char * buf, size_t len,
+	size_t * value_len)
+{
+	const unsigned char * value;
+	const char * text;
+	size_t width, n;
+
+	if (i >= entry->nvalues) {
+		return NULL;
+	}
+
+	width = value_width(entry->rrtype);
+	if (width) {
+		text = inet_ntop(width == 4 ? AF_INET : AF_INET6,
+			entry->values + i * width, buf, (socklen_t)len);
+		if (text != NULL && value_len != NULL) {
+			*value_len = strlen(text);
+		}
+		return text;
+	}
+
+	value = entry->values;
+	for (;;) {
+		memcpy(&n, value, sizeof n);
+		value += sizeof n;
+		if (i-- == 0) {
+			break;
+		}
+		value += n + 1;
+	}
+
+	if (value_len != NULL) {
+		*value_len = n;
+	}
+
+	return (const char *)value;
+}
+
+void
+rrtab_free(rrtab * tab)
+{
+	size_t i;
+
+	for (i = 0; i < tab->size && tab->slots != NULL; i++) {
+		free(tab->slots[i].values);
+	}
+	free(tab->slots);
+	cJSON_DeleteIntern(tab->strings);
+
+	tab->slots = NULL;
+	tab->strings = NULL;
+	tab->size = 0;
+	tab->count = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef _RRTAB_H_
+#define _RRTAB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cJSON.h"
+#include "rrset.h"
+
+#define RRTAB_MIN_SLOTS 64
+
+/*
+ * One rrset of a zone. A and AAAA values are kept as raw 4 and 16 byte
+ * addresses, anything else as consecutive NUL terminated strings, each
+ * behind its length as a size_t.
+ */
+typedef struct {
+	uint32_t hash;
+	const char * type;	/* NULL for an empty slot */
+	const char * name;
+	int rrtype;		/* RRSET_TYPE_* of type */
+	long ttl;
+	size_t nvalues;
+	unsigned char * values;
+	size_t values_len;
+} rrtab_entry;
+
+/*
+ * Open addressing table of a zone's rrsets keyed by (type, name). Types and
+ * names are interned, the names of a zone's rrsets repeat across types.
+ */
+typedef struct {
+	rrtab_entry * slots;
+	size_t size;		/* always a power of two */
+	size_t count;
+	cJSON_Intern * strings;	/* types and names of the entries */
+} rrtab;
+
+int
+rrtab_init(rrtab *, size_t);
+
+int
+rrtab_add_record(rrtab *, const rrset_record *);
+
+int
+rrtab_set_ipv4(rrtab *, const char *, const char *, long);
+
+int
+rrtab_collect_record(const rrset_record *, void *);
+
+const rrtab_entry *
+rrtab_find(const rrtab *, const char *, const char *);
+
+int
+rrtab_has_ipv4(const rrtab_entry *, const char *);
+
+const char *
+rrtab_value(const rrtab_entry *, size_t, char *, size_t, size_t *);
+
+void
+rrtab_free(rrtab *);
+
+#endif /* !_RRTAB_H_ */
@@ -1,6 +1,25 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
 #include <atf-c.h>
 
+#include "../damp.h"
+#include "../dns.h"
+#include "../ratelimit.h"
 #include "../req.h"
+#include "../rrset.h"
+#include "../rrtab.h"
 
 ATF_TC(GET);
 ATF_TC_HEAD(GET, tc)
@@ -20,8 +39,2167 @@ ATF_TC_BODY(GET, tc)
 	cJSON_free(root);
 }
 
+ATF_TC(damping);
+ATF_TC_HEAD(damping, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test flap damping of address changes");
+}
+ATF_TC_BODY(damping, tc)
+{
+	damp_options options;
+	damp_record rec, copy;
+	damp_table table;
+
+	memset(&rec, 0, sizeof rec);
+	options.observations = 3;
+	options.hold = 600;
+	options.max_writes = 1;
+	options.window = 3600;
+
+	ATF_CHECK_EQ(damp_check(&rec, &options, "192.0.2.1", 1000), DAMP_HOLD);
+	ATF_CHECK_EQ(damp_check(&rec, &options, "192.0.2.2", 1010), DAMP_HOLD);
+	ATF_CHECK_EQ(damp_check(&rec, &options, "192.0.2.2", 1020), DAMP_HOLD);
+	ATF_CHECK_EQ(damp_check(&rec, &options, "192.0.2.2", 1030), DAMP_ALLOW);
+	damp_wrote(&rec, &options, 1030);
+
+	/* held long enough, but the window already has its one write */
+	ATF_CHECK_EQ(damp_check(&rec, &options, "192.0.2.3", 1100), DAMP_HOLD);
+	ATF_CHECK_EQ(damp_check(&rec, &options, "192.0.2.3", 1700), DAMP_CAPPED);
+	ATF_CHECK_EQ(damp_check(&rec, &options, "192.0.2.3", 4700), DAMP_ALLOW);
+	damp_wrote(&rec, &options, 4700);
+
+	/* a forced address isn't checked, but its write is still counted */
+	damp_wrote(&rec, &options, 4800);
+	ATF_CHECK_EQ(rec.writes, 2);
+
+	ATF_CHECK_EQ(rec.suppressed, 5);
+
+	/* the state of every record is read once and written once */
+	unlink("damp.json");
+	ATF_CHECK_EQ(damp_open(&table, "damp.json"), 0);
+	damp_get(&table, "www.example.com", &copy);
+	ATF_CHECK_EQ(copy.writes, 0);
+	ATF_CHECK_EQ(damp_put(&table, "www.example.com", &rec), 0);
+	ATF_CHECK_EQ(damp_put(&table, "@.example.com", &rec), 0);
+	ATF_CHECK_EQ(damp_close(&table, "damp.json"), 0);
+
+	ATF_CHECK_EQ(damp_open(&table, "damp.json"), 0);
+	damp_get(&table, "www.example.com", &copy);
+	ATF_CHECK_EQ(copy.writes, rec.writes);
+	ATF_CHECK_EQ(copy.window_start, rec.window_start);
+	ATF_CHECK_EQ(copy.suppressed, rec.suppressed);
+
+	/* putting back what is there already doesn't rewrite the file */
+	ATF_CHECK_EQ(damp_put(&table, "www.example.com", &copy), 0);
+	ATF_CHECK(!table.changed);
+	copy.suppressed++;
+	ATF_CHECK_EQ(damp_put(&table, "www.example.com", &copy), 0);
+	ATF_CHECK(table.changed);
+	ATF_CHECK_EQ(damp_close(&table, NULL), 0);
+
+	/* an unreadable file starts fresh */
+	ATF_REQUIRE(truncate("damp.json", 3) == 0);
+	ATF_CHECK_EQ(damp_open(&table, "damp.json"), -1);
+	damp_get(&table, "www.example.com", &copy);
+	ATF_CHECK_EQ(copy.writes, 0);
+	ATF_CHECK_EQ(damp_close(&table, NULL), 0);
+	unlink("damp.json");
+}
+
+ATF_TC(ratelimit);
+ATF_TC_HEAD(ratelimit, tc)
+{
+	atf_tc_set_md_var(tc, "descr", "Test the LiveDNS token bucket");
+}
+ATF_TC_BODY(ratelimit, tc)
+{
+	ratelimit rl;
+
+	ratelimit_init(&rl, 2, 2);
+
+	/* the burst goes out at once, then one request every half second */
+	ATF_CHECK(ratelimit_reserve(&rl, 10.0) == 0);
+	ATF_CHECK(ratelimit_reserve(&rl, 10.0) == 0);
+	ATF_CHECK(ratelimit_reserve(&rl, 10.0) == 0.5);
+	ATF_CHECK(ratelimit_reserve(&rl, 10.0) == 1.0);
+	ATF_CHECK(ratelimit_reserve(&rl, 20.0) == 0);
+
+	/* a 429 halves the rate and honours Retry-After */
+	ratelimit_observe(&rl, 429, -1, 0, 3, 20.0);
+	ATF_CHECK(rl.current == 1);
+	ATF_CHECK(ratelimit_reserve(&rl, 20.0) == 3);
+
+	/* an exhausted quota blocks until it resets */
+	ratelimit_observe(&rl, 200, 0, 30, 0, 40.0);
+	ATF_CHECK(ratelimit_reserve(&rl, 40.0) == 30);
+}
+
+#define STUB_EXACT	0
+#define STUB_TWO_ADDRS	1	/* 192.0.2.11 next to it */
+#define STUB_OTHER_TYPE	2	/* the question comes back as NS */
+#define STUB_OTHER_NAME	3	/* the question comes back for another name */
+
+/* Answer each query on sock with an authoritative A record of 192.0.2.10. */
+static void
+stub_authoritative(int sock, int queries, int variant)
+{
+	unsigned char packet[512];
+	struct sockaddr_in peer;
+	socklen_t peer_len;
+	ssize_t len;
+	size_t size;
+	static const unsigned char answer[] = {
+		0xc0, 0x0c,		/* pointer to the question name */
+		0x00, 0x01, 0x00, 0x01,	/* A, IN */
+		0x00, 0x00, 0x01, 0x2c,	/* ttl 300 */
+		0x00, 0x04, 192, 0, 2, 10
+	};
+
+	while (queries-- > 0) {
+		peer_len = sizeof peer;
+		len = recvfrom(sock, packet, sizeof packet - 2 * sizeof answer,
+			0, (struct sockaddr *)&peer, &peer_len);
+		if (len < 17) {
+			_exit(EXIT_FAILURE);
+		}
+		packet[2] = 0x84;	/* response, authoritative */
+		packet[3] = 0;
+		packet[7] = 1;		/* one answer */
+		size = (size_t)len;
+		memcpy(packet + size, answer, sizeof answer);
+		size += sizeof answer;
+
+		switch (variant) {
+		case STUB_TWO_ADDRS:
+			packet[7] = 2;
+			memcpy(packet + size, answer, sizeof answer);
+			size += sizeof answer;
+			packet[size - 1] = 11;
+			break;
+		case STUB_OTHER_TYPE:
+			packet[len - 3] = 2;
+			break;
+		case STUB_OTHER_NAME:
+			packet[13] ^= 1;
+			break;
+		}
+
+		sendto(sock, packet, size, 0, (struct sockaddr *)&peer,
+			peer_len);
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+ATF_TC(dns_verify);
+ATF_TC_HEAD(dns_verify, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test A record verification against a stub authoritative server");
+}
+ATF_TC_BODY(dns_verify, tc)
+{
+	static const struct {
+		int variant;
+		const char * ipv4;
+		int verdict;
+	} cases[] = {
+		{ STUB_EXACT, "192.0.2.10", DNS_MATCH },
+		{ STUB_EXACT, "192.0.2.11", DNS_MISMATCH },
+		/* ours is there, but so is another address */
+		{ STUB_TWO_ADDRS, "192.0.2.10", DNS_MISMATCH },
+		/* answers to another question are ignored until the timeout */
+		{ STUB_OTHER_TYPE, "192.0.2.10", DNS_INCONCLUSIVE },
+		{ STUB_OTHER_NAME, "192.0.2.10", DNS_INCONCLUSIVE }
+	};
+	struct sockaddr_in addr;
+	socklen_t addr_len;
+	char server[32];
+	pid_t pid;
+	size_t i;
+	int sock;
+	int status;
+
+	for (i = 0; i < sizeof cases / sizeof cases[0]; i++) {
+		sock = socket(AF_INET, SOCK_DGRAM, 0);
+		ATF_REQUIRE(sock >= 0);
+
+		memset(&addr, 0, sizeof addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr_len = sizeof addr;
+
+		ATF_REQUIRE(bind(sock, (struct sockaddr *)&addr,
+			sizeof addr) == 0);
+		ATF_REQUIRE(getsockname(sock, (struct sockaddr *)&addr,
+			&addr_len) == 0);
+
+		pid = fork();
+		ATF_REQUIRE(pid >= 0);
+		if (pid == 0) {
+			stub_authoritative(sock, 1, cases[i].variant);
+		}
+		close(sock);
+
+		snprintf(server, sizeof server, "127.0.0.1:%d",
+			ntohs(addr.sin_port));
+
+		ATF_CHECK_EQ(dns_verify_a("example.com", "www.example.com",
+			server, cases[i].ipv4), cases[i].verdict);
+
+		ATF_CHECK(waitpid(pid, &status, 0) == pid);
+		ATF_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+}
+
+/* Answer one request per connection on the listening sock with each of responses in turn. */
+static void
+stub_http(int sock, const char * const * responses)
+{
+	char request[4096];
+	const char * body;
+	size_t got, want;
+	ssize_t len;
+	int conn;
+
+	for (; *responses != NULL; responses++) {
+		conn = accept(sock, NULL, NULL);
+		if (conn < 0) {
+			_exit(EXIT_FAILURE);
+		}
+
+		/* read the whole request, the headers and a body of Content-Length */
+		got = 0;
+		want = sizeof request - 1;
+		while (got < want) {
+			len = read(conn, request + got, sizeof request - 1 - got);
+			if (len <= 0) {
+				_exit(EXIT_FAILURE);
+			}
+			got += (size_t)len;
+			request[got] = '\0';
+			body = strstr(request, "\r\n\r\n");
+			if (body != NULL) {
+				want = (size_t)(body + 4 - request);
+				body = strstr(request, "Content-Length:");
+				if (body != NULL) {
+					want += strtoul(body + 15, NULL, 10);
+				}
+			}
+		}
+
+		write(conn, *responses, strlen(*responses));
+		close(conn);
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+/* Fork a stub_http on a loopback port, url gets its address. */
+static pid_t
+fork_stub_http(const char * const * responses, char * url, size_t size)
+{
+	struct sockaddr_in addr;
+	socklen_t addr_len;
+	pid_t pid;
+	int sock;
+
+	sock = socket(AF_INET, SOCK_STREAM, 0);
+	ATF_REQUIRE(sock >= 0);
+
+	memset(&addr, 0, sizeof addr);
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr_len = sizeof addr;
+
+	ATF_REQUIRE(bind(sock, (struct sockaddr *)&addr, sizeof addr) == 0);
+	ATF_REQUIRE(listen(sock, 8) == 0);
+	ATF_REQUIRE(getsockname(sock, (struct sockaddr *)&addr, &addr_len) == 0);
+
+	pid = fork();
+	ATF_REQUIRE(pid >= 0);
+	if (pid == 0) {
+		stub_http(sock, responses);
+	}
+	close(sock);
+
+	snprintf(url, size, "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+
+	return pid;
+}
+
+#define HTTP_429 "HTTP/1.1 429 Too Many Requests\r\nConnection: close\r\n" \
+	"Retry-After: 0.01\r\n" \
+	"Content-Length: 13\r\n\r\n{\"code\": 429}"
+#define HTTP_200 "HTTP/1.1 200 OK\r\nConnection: close\r\n" \
+	"Content-Length: 2\r\n\r\n[]"
+#define HTTP_201 "HTTP/1.1 201 Created\r\nConnection: close\r\n" \
+	"Content-Length: 33\r\n\r\n{\"message\": \"DNS Record Created\"}"
+#define HTTP_400 "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n" \
+	"Content-Length: 22\r\n\r\n{\"message\": \"invalid\"}"
+#define HTTP_ZONE "HTTP/1.1 200 OK\r\nConnection: close\r\n" \
+	"Content-Length: 73\r\n\r\n" \
+	"[{\"rrset_type\": \"A\", \"rrset_name\": \"www\", \"rrset_values\": [\"192.0.2.9\"]}]"
+
+struct collected {
+	char body[256];
+	size_t length;
+};
+
+static size_t
+collect_body(const char * piece, size_t length, void * ctx)
+{
+	struct collected * collected = ctx;
+
+	if (length > sizeof collected->body - 1 - collected->length) {
+		return 0;
+	}
+	memcpy(collected->body + collected->length, piece, length);
+	collected->length += length;
+	collected->body[collected->length] = '\0';
+
+	return length;
+}
+
+ATF_TC(stream_429);
+ATF_TC_HEAD(stream_429, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that a streamed 429 body is only dropped when it is retried");
+}
+ATF_TC_BODY(stream_429, tc)
+{
+	static const char * const retried[] = { HTTP_429, HTTP_200, NULL };
+	static const char * const unlimited[] = { HTTP_429, NULL };
+	static const char * const exhausted[] = { HTTP_429, HTTP_429, HTTP_429,
+		HTTP_429, HTTP_429, NULL };
+	struct collected collected;
+	req_options options;
+	ratelimit rl;
+	char url[64];
+	long status;
+	pid_t pid;
+	int exited;
+
+	memset(&options, 0, sizeof options);
+	options.ratelimit = &rl;
+
+	/* retried, only the answer to the second attempt is passed on */
+	ratelimit_init(&rl, 1000, 10);
+	memset(&collected, 0, sizeof collected);
+	pid = fork_stub_http(retried, url, sizeof url);
+	ATF_CHECK_EQ(req_get_stream(url, &options, &status, collect_body,
+		&collected), 0);
+	ATF_CHECK_EQ(status, 200);
+	ATF_CHECK_STREQ(collected.body, "[]");
+	ATF_CHECK(waitpid(pid, &exited, 0) == pid);
+
+	/* nothing retries without a limiter, the caller gets the body */
+	memset(&collected, 0, sizeof collected);
+	pid = fork_stub_http(unlimited, url, sizeof url);
+	ATF_CHECK_EQ(req_get_stream(url, NULL, &status, collect_body,
+		&collected), 0);
+	ATF_CHECK_EQ(status, 429);
+	ATF_CHECK_STREQ(collected.body, "{\"code\": 429}");
+	ATF_CHECK(waitpid(pid, &exited, 0) == pid);
+
+	/* the last attempt isn't retried either */
+	ratelimit_init(&rl, 1000, 10);
+	memset(&collected, 0, sizeof collected);
+	pid = fork_stub_http(exhausted, url, sizeof url);
+	ATF_CHECK_EQ(req_get_stream(url, &options, &status, collect_body,
+		&collected), 0);
+	ATF_CHECK_EQ(status, 429);
+	ATF_CHECK_STREQ(collected.body, "{\"code\": 429}");
+	ATF_CHECK(waitpid(pid, &exited, 0) == pid);
+	ATF_CHECK(WIFEXITED(exited) && WEXITSTATUS(exited) == 0);
+}
+
+static int
+count_a_rrsets(const rrset_record * rec, void * ctx)
+{
+	if (rec->type == RRSET_TYPE_A) {
+		*(int *)ctx += 1;
+	}
+
+	return 0;
+}
+
+/* Run dldns against the LiveDNS stub at url, returns its exit status. */
+static int
+run_dldns(const char * dldns, const char * url, char * const * argv)
+{
+	char api_url[64];
+	pid_t pid;
+	int status;
+	int null;
+
+	/* the API URL is used without a trailing slash */
+	snprintf(api_url, sizeof api_url, "%.*s", (int)strlen(url) - 1, url);
+
+	pid = fork();
+	ATF_REQUIRE(pid >= 0);
+	if (pid == 0) {
+		null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		dup2(null, STDERR_FILENO);
+		setenv("GANDI_DNS_API_KEY", "test", 1);
+		setenv("GANDI_DNS_API_URL", api_url, 1);
+		execv(dldns, argv);
+		_exit(127);
+	}
+
+	ATF_REQUIRE(waitpid(pid, &status, 0) == pid);
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+ATF_TC(livedns_write);
+ATF_TC_HEAD(livedns_write, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that rejected writes fail the run and a batch writes a name once");
+}
+ATF_TC_BODY(livedns_write, tc)
+{
+	static const char * const rejected_post[] = { HTTP_200, HTTP_400, NULL };
+	static const char * const rejected_put[] = { HTTP_ZONE, HTTP_400, NULL };
+	static const char * const created_once[] = { HTTP_200, HTTP_201, NULL };
+	static char * single[] = { "dldns", "-f", "192.0.2.1", "-d",
+		"example.com", "-s", "www", NULL };
+	static char * batch[] = { "dldns", "-f", "192.0.2.1", "-d",
+		"example.com", "-B", "targets.ndjson", NULL };
+	const struct {
+		const char * const * responses;
+		char * const * argv;
+		int exit_status;
+	} cases[] = {
+		{ rejected_post, single, EXIT_FAILURE },
+		{ rejected_put, single, EXIT_FAILURE },
+		/* a second POST would find the stub gone and fail */
+		{ created_once, batch, EXIT_SUCCESS },
+	};
+	const char * dldns;
+	FILE * targets;
+	char url[64];
+	size_t i;
+	pid_t pid;
+	int exited;
+
+	dldns = getenv("DLDNS");
+	if (dldns == NULL) {
+		dldns = "../dldns";
+	}
+	if (access(dldns, X_OK) != 0) {
+		atf_tc_skip("dldns is not built at %s, set DLDNS", dldns);
+	}
+
+	targets = fopen("targets.ndjson", "w");
+	ATF_REQUIRE(targets != NULL);
+	fputs("{\"subdomain\": \"www\"}\n{\"subdomain\": \"www\"}\n", targets);
+	ATF_REQUIRE(fclose(targets) == 0);
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		pid = fork_stub_http(cases[i].responses, url, sizeof url);
+		ATF_CHECK_EQ(run_dldns(dldns, url, cases[i].argv),
+			cases[i].exit_status);
+		ATF_CHECK(waitpid(pid, &exited, 0) == pid);
+		ATF_CHECK(WIFEXITED(exited) && WEXITSTATUS(exited) == 0);
+	}
+
+	unlink("targets.ndjson");
+}
+
+ATF_TC(rrset_stream);
+ATF_TC_HEAD(rrset_stream, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test walking a zone listing fed in small pieces");
+}
+ATF_TC_BODY(rrset_stream, tc)
+{
+	const char * listing = "[ {\"rrset_type\": \"A\", "
+		"\"rrset_name\": \"www\", \"rrset_values\": [\"192.0.2.1\"]},"
+		"{\"rrset_type\": \"TXT\", \"rrset_name\": \"@\", "
+		"\"rrset_values\": [\"\\\"v=spf1 ]} -all\\\"\"]},\n"
+		"{\"rrset_type\": \"A\", \"rrset_name\": \"@\", "
+		"\"rrset_values\": [\"192.0.2.2\"]} ]\n";
+	const char * error = "{\"code\": 401, \"message\": \"Unauthorized\"}";
+	rrset_stream rs;
+	size_t i, len;
+	int found;
+
+	found = 0;
+	rrset_stream_init(&rs, count_a_rrsets, &found);
+	len = strlen(listing);
+	for (i = 0; i < len; i += 3) {
+		ATF_REQUIRE(rrset_stream_feed(&rs, listing + i,
+			len - i < 3 ? len - i : 3) == 0);
+	}
+	ATF_CHECK_EQ(rrset_stream_finish(&rs), 0);
+	ATF_CHECK_EQ(rs.count, 3);
+	ATF_CHECK_EQ(found, 2);
+	ATF_CHECK(rs.other == NULL);
+	rrset_stream_free(&rs);
+
+	rrset_stream_init(&rs, NULL, NULL);
+	ATF_REQUIRE(rrset_stream_feed(&rs, error, strlen(error)) == 0);
+	ATF_CHECK_EQ(rrset_stream_finish(&rs), 0);
+	ATF_CHECK_STREQ(cJSON_GetStringValue(
+		cJSON_GetObjectItem(rs.other, "message")), "Unauthorized");
+	rrset_stream_free(&rs);
+
+	rrset_stream_init(&rs, NULL, NULL);
+	ATF_CHECK_EQ(rrset_stream_feed(&rs, "[1,,2]", 6), -1);
+	rrset_stream_free(&rs);
+
+	rrset_stream_init(&rs, NULL, NULL);
+	ATF_CHECK_EQ(rrset_stream_feed(&rs, "[{\"a\": 1}", 9), 0);
+	ATF_CHECK_EQ(rrset_stream_finish(&rs), -1);
+	rrset_stream_free(&rs);
+
+	/* a byte order mark is only skipped whole and in front */
+	rrset_stream_init(&rs, NULL, NULL);
+	ATF_CHECK_EQ(rrset_stream_feed(&rs, "\xef\xbb", 2), 0);
+	ATF_CHECK_EQ(rrset_stream_feed(&rs, "\xbf [1]", 5), 0);
+	ATF_CHECK_EQ(rrset_stream_finish(&rs), 0);
+	ATF_CHECK_EQ(rs.count, 1);
+	rrset_stream_free(&rs);
+
+	rrset_stream_init(&rs, NULL, NULL);
+	ATF_CHECK_EQ(rrset_stream_feed(&rs, "\xbb\xef\xbf[1]", 6), 0);
+	ATF_CHECK_EQ(rrset_stream_finish(&rs), -1);
+	rrset_stream_free(&rs);
+
+	rrset_stream_init(&rs, NULL, NULL);
+	ATF_CHECK_EQ(rrset_stream_feed(&rs, "\xef [1]", 5), -1);
+	rrset_stream_free(&rs);
+}
+
+ATF_TC(rrtab);
+ATF_TC_HEAD(rrtab, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test looking up rrsets of a large zone by type and name");
+}
+ATF_TC_BODY(rrtab, tc)
+{
+	const rrtab_entry * entry;
+	rrset_record rec;
+	rrtab zone;
+	char json[128];
+	char buffer[64];
+	int i;
+
+	ATF_REQUIRE(rrtab_init(&zone, 0) == 0);
+	memset(&rec, 0, sizeof(rec));
+
+	for (i = 0; i < 10000; i++) {
+		snprintf(json, sizeof json, "{\"rrset_type\": \"%s\", "
+			"\"rrset_name\": \"host%d\", \"rrset_ttl\": 300, "
+			"\"rrset_values\": [\"10.0.%d.%d\"]}", i % 10 ? "A" : "TXT",
+			i, i / 256, i % 256);
+		ATF_REQUIRE_EQ(rrset_decode(json, strlen(json), &rec),
+			RRSET_DECODED);
+		ATF_REQUIRE(rrtab_add_record(&zone, &rec) == 0);
+	}
+
+	/* a name is kept once however many types it has */
+	snprintf(json, sizeof json, "{\"rrset_type\": \"TXT\", "
+		"\"rrset_name\": \"host4321\", \"rrset_values\": [\"x\"]}");
+	ATF_REQUIRE_EQ(rrset_decode(json, strlen(json), &rec), RRSET_DECODED);
+	ATF_REQUIRE(rrtab_add_record(&zone, &rec) == 0);
+	rrset_record_free(&rec);
+	ATF_CHECK(rrtab_find(&zone, "TXT", "host4321")->name ==
+		rrtab_find(&zone, "A", "host4321")->name);
+
+	ATF_CHECK_EQ(zone.count, 10001);
+	ATF_CHECK(zone.size >= zone.count);
+
+	entry = rrtab_find(&zone, "A", "host4321");
+	ATF_REQUIRE(entry != NULL);
+	ATF_CHECK_EQ(entry->ttl, 300);
+	ATF_CHECK_EQ(entry->nvalues, 1);
+	ATF_CHECK(rrtab_has_ipv4(entry, "10.0.16.225"));
+	ATF_CHECK(!rrtab_has_ipv4(entry, "10.0.16.226"));
+	ATF_CHECK_STREQ(rrtab_value(entry, 0, buffer, sizeof buffer, NULL),
+		"10.0.16.225");
+
+	ATF_REQUIRE(rrtab_set_ipv4(&zone, "host4321", "192.0.2.1", 600) == 0);
+	entry = rrtab_find(&zone, "A", "host4321");
+	ATF_REQUIRE(entry != NULL);
+	ATF_CHECK_EQ(entry->nvalues, 1);
+	ATF_CHECK_EQ(entry->ttl, 600);
+	ATF_CHECK(rrtab_has_ipv4(entry, "192.0.2.1"));
+	ATF_CHECK(!rrtab_has_ipv4(entry, "10.0.16.225"));
+	ATF_CHECK(rrtab_set_ipv4(&zone, "host4321", "junk", 600) != 0);
+
+	ATF_CHECK(rrtab_find(&zone, "A", "host4320") == NULL);
+	entry = rrtab_find(&zone, "TXT", "host4320");
+	ATF_REQUIRE(entry != NULL);
+	ATF_CHECK_STREQ(rrtab_value(entry, 0, buffer, sizeof buffer, NULL),
+		"10.0.16.224");
+	ATF_CHECK(rrtab_value(entry, 1, buffer, sizeof buffer, NULL) == NULL);
+	ATF_CHECK(rrtab_find(&zone, "A", "host10000") == NULL);
+
+	rrtab_free(&zone);
+}
+
+ATF_TC(rrset_decode);
+ATF_TC_HEAD(rrset_decode, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test decoding rrsets of a listing without cJSON items");
+}
+ATF_TC_BODY(rrset_decode, tc)
+{
+	const char * listing = "[{\"rrset_type\": \"A\", \"rrset_ttl\": 300, "
+		"\"rrset_href\": {\"a\": [1, true, null, \"]\"]}, "
+		"\"rrset_name\": \"www\", \"rrset_values\": [\"192.0.2.1\", 5, "
+		"\"junk\", \"192.0.2.2\"]}, 42, {\"rrset_name\": \"x\"},"
+		"{\"rrset_values\": [\"\\\"v=spf1 -all\\\"\", \"caf\\u00e9\"], "
+		"\"rrset_name\": \"@\", \"rrset_type\": \"TXT\"}]";
+	const char * bad[] = { "{\"rrset_type\": \"A\"", "{\"a\": tru}",
+		"{\"a\": \"\\ud800\"}", "{\"a\" 1}", "[1,]", "{} 1" };
+	const rrtab_entry * entry;
+	rrset_record rec;
+	rrset_stream rs;
+	rrtab zone;
+	char json[128];
+	char buffer[64];
+	size_t i, len;
+
+	memset(&rec, 0, sizeof(rec));
+	snprintf(json, sizeof json, "{\"rrset_name\": \"v6\", "
+		"\"rrset_name\": 1, \"rrset_ttl\": -1, \"rrset_type\": \"AAAA\", "
+		"\"rrset_values\": [\"2001:db8::1\"]}");
+	ATF_REQUIRE_EQ(rrset_decode(json, strlen(json), &rec), RRSET_DECODED);
+	ATF_CHECK_EQ(rec.type, RRSET_TYPE_AAAA);
+	ATF_CHECK_STREQ(rec.name.ptr, "v6");
+	ATF_CHECK_EQ(rec.name.len, 2);
+	ATF_CHECK(!rec.has_ttl);
+	ATF_CHECK_EQ(rec.nvalues, 1);
+	ATF_CHECK_EQ(rec.addrs[15], 1);
+
+	snprintf(json, sizeof json, "{\"rrset_type\": \"SSHFP\"}");
+	ATF_CHECK_EQ(rrset_decode(json, strlen(json), &rec), RRSET_SKIPPED);
+	ATF_CHECK_EQ(rrset_type("SSHFP", 5), RRSET_TYPE_OTHER);
+
+	for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+		snprintf(json, sizeof json, "%s", bad[i]);
+		ATF_CHECK_EQ(rrset_decode(json, strlen(json), &rec),
+			RRSET_INVALID);
+	}
+	rrset_record_free(&rec);
+
+	ATF_REQUIRE(rrtab_init(&zone, 0) == 0);
+	rrset_stream_init(&rs, rrtab_collect_record, &zone);
+	len = strlen(listing);
+	for (i = 0; i < len; i += 5) {
+		ATF_REQUIRE(rrset_stream_feed(&rs, listing + i,
+			len - i < 5 ? len - i : 5) == 0);
+	}
+	ATF_CHECK_EQ(rrset_stream_finish(&rs), 0);
+	ATF_CHECK_EQ(rs.count, 4);
+	rrset_stream_free(&rs);
+
+	ATF_CHECK_EQ(zone.count, 2);
+	entry = rrtab_find(&zone, "A", "www");
+	ATF_REQUIRE(entry != NULL);
+	ATF_CHECK_EQ(entry->ttl, 300);
+	ATF_CHECK_EQ(entry->nvalues, 2);
+	ATF_CHECK(rrtab_has_ipv4(entry, "192.0.2.2"));
+
+	entry = rrtab_find(&zone, "TXT", "@");
+	ATF_REQUIRE(entry != NULL);
+	ATF_CHECK_STREQ(rrtab_value(entry, 0, buffer, sizeof buffer, NULL),
+		"\"v=spf1 -all\"");
+	ATF_CHECK_STREQ(rrtab_value(entry, 1, buffer, sizeof buffer, NULL),
+		"caf\xc3\xa9");
+
+	/* a NUL inside a value is kept with the rest of it */
+	snprintf(json, sizeof json, "{\"rrset_type\": \"TXT\", "
+		"\"rrset_name\": \"nul\", "
+		"\"rrset_values\": [\"a\\u0000b\", \"c\"]}");
+	ATF_REQUIRE_EQ(rrset_decode(json, strlen(json), &rec), RRSET_DECODED);
+	ATF_REQUIRE(rrtab_add_record(&zone, &rec) == 0);
+	rrset_record_free(&rec);
+	entry = rrtab_find(&zone, "TXT", "nul");
+	ATF_REQUIRE(entry != NULL);
+	ATF_REQUIRE(rrtab_value(entry, 0, buffer, sizeof buffer, &len) != NULL);
+	ATF_CHECK_EQ(len, 3);
+	ATF_CHECK(memcmp(rrtab_value(entry, 0, buffer, sizeof buffer, NULL),
+		"a\0b", 4) == 0);
+	ATF_CHECK_STREQ(rrtab_value(entry, 1, buffer, sizeof buffer, &len),
+		"c");
+	ATF_CHECK_EQ(len, 1);
+
+	rrtab_free(&zone);
+
+	rrset_stream_init(&rs, rrtab_collect_record, &zone);
+	ATF_CHECK_EQ(rrset_stream_feed(&rs, "[{\"a\": [}]", 10), -1);
+	rrset_stream_free(&rs);
+}
+
+ATF_TC(arena);
+ATF_TC_HEAD(arena, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test parsing whole documents into a cJSON arena");
+}
+ATF_TC_BODY(arena, tc)
+{
+	const char * json = "{\"rrset_name\": \"www\", \"rrset_ttl\": 300, "
+		"\"rrset_values\": [\"192.0.2.1\", \"192.0.2.2\"]}";
+	cJSON_Arena * arena;
+	cJSON * root, * copy, * values;
+	char * printed;
+	int i;
+
+	arena = cJSON_CreateArena(256);
+	ATF_REQUIRE(arena != NULL);
+
+	for (i = 0; i < 100; i++) {
+		root = cJSON_ParseInArena(json, arena);
+		ATF_REQUIRE(root != NULL);
+	}
+
+	ATF_CHECK(root->type & cJSON_InArena);
+	ATF_CHECK(cJSON_IsObject(root));
+	ATF_CHECK_STREQ(cJSON_GetStringValue(
+		cJSON_GetObjectItem(root, "rrset_name")), "www");
+	values = cJSON_GetObjectItem(root, "rrset_values");
+	ATF_CHECK_EQ(cJSON_GetArraySize(values), 2);
+	ATF_CHECK_STREQ(cJSON_GetArrayItem(values, 1)->valuestring,
+		"192.0.2.2");
+
+	/* heap items can be mixed in, cJSON_Delete only frees those */
+	cJSON_AddStringToObject(values, "ignored", "192.0.2.3");
+	cJSON_AddItemToObject(root, "renamed", cJSON_DetachItemFromObject(root,
+		"rrset_ttl"));
+	copy = cJSON_Duplicate(root, 1);
+	ATF_REQUIRE(copy != NULL);
+	ATF_CHECK(!(copy->type & cJSON_InArena));
+	cJSON_Delete(root);
+
+	ATF_CHECK(cJSON_ParseInArena("{\"a\": [1, 2", arena) == NULL);
+	ATF_CHECK(cJSON_ParseInArena("[\"unterminated", arena) == NULL);
+
+	cJSON_ResetArena(arena);
+	ATF_REQUIRE(cJSON_ParseInArena(json, arena) != NULL);
+	cJSON_DeleteArena(arena);
+
+	/* the duplicate outlives the arena */
+	printed = cJSON_PrintUnformatted(copy);
+	ATF_CHECK_STREQ(printed, "{\"rrset_name\":\"www\",\"rrset_values\":"
+		"[\"192.0.2.1\",\"192.0.2.2\",\"192.0.2.3\"],\"renamed\":300}");
+	cJSON_free(printed);
+	cJSON_Delete(copy);
+}
+
+static size_t context_allocs;
+
+static void *
+context_malloc(size_t size)
+{
+	context_allocs += 1;
+	return malloc(size);
+}
+
+static void
+context_free(void * ptr)
+{
+	if (ptr != NULL) {
+		context_allocs -= 1;
+	}
+	free(ptr);
+}
+
+ATF_TC(node_pool);
+ATF_TC_HEAD(node_pool, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that repeated parses reuse pooled cJSON nodes");
+}
+ATF_TC_BODY(node_pool, tc)
+{
+	const char * json = "[{\"rrset_type\": \"A\", \"rrset_name\": \"www\","
+		" \"rrset_values\": [\"192.0.2.1\"]}, {\"rrset_type\": \"MX\", "
+		"\"rrset_name\": \"@\", \"rrset_values\": [\"10 mx\"]}]";
+	cJSON_Hooks hooks = { context_malloc, context_free };
+	cJSON_PoolStats before, after;
+	cJSON_Context ctx;
+	cJSON * root, * item;
+	int i;
+
+	/* off by default, nodes are plain allocations cJSON_free can take */
+	cJSON_GetPoolStats(&before);
+	item = cJSON_CreateNull();
+	ATF_REQUIRE(item != NULL);
+	ATF_CHECK(!(item->type & cJSON_Pooled));
+	cJSON_free(item);
+	cJSON_GetPoolStats(&after);
+	ATF_CHECK_EQ(after.taken, before.taken);
+
+	cJSON_EnablePool(1);
+	root = cJSON_Parse(json);
+	ATF_REQUIRE(root != NULL);
+	cJSON_Delete(root);
+
+	cJSON_GetPoolStats(&before);
+
+	for (i = 0; i < 1000; i++) {
+		root = cJSON_Parse(json);
+		ATF_REQUIRE(root != NULL);
+		cJSON_Delete(root);
+	}
+
+	cJSON_GetPoolStats(&after);
+
+#ifndef CJSON_NO_NODE_POOL
+	ATF_CHECK(before.slabs > 0);
+	ATF_CHECK_EQ(after.slabs, before.slabs);
+	ATF_CHECK_EQ(after.taken - before.taken, 1000 * 11);
+	ATF_CHECK_EQ(after.reused - before.reused, 1000 * 11);
+	ATF_CHECK_EQ(after.given, after.taken);
+
+	/* slabs emptied by a delete go back, all but the one kept to take from */
+	root = cJSON_CreateArray();
+	for (i = 0; i < 1000; i++) {
+		cJSON_AddItemToArray(root, cJSON_CreateNumber(i));
+	}
+	cJSON_GetPoolStats(&before);
+	ATF_CHECK(before.slabs - before.released > 10);
+	cJSON_Delete(root);
+	cJSON_GetPoolStats(&after);
+	ATF_CHECK_EQ(after.slabs - after.released, 1);
+
+	/* a context's nodes come from slabs of its own allocator */
+	cJSON_InitContext(&ctx, &hooks);
+	root = cJSON_ParseWithContext(&ctx, json, strlen(json), NULL);
+	ATF_REQUIRE(root != NULL);
+	ATF_CHECK(root->type & cJSON_Pooled);
+	cJSON_DeleteWithContext(&ctx, root);
+
+	/* a tree that outlives the release takes its slab with its last node */
+	root = cJSON_Parse(json);
+	ATF_REQUIRE(root != NULL);
+	cJSON_PoolRelease();
+	cJSON_EnablePool(0);
+	cJSON_GetPoolStats(&after);
+	ATF_CHECK_EQ(after.slabs - after.released, 1);
+	cJSON_Delete(root);
+	cJSON_GetPoolStats(&after);
+	ATF_CHECK_EQ(after.slabs, after.released);
+	ATF_CHECK_EQ(context_allocs, 0);
+#else
+	cJSON_EnablePool(0);
+	ATF_CHECK_EQ(after.taken, 0);
+#endif
+}
+
+struct pool_run {
+	cJSON *			root;
+	cJSON_PoolStats		stats;
+};
+
+/* delete a tree made on another thread */
+static void *
+pool_delete(void * arg)
+{
+	struct pool_run * run = arg;
+
+	cJSON_Delete(run->root);
+	cJSON_GetPoolStats(&run->stats);
+
+	return NULL;
+}
+
+static cJSON *
+pool_numbers(int count)
+{
+	cJSON * root;
+	int i;
+
+	root = cJSON_CreateArray();
+	ATF_REQUIRE(root != NULL);
+	for (i = 0; i < count; i++) {
+		cJSON_AddItemToArray(root, cJSON_CreateNumber(i));
+	}
+
+	return root;
+}
+
+ATF_TC(node_pool_threads);
+ATF_TC_HEAD(node_pool_threads, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that pooled nodes deleted on another thread go back to "
+		"the pool that made them");
+}
+ATF_TC_BODY(node_pool_threads, tc)
+{
+#ifndef CJSON_NO_NODE_POOL
+	cJSON_PoolStats before, after;
+	struct pool_run run;
+	pthread_t thread;
+
+	cJSON_EnablePool(1);
+	cJSON_PoolRelease();
+
+	/* the other thread only hands the nodes back */
+	run.root = pool_numbers(1000);
+	cJSON_GetPoolStats(&before);
+	ATF_REQUIRE(pthread_create(&thread, NULL, pool_delete, &run) == 0);
+	ATF_REQUIRE(pthread_join(thread, NULL) == 0);
+	ATF_CHECK_EQ(run.stats.given, 1001);
+	ATF_CHECK_EQ(run.stats.released, 0);
+	cJSON_GetPoolStats(&after);
+	ATF_CHECK_EQ(after.given, before.given);
+	ATF_CHECK_EQ(after.released, before.released);
+
+	/* and this one takes them again without growing */
+	run.root = pool_numbers(1000);
+	cJSON_GetPoolStats(&after);
+	ATF_CHECK_EQ(after.slabs, before.slabs);
+	ATF_CHECK(after.reused > before.reused);
+
+	/* once released, the slabs go with their last node on whichever thread */
+	cJSON_PoolRelease();
+	cJSON_EnablePool(0);
+	cJSON_GetPoolStats(&before);
+	ATF_REQUIRE(before.slabs - before.released > 10);
+	ATF_REQUIRE(pthread_create(&thread, NULL, pool_delete, &run) == 0);
+	ATF_REQUIRE(pthread_join(thread, NULL) == 0);
+	ATF_CHECK_EQ(run.stats.released, before.slabs - before.released);
+#else
+	atf_tc_skip("built with CJSON_NO_NODE_POOL");
+#endif
+}
+
+ATF_TC(string_scan);
+ATF_TC_HEAD(string_scan, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test strings and whitespace around the vector scanning widths");
+}
+ATF_TC_BODY(string_scan, tc)
+{
+	char json[256];
+	char expected[80];
+	char * p;
+	cJSON * root;
+	size_t length, at, i;
+
+	for (length = 1; length < 70; length++) {
+		for (at = 0; at < length; at++) {
+			/* an escaped quote at every position of every length */
+			for (i = 0; i < length; i++) {
+				expected[i] = (char)('a' + i % 26);
+			}
+			expected[at] = '"';
+			expected[length] = '\0';
+
+			/* and as much whitespace around it */
+			p = json;
+			memset(p, ' ', at);
+			p += at;
+			*p++ = '"';
+			for (i = 0; i < length; i++) {
+				if (expected[i] == '"') {
+					*p++ = '\\';
+				}
+				*p++ = expected[i];
+			}
+			*p++ = '"';
+			memset(p, '\n', at);
+			p[at] = '\0';
+
+			root = cJSON_ParseWithOpts(json, NULL, 1);
+			ATF_REQUIRE(root != NULL);
+			ATF_CHECK_STREQ(root->valuestring, expected);
+			cJSON_Delete(root);
+		}
+	}
+
+	ATF_CHECK(cJSON_Parse("\"unterminated\\") == NULL);
+	ATF_CHECK(cJSON_Parse("\"0123456789abcdef0123456789abcdef") == NULL);
+}
+
+ATF_TC(number_parse);
+ATF_TC_HEAD(number_parse, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that numbers parse to the same doubles strtod gives");
+}
+ATF_TC_BODY(number_parse, tc)
+{
+	const char * numbers[] = {
+		"300", "-0", "0.1", "3.14159265358979", "1e23", "1.7976931348623157e308",
+		"9007199254740993", "123456789012345678901234567890", "4.9e-324",
+		"2.2250738585072014e-308", "0.30000000000000004", "1E+2", "-12.5e-3",
+		"1e400", NULL
+	};
+	const char * end;
+	cJSON * item;
+	size_t i;
+
+	for (i = 0; numbers[i] != NULL; i++) {
+		item = cJSON_Parse(numbers[i]);
+		ATF_REQUIRE(item != NULL);
+		ATF_CHECK_EQ(memcmp(&item->valuedouble,
+			&(double){strtod(numbers[i], NULL)}, sizeof(double)), 0);
+		cJSON_Delete(item);
+	}
+
+	item = cJSON_Parse("300");
+	ATF_CHECK_EQ(item->valueint, 300);
+	cJSON_Delete(item);
+
+	/* strtod stops early on these, so does the parse */
+	item = cJSON_ParseWithOpts("1.5e]", &end, 0);
+	ATF_REQUIRE(item != NULL);
+	ATF_CHECK(item->valuedouble == 1.5);
+	ATF_CHECK_STREQ(end, "e]");
+	cJSON_Delete(item);
+
+	ATF_CHECK(cJSON_Parse("-") == NULL);
+}
+
+ATF_TC(number_print);
+ATF_TC_HEAD(number_print, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that numbers print in their shortest form and read back");
+}
+ATF_TC_BODY(number_print, tc)
+{
+	const struct {
+		double value;
+		const char * text;
+	} numbers[] = {
+		{ 300, "300" }, { -0.0, "-0" }, { 0.1, "0.1" }, { 1e15, "1e+15" },
+		{ 1e-5, "1e-05" }, { 0.0001, "0.0001" }, { 5e-324, "5e-324" },
+		{ 1.0 / 3, "0.3333333333333333" },
+		{ 0.1 + 0.2, "0.30000000000000004" },
+		{ 9007199254740992.0, "9007199254740992" },
+		{ 1.7976931348623157e308, "1.7976931348623157e+308" },
+	};
+	unsigned long long bits;
+	double value;
+	cJSON * item, * parsed;
+	char * text;
+	size_t i;
+
+	for (i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+		item = cJSON_CreateNumber(numbers[i].value);
+		text = cJSON_PrintUnformatted(item);
+		ATF_CHECK_STREQ(text, numbers[i].text);
+		free(text);
+		cJSON_Delete(item);
+	}
+
+	bits = 0x9e3779b97f4a7c15ULL;
+	for (i = 0; i < 100000; i++) {
+		bits ^= bits << 13;
+		bits ^= bits >> 7;
+		bits ^= bits << 17;
+		memcpy(&value, &bits, sizeof(value));
+		if (value != value || value * 0 != 0) {
+			continue;
+		}
+
+		item = cJSON_CreateNumber(value);
+		text = cJSON_PrintUnformatted(item);
+		parsed = cJSON_Parse(text);
+		ATF_REQUIRE(parsed != NULL);
+		ATF_CHECK_EQ(memcmp(&parsed->valuedouble, &value,
+			sizeof(value)), 0);
+		cJSON_Delete(parsed);
+		free(text);
+		cJSON_Delete(item);
+	}
+}
+
+ATF_TC(parse_buffer);
+ATF_TC_HEAD(parse_buffer, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test parsing a buffer of known length that is not NUL terminated");
+}
+ATF_TC_BODY(parse_buffer, tc)
+{
+	const char body[] = "{\"a\": [1, 2]}  {\"b\": 3}";
+	cJSON_ParseStatus status;
+	cJSON * item;
+
+	/* only the first document is inside the length */
+	item = cJSON_ParseBuffer(body, 15, &status);
+	ATF_REQUIRE(item != NULL);
+	ATF_CHECK(!status.failed);
+	ATF_CHECK_EQ(status.end, 15);
+	ATF_CHECK_EQ(cJSON_GetArraySize(cJSON_GetObjectItem(item, "a")), 2);
+	cJSON_Delete(item);
+
+	/* the rest is reported rather than rejected */
+	item = cJSON_ParseBuffer(body, sizeof(body) - 1, &status);
+	ATF_REQUIRE(item != NULL);
+	ATF_CHECK_EQ(status.end, 15);
+	cJSON_Delete(item);
+
+	item = cJSON_ParseBuffer("12345", 3, &status);
+	ATF_REQUIRE(item != NULL);
+	ATF_CHECK_EQ(item->valueint, 123);
+	ATF_CHECK_EQ(status.end, 3);
+	cJSON_Delete(item);
+
+	ATF_CHECK(cJSON_ParseBuffer("{\"a\": [1, 2]}", 12, &status) == NULL);
+	ATF_CHECK(status.failed);
+	ATF_CHECK_EQ(status.end, 11);
+
+	/* a nested container closing on the last byte doesn't close its parent */
+	ATF_CHECK(cJSON_ParseBuffer("[[]", 3, &status) == NULL);
+	ATF_CHECK(cJSON_ParseBuffer("{\"a\": {}", 9, &status) == NULL);
+
+	ATF_CHECK(cJSON_ParseBuffer("true", 3, &status) == NULL);
+	ATF_CHECK(cJSON_ParseBuffer("", 0, &status) == NULL);
+	ATF_CHECK(status.failed);
+}
+
+ATF_TC(parse_insitu);
+ATF_TC_HEAD(parse_insitu, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that in-situ parsing decodes strings into the input buffer");
+}
+ATF_TC_BODY(parse_insitu, tc)
+{
+	const char json[] = "[{\"rrset_name\": \"www\", \"rrset_values\": "
+		"[\"a\\\"b\\u00e9\"]}] ";
+	cJSON_Arena * arena;
+	cJSON * root, * rrset, * copy, * other;
+	cJSON_ParseStatus status;
+	char * buffer;
+	char * name;
+
+	buffer = malloc(sizeof(json) - 1);
+	ATF_REQUIRE(buffer != NULL);
+	memcpy(buffer, json, sizeof(json) - 1);
+
+	root = cJSON_ParseInSitu(buffer, sizeof(json) - 1, &status, NULL);
+	ATF_REQUIRE(root != NULL);
+	ATF_CHECK_EQ(status.end, sizeof(json) - 1);
+
+	rrset = cJSON_GetArrayItem(root, 0);
+	name = cJSON_GetObjectItem(rrset, "rrset_name")->valuestring;
+	ATF_CHECK_STREQ(name, "www");
+	ATF_CHECK(name > buffer && name < buffer + sizeof(json));
+	ATF_CHECK_STREQ(cJSON_GetArrayItem(cJSON_GetObjectItem(rrset,
+		"rrset_values"), 0)->valuestring, "a\"b\xc3\xa9");
+
+	/* copies own their strings, only the root owns the buffer */
+	ATF_CHECK(root->type & cJSON_OwnsBuffer);
+	ATF_CHECK(root->valuestring == NULL);
+	copy = cJSON_Duplicate(rrset, 1);
+	other = cJSON_Duplicate(root, 1);
+	ATF_CHECK(!(other->type & cJSON_OwnsBuffer));
+	cJSON_Delete(root);
+	ATF_CHECK_STREQ(cJSON_GetObjectItem(copy, "rrset_name")->valuestring,
+		"www");
+	ATF_CHECK(cJSON_Compare(copy, cJSON_GetArrayItem(other, 0), 1));
+	cJSON_Delete(copy);
+	cJSON_Delete(other);
+
+	/* a bare string stays where it was decoded */
+	buffer = malloc(8);
+	ATF_REQUIRE(buffer != NULL);
+	memcpy(buffer, "  \"a\\nb\"", 8);
+	root = cJSON_ParseInSitu(buffer, 8, NULL, NULL);
+	ATF_REQUIRE(root != NULL);
+	ATF_CHECK_EQ(root->valuestring, buffer + 3);
+	ATF_CHECK_STREQ(root->valuestring, "a\nb");
+	cJSON_Delete(root);
+
+	/* nothing points into the buffer of a number, it goes right away */
+	buffer = malloc(4);
+	ATF_REQUIRE(buffer != NULL);
+	memcpy(buffer, " 42 ", 4);
+	root = cJSON_ParseInSitu(buffer, 4, NULL, NULL);
+	ATF_REQUIRE(root != NULL);
+	ATF_CHECK(!(root->type & cJSON_OwnsBuffer));
+	ATF_CHECK_EQ(root->valuedouble, 42);
+	cJSON_Delete(root);
+
+	/* failures give the buffer back as well */
+	buffer = malloc(8);
+	ATF_REQUIRE(buffer != NULL);
+	memcpy(buffer, "{\"a\": ]", 7);
+	ATF_CHECK(cJSON_ParseInSitu(buffer, 7, &status, NULL) == NULL);
+	ATF_CHECK(status.failed);
+
+	arena = cJSON_CreateArena(0);
+	ATF_REQUIRE(arena != NULL);
+	buffer = malloc(sizeof(json) - 1);
+	ATF_REQUIRE(buffer != NULL);
+	memcpy(buffer, json, sizeof(json) - 1);
+	root = cJSON_ParseInSitu(buffer, sizeof(json) - 1, NULL, arena);
+	ATF_REQUIRE(root != NULL);
+	ATF_CHECK_STREQ(cJSON_GetObjectItem(cJSON_GetArrayItem(root, 0),
+		"rrset_name")->valuestring, "www");
+	cJSON_DeleteArena(arena);
+}
+
+ATF_TC(printed_length);
+ATF_TC_HEAD(printed_length, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that the measured length matches what is printed");
+}
+ATF_TC_BODY(printed_length, tc)
+{
+	cJSON * root;
+	char * printed;
+	char * buf;
+	size_t length;
+	int format;
+
+	root = cJSON_Parse("[{\"rrset_name\": \"www\", \"rrset_ttl\": 300, "
+		"\"rrset_values\": [\"a\\\"b\\u0001\", -12, 0.5, true, null], "
+		"\"empty\": {}, \"none\": []}, -0, 1e300]");
+	ATF_REQUIRE(root != NULL);
+	cJSON_AddItemToArray(root, cJSON_CreateRaw("{\"raw\": 1}"));
+
+	for (format = 0; format < 2; format++) {
+		printed = format ? cJSON_Print(root) :
+			cJSON_PrintUnformatted(root);
+		ATF_REQUIRE(printed != NULL);
+
+		length = cJSON_PrintedLength(root, format);
+		ATF_CHECK_EQ(length, strlen(printed));
+
+		/* one byte for the terminator is all the slack needed */
+		buf = malloc(length + 1);
+		ATF_REQUIRE(buf != NULL);
+		ATF_CHECK(cJSON_PrintPreallocated(root, buf, (int)length + 1,
+			format));
+		ATF_CHECK_STREQ(buf, printed);
+		ATF_CHECK(!cJSON_PrintPreallocated(root, buf, (int)length,
+			format));
+
+		free(buf);
+		free(printed);
+	}
+
+	cJSON_Delete(root);
+}
+
+ATF_TC(context);
+ATF_TC_HEAD(context, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that a context's allocator, limit and error stay its own");
+}
+ATF_TC_BODY(context, tc)
+{
+	cJSON_Hooks hooks = { context_malloc, context_free };
+	cJSON_Context ctx;
+	cJSON * root, * copy;
+	const char * global;
+	const char * json = "{\"rrset_name\": \"www\", \"rrset_values\": [\"a\"]}";
+	const char * deep = "[[[[1]]]]";
+	const char * bad = "[1, x]";
+	char * printed;
+
+	cJSON_InitContext(&ctx, &hooks);
+	ATF_CHECK_EQ(ctx.nesting_limit, CJSON_NESTING_LIMIT);
+
+	root = cJSON_ParseWithContext(&ctx, json, strlen(json), NULL);
+	ATF_REQUIRE(root != NULL);
+	ATF_CHECK(ctx.error == NULL);
+	ATF_CHECK(context_allocs > 0);
+
+	cJSON_AddItemToObjectWithContext(&ctx, root, "rrset_type",
+		cJSON_CreateStringWithContext(&ctx, "A"));
+	copy = cJSON_DuplicateWithContext(&ctx, root, 1);
+	ATF_REQUIRE(copy != NULL);
+
+	printed = cJSON_PrintWithContext(&ctx, copy, 0);
+	ATF_CHECK_STREQ(printed, "{\"rrset_name\":\"www\","
+		"\"rrset_values\":[\"a\"],\"rrset_type\":\"A\"}");
+	context_free(printed);
+
+	cJSON_DeleteWithContext(&ctx, copy);
+	cJSON_DeleteWithContext(&ctx, root);
+	ATF_CHECK_EQ(context_allocs, 0);
+
+	/* a failed context parse leaves the thread's error alone */
+	ATF_CHECK(cJSON_Parse(bad) == NULL);
+	global = cJSON_GetErrorPtr();
+	ATF_CHECK(cJSON_ParseWithContext(&ctx, bad, strlen(bad), NULL) == NULL);
+	ATF_CHECK(ctx.error == bad + 4);
+	ATF_CHECK(cJSON_GetErrorPtr() == global);
+
+	/* what was parsed before the error goes back to the context */
+	ATF_CHECK(cJSON_ParseWithContext(&ctx, json, strlen(json) - 3, NULL) ==
+		NULL);
+	ATF_CHECK_EQ(context_allocs, 0);
+
+	ctx.nesting_limit = 3;
+	ATF_CHECK(cJSON_ParseWithContext(&ctx, deep, strlen(deep), NULL) == NULL);
+	ATF_CHECK(ctx.error != NULL);
+	ctx.nesting_limit = 4;
+	root = cJSON_ParseWithContext(&ctx, deep, strlen(deep), NULL);
+	ATF_CHECK(root != NULL);
+	cJSON_DeleteWithContext(&ctx, root);
+	ATF_CHECK_EQ(context_allocs, 0);
+}
+
+struct event_names {
+	char names[4][16];
+	size_t count;
+	int in_name;
+	int events;
+};
+
+static int
+event_collect(const cJSON_Event * event, void * ctx)
+{
+	struct event_names * names = ctx;
+
+	names->events += 1;
+
+	if (event->type == cJSON_EventKey) {
+		names->in_name = event->depth == 2 &&
+			strcmp(event->string, "rrset_name") == 0;
+		return cJSON_EventContinue;
+	}
+
+	if (event->type == cJSON_EventString && names->in_name &&
+		names->count < 4) {
+		snprintf(names->names[names->count++],
+			sizeof(names->names[0]), "%s", event->string);
+		/* hand control back after every name */
+		return cJSON_EventPause;
+	}
+
+	return cJSON_EventContinue;
+}
+
+ATF_TC(event_parser);
+ATF_TC_HEAD(event_parser, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that the event parser can be fed a byte at a time");
+}
+ATF_TC_BODY(event_parser, tc)
+{
+	struct event_names names;
+	cJSON_EventParser * parser;
+	const char * json = "[{\"rrset_name\": \"www\", \"rrset_values\": "
+		"[\"192.0.2.1\"], \"rrset_ttl\": 300}, {\"rrset_name\": "
+		"\"m\\u00e9l\", \"x\": {\"rrset_name\": \"nested\"}, "
+		"\"ok\": [true, false, null, -1.5e3]}]";
+	size_t length, i;
+	int pauses;
+
+	memset(&names, 0, sizeof(names));
+	parser = cJSON_CreateEventParser(event_collect, &names, 16);
+	ATF_REQUIRE(parser != NULL);
+
+	length = strlen(json);
+	pauses = 0;
+	for (i = 0; i < length; i++) {
+		ATF_REQUIRE_EQ(cJSON_FeedEventParser(parser, json + i, 1), 1);
+		if (cJSON_EventParserStatus(parser) == cJSON_EventParserPaused) {
+			pauses += 1;
+		}
+	}
+	ATF_CHECK_EQ(cJSON_FinishEventParser(parser), cJSON_EventParserDone);
+	cJSON_DeleteEventParser(parser);
+
+	ATF_CHECK_EQ(names.count, 2);
+	ATF_CHECK_STREQ(names.names[0], "www");
+	ATF_CHECK_STREQ(names.names[1], "m\xc3\xa9l");
+	ATF_CHECK_EQ(names.events, 28);
+	ATF_CHECK_EQ(pauses, 2);
+
+	/* pausing returns early, feeding the rest resumes */
+	memset(&names, 0, sizeof(names));
+	parser = cJSON_CreateEventParser(event_collect, &names, 16);
+	ATF_REQUIRE(parser != NULL);
+	i = cJSON_FeedEventParser(parser, json, length);
+	ATF_CHECK_EQ(json[i - 1], '"');
+	ATF_CHECK_EQ(names.count, 1);
+	i += cJSON_FeedEventParser(parser, json + i, length - i);
+	ATF_CHECK_EQ(names.count, 2);
+	i += cJSON_FeedEventParser(parser, json + i, length - i);
+	ATF_CHECK_EQ(i, length);
+	ATF_CHECK_EQ(cJSON_FinishEventParser(parser), cJSON_EventParserDone);
+	cJSON_DeleteEventParser(parser);
+
+	/* a number at the top level only ends with the input */
+	ATF_CHECK_EQ(cJSON_ParseEvents("42", 2, NULL, NULL),
+		cJSON_EventParserDone);
+	ATF_CHECK_EQ(cJSON_ParseEvents("[1, x]", 6, NULL, NULL),
+		cJSON_EventParserFailed);
+	ATF_CHECK_EQ(cJSON_ParseEvents("{\"a\": 1", 7, NULL, NULL),
+		cJSON_EventParserFailed);
+	ATF_CHECK_EQ(cJSON_ParseEvents("[] []", 5, NULL, NULL),
+		cJSON_EventParserFailed);
+
+	/* tokens longer than the parser was made for are refused */
+	parser = cJSON_CreateEventParser(NULL, NULL, 4);
+	ATF_REQUIRE(parser != NULL);
+	ATF_CHECK_EQ(cJSON_FeedEventParser(parser, "[\"abcd\"]", 8), 8);
+	ATF_CHECK_EQ(cJSON_FinishEventParser(parser), cJSON_EventParserDone);
+	cJSON_DeleteEventParser(parser);
+
+	parser = cJSON_CreateEventParser(NULL, NULL, 4);
+	ATF_REQUIRE(parser != NULL);
+	ATF_CHECK(cJSON_FeedEventParser(parser, "[\"abcde\"]", 9) < 9);
+	ATF_CHECK_EQ(cJSON_EventParserStatus(parser), cJSON_EventParserFailed);
+	cJSON_DeleteEventParser(parser);
+}
+
+ATF_TC(extract_string);
+ATF_TC_HEAD(extract_string, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that one string is read from a lookup response");
+}
+ATF_TC_BODY(extract_string, tc)
+{
+	cJSON_ParseStatus status;
+	const char * json = "{\"country\": {\"ip\": \"no\"}, \"list\": "
+		"[1, \"ip\", null], \"IP\": \"192.0.2.1\", \"ip\": \"x\", "
+		"\"name\": \"h\\u00e9\\\"llo\", \"num\": 4} trailing";
+	char buf[16];
+
+	ATF_CHECK_EQ(cJSON_ExtractString(json, strlen(json), "ip", buf,
+		sizeof buf, &status), cJSON_ExtractFound);
+	/* the first match, in any case, like cJSON_GetObjectItem */
+	ATF_CHECK_STREQ(buf, "192.0.2.1");
+	ATF_CHECK(!status.failed);
+	ATF_CHECK_EQ(status.end, strlen(json) - strlen("trailing"));
+
+	ATF_CHECK_EQ(cJSON_ExtractString(json, strlen(json), "name", buf,
+		sizeof buf, NULL), cJSON_ExtractFound);
+	ATF_CHECK_STREQ(buf, "h\xc3\xa9\"llo");
+	ATF_CHECK_EQ(cJSON_ExtractString(json, strlen(json), "name", buf, 7,
+		NULL), cJSON_ExtractTooLong);
+
+	ATF_CHECK_EQ(cJSON_ExtractString(json, strlen(json), "num", buf,
+		sizeof buf, NULL), cJSON_ExtractMissing);
+	ATF_CHECK_EQ(cJSON_ExtractString(json, strlen(json), "country", buf,
+		sizeof buf, NULL), cJSON_ExtractMissing);
+	ATF_CHECK_EQ(cJSON_ExtractString(json, strlen(json), "none", buf,
+		sizeof buf, NULL), cJSON_ExtractMissing);
+	ATF_CHECK_EQ(cJSON_ExtractString("[\"ip\"]", 6, "ip", buf,
+		sizeof buf, NULL), cJSON_ExtractMissing);
+
+	/* the whole value is checked, not just the part up to the key */
+	ATF_CHECK_EQ(cJSON_ExtractString("{\"ip\": \"1\", \"a\": [1,]}", 22,
+		"ip", buf, sizeof buf, &status), cJSON_ExtractInvalid);
+	ATF_CHECK(status.failed);
+	ATF_CHECK_EQ(cJSON_ExtractString("{\"ip\": \"\\x\"}", 12, "ip", buf,
+		sizeof buf, NULL), cJSON_ExtractInvalid);
+	ATF_CHECK_EQ(cJSON_ExtractString(json, 20, "ip", buf, sizeof buf,
+		NULL), cJSON_ExtractInvalid);
+}
+
+ATF_TC(tape);
+ATF_TC_HEAD(tape, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that a tape reads like the tree it replaces");
+}
+ATF_TC_BODY(tape, tc)
+{
+	char json[] = "[{\"rrset_name\": \"www\", \"rrset_type\": \"A\", "
+		"\"rrset_ttl\": 300, \"rrset_values\": [\"192.0.2.1\", "
+		"\"192.0.2.2\"]}, {\"rrset_name\": \"m\\u00e9l\", \"empty\": {}, "
+		"\"list\": [], \"flags\": [true, false, null]}]";
+	cJSON_ParseStatus status;
+	const cJSON_TapeItem * root, * rrset, * item;
+	cJSON_Tape * tape;
+	cJSON * tree;
+	size_t length;
+	int count;
+
+	length = strlen(json);
+	tree = cJSON_Parse(json);
+	ATF_REQUIRE(tree != NULL);
+
+	tape = cJSON_ParseTape(json, length, &status);
+	ATF_REQUIRE(tape != NULL);
+	ATF_CHECK(!status.failed);
+	ATF_CHECK_EQ(status.end, length);
+	ATF_CHECK(sizeof(cJSON_TapeItem) < sizeof(cJSON));
+
+	root = cJSON_TapeRoot(tape);
+	ATF_CHECK_EQ(cJSON_TapeGetArraySize(root), 2);
+	ATF_CHECK(cJSON_TapeGetKey(root) == NULL);
+
+	rrset = cJSON_TapeGetArrayItem(root, 0);
+	ATF_CHECK_STREQ(cJSON_TapeGetStringValue(
+		cJSON_TapeGetObjectItem(rrset, "RRSET_NAME")), "www");
+	ATF_CHECK(cJSON_TapeGetObjectItemCaseSensitive(rrset,
+		"RRSET_NAME") == NULL);
+	ATF_CHECK_EQ(cJSON_TapeGetNumberValue(
+		cJSON_TapeGetObjectItem(rrset, "rrset_ttl")), 300);
+
+	count = 0;
+	cJSON_TapeArrayForEach(item, cJSON_TapeGetObjectItem(rrset,
+		"rrset_values")) {
+		ATF_CHECK_STREQ(cJSON_TapeGetStringValue(item),
+			cJSON_GetArrayItem(cJSON_GetObjectItem(cJSON_GetArrayItem(
+			tree, 0), "rrset_values"), count)->valuestring);
+		count += 1;
+	}
+	ATF_CHECK_EQ(count, 2);
+
+	/* items follow containers of any size, empty ones included */
+	rrset = cJSON_TapeNext(rrset);
+	ATF_REQUIRE(rrset != NULL);
+	ATF_CHECK(cJSON_TapeNext(rrset) == NULL);
+	ATF_CHECK(cJSON_TapeGetArrayItem(root, 2) == NULL);
+	ATF_CHECK_STREQ(cJSON_TapeGetStringValue(
+		cJSON_TapeGetObjectItem(rrset, "rrset_name")), "m\xc3\xa9l");
+	ATF_CHECK_EQ(cJSON_TapeGetArraySize(
+		cJSON_TapeGetObjectItem(rrset, "empty")), 0);
+
+	count = 0;
+	cJSON_TapeArrayForEach(item, rrset) {
+		ATF_CHECK_STREQ(cJSON_TapeGetKey(item), cJSON_GetArrayItem(
+			cJSON_GetArrayItem(tree, 1), count)->string);
+		count += 1;
+	}
+	ATF_CHECK_EQ(count, 4);
+
+	item = cJSON_TapeGetArrayItem(cJSON_TapeGetObjectItem(rrset, "flags"),
+		2);
+	ATF_REQUIRE(item != NULL);
+	ATF_CHECK_EQ(item->type, cJSON_NULL);
+
+	cJSON_DeleteTape(tape);
+	cJSON_Delete(tree);
+
+	ATF_CHECK(cJSON_ParseTape(json, 10, &status) == NULL);
+	ATF_CHECK(status.failed);
+}
+
+ATF_TC(intern);
+ATF_TC_HEAD(intern, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that repeated strings of a listing share one interned copy");
+}
+ATF_TC_BODY(intern, tc)
+{
+	cJSON_Context ctx;
+	cJSON_InternStats stats;
+	cJSON * root, * first, * second, * copy;
+	char json[2048];
+	char long_value[300];
+	size_t len, i;
+
+	memset(long_value, 'x', sizeof(long_value) - 1);
+	long_value[sizeof(long_value) - 1] = '\0';
+
+	len = snprintf(json, sizeof(json), "[");
+	for (i = 0; i < 8; i++) {
+		len += snprintf(json + len, sizeof(json) - len,
+			"%s{\"rrset_type\": \"A\", \"rrset_ttl\": 300, "
+			"\"rrset_name\": \"www\", \"rrset_values\": [\"%s\"]}",
+			i ? ", " : "", i == 7 ? long_value : "192.0.2.1");
+	}
+	len += snprintf(json + len, sizeof(json) - len, "]");
+	ATF_REQUIRE(len < sizeof(json));
+
+	cJSON_InitContext(&ctx, NULL);
+	ctx.intern = cJSON_CreateIntern(0);
+	ATF_REQUIRE(ctx.intern != NULL);
+
+	root = cJSON_ParseWithContext(&ctx, json, len, NULL);
+	ATF_REQUIRE(root != NULL);
+
+	first = cJSON_GetArrayItem(root, 0);
+	second = cJSON_GetArrayItem(root, 1);
+	ATF_CHECK(first->child->string == second->child->string);
+	ATF_CHECK(cJSON_GetObjectItem(first, "rrset_name")->valuestring ==
+		cJSON_GetObjectItem(second, "rrset_name")->valuestring);
+	ATF_CHECK_STREQ(cJSON_GetArrayItem(cJSON_GetObjectItem(
+		cJSON_GetArrayItem(root, 7), "rrset_values"), 0)->valuestring,
+		long_value);
+
+	/* 4 keys and 3 values, the long value is kept but not shared */
+	cJSON_GetInternStats(ctx.intern, &stats);
+	ATF_CHECK_EQ(stats.strings, 7);
+	ATF_CHECK_EQ(stats.shared, 8 * 7 - 1 - 7);
+	ATF_CHECK(stats.allocations < stats.strings);
+
+	copy = cJSON_Duplicate(root, 1);
+	ATF_REQUIRE(copy != NULL);
+
+	/* bad input leaves the table and the tree parsed before alone */
+	ATF_CHECK(cJSON_ParseWithContext(&ctx, "[\"www\", x]", 11, NULL) ==
+		NULL);
+
+	cJSON_Delete(root);
+	cJSON_DeleteIntern(ctx.intern);
+
+	ATF_CHECK(cJSON_Compare(cJSON_GetArrayItem(copy, 0),
+		cJSON_GetArrayItem(copy, 1), 1));
+	ATF_CHECK_STREQ(cJSON_GetObjectItem(cJSON_GetArrayItem(copy, 3),
+		"rrset_name")->valuestring, "www");
+	cJSON_Delete(copy);
+}
+
+struct writer_sink {
+	char data[256];
+	size_t length;
+	int flushes;
+};
+
+static size_t
+writer_collect(const char * data, size_t length, void * user)
+{
+	struct writer_sink * sink = user;
+
+	if (sink->length + length >= sizeof(sink->data)) {
+		return 0;
+	}
+	memcpy(sink->data + sink->length, data, length);
+	sink->length += length;
+	sink->data[sink->length] = '\0';
+	sink->flushes += 1;
+
+	return length;
+}
+
+ATF_TC(writer);
+ATF_TC_HEAD(writer, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test writing JSON a token at a time without cJSON items");
+}
+ATF_TC_BODY(writer, tc)
+{
+	const char * expected = "{\"rrset_values\":[\"192.0.2.1\"],"
+		"\"rrset_name\":\"w\\\"w\\nw\",\"rrset_ttl\":300,"
+		"\"rrset_flags\":[0.1,-1e+300,true,false,null]}";
+	struct writer_sink sink;
+	cJSON_Writer writer;
+	cJSON * tree;
+	const char * text;
+	char * printed;
+	char buffer[128];
+	size_t length;
+
+	cJSON_InitWriter(&writer, buffer, sizeof buffer);
+	ATF_CHECK(cJSON_WriteObjectStart(&writer));
+	ATF_CHECK(cJSON_WriteKey(&writer, "rrset_values"));
+	ATF_CHECK(cJSON_WriteArrayStart(&writer));
+	ATF_CHECK(cJSON_WriteString(&writer, "192.0.2.1"));
+	ATF_CHECK(cJSON_WriteArrayEnd(&writer));
+	ATF_CHECK(cJSON_WriteKey(&writer, "rrset_name"));
+	ATF_CHECK(cJSON_WriteString(&writer, "w\"w\nw"));
+	ATF_CHECK(cJSON_WriteKey(&writer, "rrset_ttl"));
+	ATF_CHECK(cJSON_WriteNumber(&writer, 300));
+	ATF_CHECK(cJSON_WriteKey(&writer, "rrset_flags"));
+	ATF_CHECK(cJSON_WriteArrayStart(&writer));
+	ATF_CHECK(cJSON_WriteNumber(&writer, 0.1));
+	ATF_CHECK(cJSON_WriteNumber(&writer, -1e300));
+	ATF_CHECK(cJSON_WriteBool(&writer, 1));
+	ATF_CHECK(cJSON_WriteBool(&writer, 0));
+	ATF_CHECK(cJSON_WriteNull(&writer));
+	ATF_CHECK(cJSON_WriteArrayEnd(&writer));
+	ATF_CHECK(cJSON_FinishWriter(&writer, &length) == NULL);
+	ATF_CHECK(cJSON_WriteObjectEnd(&writer));
+
+	text = cJSON_FinishWriter(&writer, &length);
+	ATF_REQUIRE(text != NULL);
+	ATF_CHECK_STREQ(text, expected);
+	ATF_CHECK_EQ(length, strlen(expected));
+
+	/* the same text cJSON_Print would give, and it fits exactly */
+	tree = cJSON_Parse(text);
+	printed = cJSON_PrintUnformatted(tree);
+	ATF_CHECK_STREQ(printed, expected);
+	free(printed);
+
+	cJSON_InitWriter(&writer, buffer, length + 1);
+	ATF_CHECK(cJSON_WriteItem(&writer, tree));
+	ATF_CHECK_STREQ(cJSON_FinishWriter(&writer, NULL), expected);
+	cJSON_InitWriter(&writer, buffer, length);
+	ATF_CHECK(!cJSON_WriteItem(&writer, tree));
+	ATF_CHECK(!cJSON_WriteNull(&writer));
+	ATF_CHECK(cJSON_FinishWriter(&writer, NULL) == NULL);
+
+	/* tokens out of place fail the writer */
+	cJSON_InitWriter(&writer, buffer, sizeof buffer);
+	cJSON_WriteObjectStart(&writer);
+	ATF_CHECK(!cJSON_WriteNumber(&writer, 1));
+	ATF_CHECK(!cJSON_WriteObjectEnd(&writer));
+	cJSON_InitWriter(&writer, buffer, sizeof buffer);
+	cJSON_WriteArrayStart(&writer);
+	ATF_CHECK(!cJSON_WriteKey(&writer, "a"));
+	cJSON_InitWriter(&writer, buffer, sizeof buffer);
+	cJSON_WriteArrayStart(&writer);
+	ATF_CHECK(!cJSON_WriteObjectEnd(&writer));
+	cJSON_InitWriter(&writer, buffer, sizeof buffer);
+	cJSON_WriteNull(&writer);
+	ATF_CHECK(!cJSON_WriteNull(&writer));
+
+	/* a stream writer hands its text on in pieces */
+	memset(&sink, 0, sizeof(sink));
+	cJSON_InitStreamWriter(&writer, 16, writer_collect, &sink);
+	ATF_CHECK(cJSON_WriteItem(&writer, tree));
+	ATF_CHECK_STREQ(cJSON_FinishWriter(&writer, &length), "");
+	ATF_CHECK_EQ(length, strlen(expected));
+	ATF_CHECK_STREQ(sink.data, expected);
+	cJSON_FreeWriter(&writer);
+
+	memset(&sink, 0, sizeof(sink));
+	cJSON_InitStreamWriter(&writer, 16, writer_collect, &sink);
+	cJSON_WriteArrayStart(&writer);
+	cJSON_WriteString(&writer, "192.0.2.1");
+	cJSON_WriteString(&writer, "192.0.2.2");
+	cJSON_WriteArrayEnd(&writer);
+	ATF_CHECK(cJSON_FinishWriter(&writer, &length) != NULL);
+	ATF_CHECK_STREQ(sink.data, "[\"192.0.2.1\",\"192.0.2.2\"]");
+	ATF_CHECK_EQ(sink.flushes, 2);
+	cJSON_FreeWriter(&writer);
+
+	/* without a buffer the writer grows its own, kept across a reset */
+	cJSON_InitWriter(&writer, NULL, 0);
+	ATF_CHECK(cJSON_WriteItem(&writer, tree));
+	ATF_CHECK_STREQ(cJSON_FinishWriter(&writer, NULL), expected);
+	cJSON_ResetWriter(&writer);
+	ATF_CHECK(cJSON_WriteString(&writer, "\xc3\xa9\x01"));
+	ATF_CHECK_STREQ(cJSON_FinishWriter(&writer, &length),
+		"\"\xc3\xa9\\u0001\"");
+	ATF_CHECK_EQ(length, 10);
+	cJSON_FreeWriter(&writer);
+
+	cJSON_Delete(tree);
+}
+
+#define NESTING_DEPTH 20000
+
+struct nesting_run {
+	const char * json;
+	size_t length;
+	size_t innermost;	/* offset of the last '[' or '{' */
+	cJSON * root;
+	const char * shallow;	/* as deep as the default limit allows */
+	size_t shallow_length;
+	int printed;
+	int compared;
+	int parsed;
+	int limited;
+	int extracted;
+	int taped;
+};
+
+/* everything that used to recurse once per level, on a 64 KiB stack */
+static void *
+nesting_walk(void * arg)
+{
+	struct nesting_run * run = arg;
+	cJSON_ParseStatus status;
+	cJSON_Context context;
+	cJSON_Tape * tape;
+	const cJSON_TapeItem * root;
+	cJSON * copy, * parsed;
+	char * printed, * buffer;
+	char found[8];
+
+	printed = cJSON_PrintUnformatted(run->root);
+	run->printed = printed != NULL && strcmp(printed, run->json) == 0 &&
+		(size_t)cJSON_PrintedLength(run->root, 0) == run->length;
+	free(printed);
+
+	copy = cJSON_Duplicate(run->root, 1);
+	run->compared = cJSON_Compare(run->root, copy, 1);
+	cJSON_Delete(copy);
+
+	cJSON_InitContext(&context, NULL);
+	context.nesting_limit = NESTING_DEPTH;
+	parsed = cJSON_ParseWithContext(&context, run->json, run->length,
+		&status);
+	run->parsed = parsed != NULL && status.end == run->length &&
+		cJSON_Compare(run->root, parsed, 1);
+	cJSON_DeleteWithContext(&context, parsed);
+
+	/* one level less allowed than there is, the error is at the last opener */
+	context.nesting_limit = NESTING_DEPTH - 1;
+	run->limited = cJSON_ParseWithContext(&context, run->json, run->length,
+		&status) == NULL && status.failed &&
+		status.end == run->innermost;
+
+	/* only the outermost object's "s" matches, the inner one is skipped */
+	run->extracted = cJSON_ExtractString(run->shallow, run->shallow_length,
+		"s", found, sizeof found, &status) == cJSON_ExtractFound &&
+		strcmp(found, "x") == 0 && status.end == run->shallow_length;
+
+	buffer = strdup(run->shallow);
+	tape = cJSON_ParseTape(buffer, run->shallow_length, &status);
+	root = cJSON_TapeRoot(tape);
+	run->taped = tape != NULL && status.end == run->shallow_length &&
+		cJSON_TapeGetArraySize(root) == 2 &&
+		cJSON_TapeGetArraySize(cJSON_TapeGetObjectItem(root, "k")) == 1 &&
+		strcmp(cJSON_TapeGetStringValue(
+		cJSON_TapeGetObjectItem(root, "s")), "x") == 0;
+	cJSON_DeleteTape(tape);
+	free(buffer);
+
+	return NULL;
+}
+
+ATF_TC(nesting);
+ATF_TC_HEAD(nesting, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test that deeply nested documents don't use up the C stack");
+}
+ATF_TC_BODY(nesting, tc)
+{
+	struct nesting_run run;
+	cJSON_Context context;
+	pthread_attr_t attr;
+	pthread_t thread;
+	cJSON * root, * copy, * other;
+	char * json, * shallow, * printed;
+	size_t size, len, i;
+
+	/* [{"k":[{"k":...[1]...}]}] */
+	size = NESTING_DEPTH * 4 + 16;
+	json = malloc(size);
+	ATF_REQUIRE(json != NULL);
+	memset(&run, 0, sizeof(run));
+	len = 0;
+	for (i = 0; i < NESTING_DEPTH; i++) {
+		run.innermost = len;
+		len += snprintf(json + len, size - len, i % 2 ? "{\"k\":" : "[");
+	}
+	json[len++] = '1';
+	while (i-- > 0) {
+		json[len++] = i % 2 ? '}' : ']';
+	}
+	json[len] = '\0';
+
+	run.json = json;
+	run.length = len;
+
+	/* {"k":[[...[{"s":"deep"}]...]],"s":"x"}, 999 levels */
+	shallow = malloc(4096);
+	ATF_REQUIRE(shallow != NULL);
+	len = snprintf(shallow, 4096, "{\"k\":");
+	for (i = 0; i < CJSON_NESTING_LIMIT - 3; i++) {
+		shallow[len++] = '[';
+	}
+	len += snprintf(shallow + len, 4096 - len, "{\"s\":\"deep\"}");
+	for (i = 0; i < CJSON_NESTING_LIMIT - 3; i++) {
+		shallow[len++] = ']';
+	}
+	len += snprintf(shallow + len, 4096 - len, ",\"s\":\"x\"}");
+	run.shallow = shallow;
+	run.shallow_length = len;
+	len = run.length;
+
+	cJSON_InitContext(&context, NULL);
+	context.nesting_limit = NESTING_DEPTH;
+	run.root = cJSON_ParseWithContext(&context, json, len, NULL);
+	ATF_REQUIRE(run.root != NULL);
+
+	ATF_REQUIRE(pthread_attr_init(&attr) == 0);
+	ATF_REQUIRE(pthread_attr_setstacksize(&attr, 64 * 1024) == 0);
+	ATF_REQUIRE(pthread_create(&thread, &attr, nesting_walk, &run) == 0);
+	ATF_REQUIRE(pthread_join(thread, NULL) == 0);
+	pthread_attr_destroy(&attr);
+
+	ATF_CHECK(run.printed);
+	ATF_CHECK(run.compared);
+	ATF_CHECK(run.parsed);
+	ATF_CHECK(run.limited);
+	ATF_CHECK(run.extracted);
+	ATF_CHECK(run.taped);
+	cJSON_DeleteWithContext(&context, run.root);
+	free(shallow);
+
+	/* the default limit still holds */
+	ATF_CHECK(cJSON_ParseBuffer(json, len, NULL) == NULL);
+
+	/* formatted output indents as before */
+	root = cJSON_Parse("[{\"k\": {\"v\": [1, {}]}}, []]");
+	printed = cJSON_Print(root);
+	ATF_CHECK_STREQ(printed, "[{\n\t\t\"k\":\t{\n\t\t\t\"v\":\t[1, {\n"
+		"\t\t\t\t}]\n\t\t}\n\t}, []]");
+	free(printed);
+	cJSON_Delete(root);
+
+	/* members compare in any order, values that differ deep down don't */
+	root = cJSON_Parse("{\"a\": {\"x\": [1, {\"y\": 2}]}, \"b\": {}}");
+	copy = cJSON_Parse("{\"b\": {}, \"a\": {\"x\": [1, {\"y\": 2}]}}");
+	other = cJSON_Parse("{\"b\": {}, \"a\": {\"x\": [1, {\"y\": 3}]}}");
+	ATF_CHECK(cJSON_Compare(root, copy, 1));
+	ATF_CHECK(!cJSON_Compare(root, other, 1));
+	ATF_CHECK(!cJSON_Compare(other, root, 1));
+	cJSON_Delete(root);
+	cJSON_Delete(copy);
+	cJSON_Delete(other);
+
+	free(json);
+}
+
+ATF_TC(equal);
+ATF_TC_HEAD(equal, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test structural hashes and comparing trees by them");
+}
+ATF_TC_BODY(equal, tc)
+{
+	const char * zone = "[{\"rrset_name\": \"www\", \"rrset_type\": \"A\", "
+		"\"rrset_ttl\": 300, \"rrset_values\": [\"192.0.2.1\"]}, "
+		"{\"rrset_name\": \"@\", \"rrset_type\": \"MX\", \"rrset_ttl\": -0, "
+		"\"rrset_values\": [\"10 mx\", \"20 mx2\"]}]";
+	const char * reordered = "[{\"rrset_values\": [\"192.0.2.1\"], "
+		"\"rrset_ttl\": 300, \"rrset_type\": \"A\", \"rrset_name\": \"www\"}, "
+		"{\"rrset_ttl\": 0, \"rrset_values\": [\"10 mx\", \"20 mx2\"], "
+		"\"rrset_type\": \"MX\", \"rrset_name\": \"@\"}]";
+	cJSON * a, * b, * item;
+	unsigned long hash;
+
+	a = cJSON_Parse(zone);
+	b = cJSON_Parse(reordered);
+	ATF_REQUIRE(a != NULL && b != NULL);
+
+	/* member order doesn't matter, element order does */
+	hash = cJSON_Hash(a);
+	ATF_CHECK(hash != 0);
+	ATF_CHECK_EQ(hash, cJSON_Hash(b));
+	ATF_CHECK(cJSON_Equal(a, b));
+	ATF_CHECK(cJSON_Compare(a, b, 1));
+
+	item = cJSON_GetObjectItem(cJSON_GetArrayItem(b, 1), "rrset_values");
+	cJSON_AddItemToArray(item, cJSON_DetachItemFromArray(item, 0));
+	ATF_CHECK(hash != cJSON_Hash(b));
+	ATF_CHECK(!cJSON_Equal(a, b));
+	ATF_CHECK(!cJSON_Equal(b, a));
+	cJSON_Delete(b);
+
+	/* a key that only differs in case, or a missing member */
+	b = cJSON_Parse(reordered);
+	item = cJSON_GetArrayItem(b, 0);
+	cJSON_AddItemToObject(item, "RRSET_TTL",
+		cJSON_DetachItemFromObject(item, "rrset_ttl"));
+	ATF_CHECK(!cJSON_Equal(a, b));
+	cJSON_DeleteItemFromObject(item, "RRSET_TTL");
+	ATF_CHECK(!cJSON_Equal(a, b));
+	ATF_CHECK(!cJSON_Equal(b, a));
+	cJSON_Delete(b);
+
+	/* a change to a copy shows in both the hash and the comparison */
+	b = cJSON_Duplicate(a, 1);
+	ATF_CHECK_EQ(cJSON_Hash(b), hash);
+	ATF_CHECK(cJSON_Equal(a, b));
+	cJSON_SetNumberValue(cJSON_GetObjectItem(cJSON_GetArrayItem(b, 0),
+		"rrset_ttl"), 600);
+	ATF_CHECK(cJSON_Hash(b) != hash);
+	ATF_CHECK(!cJSON_Equal(a, b));
+	cJSON_Delete(b);
+
+	/* duplicate keys pair up in the order they appear */
+	cJSON_Delete(a);
+	a = cJSON_Parse("{\"a\": 1, \"b\": 2, \"a\": 3}");
+	b = cJSON_Parse("{\"b\": 2, \"a\": 1, \"a\": 3}");
+	ATF_CHECK(cJSON_Equal(a, b));
+	cJSON_Delete(b);
+	b = cJSON_Parse("{\"a\": 3, \"b\": 2, \"a\": 1}");
+	ATF_CHECK(!cJSON_Equal(a, b));
+	ATF_CHECK_EQ(cJSON_Hash(a), cJSON_Hash(b));
+	cJSON_Delete(b);
+
+	ATF_CHECK(!cJSON_Equal(a, NULL));
+	ATF_CHECK_EQ(cJSON_Hash(NULL), 0);
+	cJSON_Delete(a);
+}
+
+struct line_source {
+	const char * text;
+	size_t offset;
+	size_t chunk;
+};
+
+static size_t
+line_fill(char * data, size_t size, void * user)
+{
+	struct line_source * source = user;
+	size_t length;
+
+	length = strlen(source->text + source->offset);
+	if (length > size) {
+		length = size;
+	}
+	if (length > source->chunk) {
+		length = source->chunk;
+	}
+	memcpy(data, source->text + source->offset, length);
+	source->offset += length;
+
+	return length;
+}
+
+ATF_TC(ndjson);
+ATF_TC_HEAD(ndjson, tc)
+{
+	atf_tc_set_md_var(tc, "descr",
+		"Test reading and writing newline delimited JSON");
+}
+ATF_TC_BODY(ndjson, tc)
+{
+	const char * text = "{\"subdomain\": \"www\"}\r\n"
+		"\n"
+		"  \t\n"
+		"[1, 2]\n"
+		"{\"subdomain\": } \n"
+		"1 2\n"
+		"\"last\"";
+	struct line_source source;
+	struct writer_sink sink;
+	cJSON_LineReader reader;
+	cJSON_Writer writer;
+	cJSON * value;
+	char * line;
+	size_t length;
+	size_t i;
+
+	/* in place, blank lines are skipped and bad ones reported */
+	ATF_REQUIRE(cJSON_InitLineReader(&reader, text, strlen(text)));
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+	ATF_CHECK_STREQ(cJSON_GetStringValue(cJSON_GetObjectItem(value,
+		"subdomain")), "www");
+	ATF_CHECK_EQ(reader.line, 1);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+	ATF_CHECK_EQ(cJSON_GetArraySize(value), 2);
+	ATF_CHECK_EQ(reader.line, 4);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineInvalid);
+	ATF_CHECK_EQ(reader.line, 5);
+	ATF_CHECK_EQ(reader.column, 15);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineInvalid);
+	ATF_CHECK_EQ(reader.line, 6);
+	ATF_CHECK_EQ(reader.column, 3);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+	ATF_CHECK_STREQ(cJSON_GetStringValue(value), "last");
+	ATF_CHECK_EQ(reader.line, 7);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineEnd);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineEnd);
+	cJSON_FreeLineReader(&reader);
+
+	/* a stream gives the same lines, whatever it is cut into */
+	source.text = text;
+	source.offset = 0;
+	source.chunk = 3;
+	ATF_REQUIRE(cJSON_InitStreamLineReader(&reader, 8, line_fill, &source));
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+	ATF_CHECK_EQ(reader.line, 1);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+	ATF_CHECK_EQ(reader.line, 4);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineInvalid);
+	ATF_CHECK_EQ(reader.column, 15);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineInvalid);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+	ATF_CHECK_STREQ(cJSON_GetStringValue(value), "last");
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineEnd);
+	cJSON_FreeLineReader(&reader);
+
+	/* a line longer than the fill size grows the buffer */
+	length = 3 * CJSON_READER_FILL_SIZE;
+	line = malloc(length + 8);
+	ATF_REQUIRE(line != NULL);
+	line[0] = '"';
+	memset(line + 1, 'a', length);
+	memcpy(line + length + 1, "\"\n[]\n", 6);
+	source.text = line;
+	source.offset = 0;
+	source.chunk = 1000;
+	ATF_REQUIRE(cJSON_InitStreamLineReader(&reader, 0, line_fill, &source));
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+	ATF_CHECK_EQ(strlen(cJSON_GetStringValue(value)), length);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+	ATF_CHECK(cJSON_IsArray(value));
+	ATF_CHECK_EQ(reader.line, 2);
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineEnd);
+	cJSON_FreeLineReader(&reader);
+	free(line);
+
+	/* each value written ends with a newline and reads back */
+	memset(&sink, 0, sizeof(sink));
+	cJSON_InitStreamWriter(&writer, 16, writer_collect, &sink);
+	ATF_CHECK(!cJSON_WriteLine(&writer));
+	cJSON_ResetWriter(&writer);
+	for (i = 0; i < 3; i++) {
+		ATF_CHECK(cJSON_WriteObjectStart(&writer));
+		ATF_CHECK(cJSON_WriteKey(&writer, "line"));
+		ATF_CHECK(cJSON_WriteNumber(&writer, (double)i + 1));
+		ATF_CHECK(cJSON_WriteObjectEnd(&writer));
+		ATF_CHECK(cJSON_WriteLine(&writer));
+	}
+	ATF_CHECK_EQ(writer.lines, 3);
+	ATF_CHECK(cJSON_FinishWriter(&writer, &length) != NULL);
+	ATF_CHECK_STREQ(sink.data, "{\"line\":1}\n{\"line\":2}\n{\"line\":3}\n");
+	ATF_CHECK_EQ(length, strlen(sink.data));
+	cJSON_FreeWriter(&writer);
+
+	ATF_REQUIRE(cJSON_InitLineReader(&reader, sink.data, sink.length));
+	for (i = 0; i < 3; i++) {
+		ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineValue);
+		ATF_CHECK_EQ(cJSON_GetObjectItem(value, "line")->valuedouble,
+			(double)i + 1);
+	}
+	ATF_CHECK_EQ(cJSON_ReadLine(&reader, &value), cJSON_LineEnd);
+	cJSON_FreeLineReader(&reader);
+
+	/* a value left open can't be finished */
+	cJSON_InitWriter(&writer, NULL, 0);
+	ATF_CHECK(cJSON_WriteNull(&writer));
+	ATF_CHECK(cJSON_WriteLine(&writer));
+	ATF_CHECK(cJSON_WriteArrayStart(&writer));
+	ATF_CHECK(!cJSON_WriteLine(&writer));
+	ATF_CHECK(cJSON_FinishWriter(&writer, NULL) == NULL);
+	cJSON_FreeWriter(&writer);
+}
+
 ATF_TP_ADD_TCS(tp)
 {
 	ATF_TP_ADD_TC(tp, GET);
+	ATF_TP_ADD_TC(tp, damping);
+	ATF_TP_ADD_TC(tp, ratelimit);
+	ATF_TP_ADD_TC(tp, dns_verify);
+	ATF_TP_ADD_TC(tp, stream_429);
+	ATF_TP_ADD_TC(tp, livedns_write);
+	ATF_TP_ADD_TC(tp, rrset_stream);
+	ATF_TP_ADD_TC(tp, rrtab);
+	ATF_TP_ADD_TC(tp, rrset_decode);
+	ATF_TP_ADD_TC(tp, arena);
+	ATF_TP_ADD_TC(tp, node_pool);
+	ATF_TP_ADD_TC(tp, node_pool_threads);
+	ATF_TP_ADD_TC(tp, string_scan);
+	ATF_TP_ADD_TC(tp, number_parse);
+	ATF_TP_ADD_TC(tp, number_print);
+	ATF_TP_ADD_TC(tp, parse_buffer);
+	ATF_TP_ADD_TC(tp, parse_insitu);
+	ATF_TP_ADD_TC(tp, printed_length);
+	ATF_TP_ADD_TC(tp, context);
+	ATF_TP_ADD_TC(tp, event_parser);
+	ATF_TP_ADD_TC(tp, extract_string);
+	ATF_TP_ADD_TC(tp, tape);
+	ATF_TP_ADD_TC(tp, intern);
+	ATF_TP_ADD_TC(tp, writer);
+	ATF_TP_ADD_TC(tp, nesting);
+	ATF_TP_ADD_TC(tp, equal);
+	ATF_TP_ADD_TC(tp, ndjson);
 	return atf_no_error();
 }